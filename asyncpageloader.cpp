@@ -0,0 +1,148 @@
+/**
+ * @file asyncpageloader.cpp
+ * @brief Реализация асинхронной загрузки текущей страницы.
+ */
+
+#include "asyncpageloader.h"
+#include "imageloader.h"
+#include "pagecache.h"
+#include "progressiverenderer.h"
+#include "trace.h"
+
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+namespace {
+
+/// Результат задачи загрузки.
+struct LoadResult
+{
+    QString filePath;
+    QString html;                           ///< Содержимое большой страницы для постепенной верстки.
+    QSharedPointer<QTextDocument> document;
+    qint64 cost = 0;
+    int generation = 0;
+};
+
+} // namespace
+
+AsyncPageLoader::AsyncPageLoader(PagePrefetcher::PageLoader loader, QObject *parent)
+    : QObject(parent)
+    , loader(std::move(loader))
+{
+    pool.setMaxThreadCount(1);
+
+    coalesceTimer.setSingleShot(true);
+    coalesceTimer.setInterval(DefaultCoalesceMs);
+    connect(&coalesceTimer, &QTimer::timeout, this, [this]() {
+        // Окно закончилось: отправляем последний запрос, если он еще не отправлен. Сравниваются
+        // поколения, а не пути: после A -> B -> A отправленная задача A уже устарела, и ее результат
+        // будет отброшен, а запрос того же пути с другим шрифтом или шириной требует новой верстки.
+        if (!requestedPath.isEmpty() && generation.loadAcquire() != dispatchedGeneration)
+        {
+            dispatch();
+        }
+    });
+}
+
+AsyncPageLoader::~AsyncPageLoader()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+void AsyncPageLoader::request(const QString &filePath, const QFont &font, qreal textWidth)
+{
+    generation.fetchAndAddOrdered(1);
+    requestedPath = filePath;
+    this->font = font;
+    this->textWidth = textWidth;
+
+    if (coalesceTimer.interval() == 0 || !coalesceTimer.isActive())
+    {
+        dispatch();
+    }
+    coalesceTimer.start();
+}
+
+void AsyncPageLoader::cancel()
+{
+    generation.fetchAndAddOrdered(1);
+    coalesceTimer.stop();
+    requestedPath.clear();
+}
+
+/**
+ * @brief Отправляет последний запрос в рабочий поток.
+ */
+void AsyncPageLoader::dispatch()
+{
+    const QString filePath = requestedPath;
+    const int taskGeneration = generation.loadAcquire();
+    const PagePrefetcher::PageLoader load = loader;
+    const QFont taskFont = font;
+    const qreal taskWidth = textWidth;
+    QAtomicInt* currentGeneration = &generation;
+
+    dispatchedGeneration = taskGeneration;
+
+    auto* watcher = new QFutureWatcher<LoadResult>(this);
+    connect(watcher, &QFutureWatcher<LoadResult>::finished, this, [this, watcher]() {
+        const LoadResult result = watcher->result();
+        watcher->deleteLater();
+
+        // Пока страница загружалась, пользователь выбрал другую.
+        if (result.generation != generation.loadAcquire())
+        {
+            return;
+        }
+
+        requestedPath.clear();
+
+        if (result.document)
+        {
+            // Документ уже в главном потоке: теперь он может получить свои картинки.
+            if (ImageLoader* images = ImageLoader::instance())
+            {
+                images->adopt(result.document.data());
+            }
+            emit documentReady(result.filePath, result.document, result.cost);
+        }
+        else if (!result.html.isEmpty())
+        {
+            emit largePageReady(result.filePath, result.html);
+        }
+    });
+
+    watcher->setFuture(QtConcurrent::run(&pool, [=]() {
+        LoadResult result;
+        result.filePath = filePath;
+        result.generation = taskGeneration;
+
+        // Запрос устарел, пока ждал в очереди: ничего не читаем.
+        if (taskGeneration != currentGeneration->loadAcquire())
+        {
+            return result;
+        }
+
+        TraceSpan readSpan("page.read", "page");
+        readSpan.setDetail(filePath);
+        QString html = load(filePath);
+        readSpan.end();
+
+        if (html.isEmpty() || taskGeneration != currentGeneration->loadAcquire())
+        {
+            return result;
+        }
+
+        if (ProgressiveRenderer::shouldRender(html))
+        {
+            result.html = html;
+            return result;
+        }
+
+        result.document = PagePrefetcher::buildDocument(html, taskFont, taskWidth);
+        result.cost = PageCache::estimateCost(result.document.data(), html.size());
+        return result;
+    }));
+}
@@ -0,0 +1,106 @@
+#ifndef ASYNCPAGELOADER_H
+#define ASYNCPAGELOADER_H
+
+/**
+ * @file asyncpageloader.h
+ * @brief Определение класса AsyncPageLoader — асинхронной загрузки страницы, выбранной в списке навигации.
+ *
+ * Если удерживать стрелку в списке навигации, текущая строка меняется десятки раз в секунду.
+ * Загрузка каждой такой страницы в главном потоке блокировала бы список. AsyncPageLoader читает
+ * и верстает страницу в рабочем потоке, а частые запросы объединяет: страница показывается
+ * только та, на которой пользователь остановился.
+ */
+
+#include <QAtomicInt>
+#include <QFont>
+#include <QObject>
+#include <QSharedPointer>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+
+#include "pageprefetcher.h"
+
+/**
+ * @class AsyncPageLoader
+ * @brief Асинхронная отменяемая загрузка текущей страницы.
+ *
+ * Каждый запрос увеличивает номер поколения. Задача устаревшего поколения прекращается перед
+ * чтением и перед версткой, а ее результат отбрасывается и не попадает во вкладку.
+ * Первый запрос после паузы отправляется сразу, а следующие в течение интервала объединения
+ * откладываются до его окончания, и выполняется только последний из них.
+ */
+class AsyncPageLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Интервал объединения частых запросов по умолчанию в миллисекундах.
+    static constexpr int DefaultCoalesceMs = 50;
+
+    /**
+     * @brief Конструктор.
+     * @param loader Функция чтения содержимого страницы.
+     * @param parent Родительский объект.
+     */
+    explicit AsyncPageLoader(PagePrefetcher::PageLoader loader, QObject* parent = nullptr);
+
+    /**
+     * @brief Деструктор. Отменяет запросы и дожидается рабочего потока.
+     */
+    ~AsyncPageLoader() override;
+
+    /**
+     * @brief Запрашивает загрузку страницы. Предыдущие запросы становятся устаревшими.
+     * @param filePath Путь к странице.
+     * @param font Шрифт текстового поля.
+     * @param textWidth Ширина области просмотра.
+     */
+    void request(const QString& filePath, const QFont& font, qreal textWidth);
+
+    /**
+     * @brief Отменяет все запросы, например когда страница нашлась в кэше.
+     */
+    void cancel();
+
+    /**
+     * @brief Задает интервал объединения запросов. 0 — каждый запрос отправляется сразу.
+     */
+    void setCoalesceInterval(int msec) { coalesceTimer.setInterval(qMax(0, msec)); }
+
+    /// Путь к странице последнего запроса, пока он не выполнен или не отменен.
+    QString pendingPath() const { return requestedPath; }
+
+signals:
+    /**
+     * @brief Сигнал о готовом документе запрошенной страницы.
+     * @param filePath Путь к странице.
+     * @param document Сверстанный документ.
+     * @param cost Оценка занимаемой документом памяти для PageCache.
+     */
+    void documentReady(const QString& filePath, const QSharedPointer<QTextDocument>& document, qint64 cost);
+
+    /**
+     * @brief Сигнал о прочитанной большой странице.
+     *
+     * Большие страницы не верстаются в рабочем потоке целиком: их постепенно верстает
+     * ProgressiveRenderer в главном потоке.
+     * @param filePath Путь к странице.
+     * @param html Содержимое страницы.
+     */
+    void largePageReady(const QString& filePath, const QString& html);
+
+private:
+    void dispatch();
+
+    PagePrefetcher::PageLoader loader;
+    QThreadPool pool;           ///< Один поток: одновременно нужна только одна текущая страница.
+    QAtomicInt generation;      ///< Поколение последнего запроса.
+    QTimer coalesceTimer;       ///< Окно, в течение которого запросы объединяются.
+    QString requestedPath;      ///< Последний запрос, еще не отправленный или не выполненный.
+    int dispatchedGeneration = -1; ///< Поколение последнего отправленного в рабочий поток запроса.
+    QFont font;
+    qreal textWidth = 0;
+};
+
+#endif // ASYNCPAGELOADER_H
@@ -0,0 +1,629 @@
+/**
+ * @file handbook_bench.cpp
+ * @brief Замеры производительности загрузки данных, переключения страниц и работы с закладками.
+ *
+ * Замеры выполняются на синтетических справочниках, которые создаются во временном каталоге.
+ * В нем же главное окно хранит закладки, состояние сеанса и поисковый индекс (HANDBOOK_DATA_DIR),
+ * чтобы замеры не трогали файлы рядом с программой.
+ * Размеры задаются переменными окружения:
+ * - HANDBOOK_BENCH_CATALOGS — количества страниц в справочниках через запятую (по умолчанию "100,1000,10000");
+ * - HANDBOOK_BENCH_PAGE_KB — размер одной страницы в килобайтах (по умолчанию 4);
+ * - HANDBOOK_BENCH_BOOKMARKS — количества закладок через запятую (по умолчанию "10,1000,100000");
+ * - HANDBOOK_BENCH_TITLES — количества названий для быстрого перехода через запятую (по умолчанию "1000,100000");
+ * - HANDBOOK_BENCH_TREE — количества страниц во вложенном оглавлении через запятую (по умолчанию "1000,100000");
+ * - HANDBOOK_BENCH_FIND_KB — размеры страницы для поиска по странице в килобайтах через запятую (по умолчанию "256,8192").
+ *
+ * Результаты в машиночитаемом виде записываются стандартными средствами QtTest, например
+ *     handbook_bench -o results.xml,xml -o -,txt
+ * Цель ctest запускает замеры именно так и сохраняет handbook_bench.xml в каталоге сборки,
+ * чтобы результаты разных коммитов можно было сравнивать.
+ */
+
+#include "../mainwindow.h"
+#include "../pagefinder.h"
+#include "../titlematcher.h"
+#include "ui_mainwindow.h"
+
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace {
+
+QVector<int> sizesFromEnvironment(const char* name, const QVector<int>& defaults)
+{
+    const QString value = qEnvironmentVariable(name);
+    if (value.isEmpty())
+    {
+        return defaults;
+    }
+
+    QVector<int> result;
+    for (const QString& part : value.split(',', Qt::SkipEmptyParts))
+    {
+        bool ok = false;
+        const int size = part.trimmed().toInt(&ok);
+        if (ok && size > 0)
+        {
+            result.append(size);
+        }
+    }
+    return result.isEmpty() ? defaults : result;
+}
+
+/**
+ * @brief Создает HTML страницу примерно указанного размера, похожую на страницы справочника.
+ */
+QByteArray syntheticPage(int number, int sizeBytes)
+{
+    QByteArray html = "<html><head><meta charset=\"utf-8\"></head><body>\n";
+    html += "<h1>Раздел " + QByteArray::number(number) + "</h1>\n";
+
+    int paragraph = 0;
+    while (html.size() < sizeBytes)
+    {
+        if (paragraph % 4 == 3)
+        {
+            html += "<pre>for item in range(" + QByteArray::number(paragraph) + "):\n    print(item)</pre>\n";
+        }
+        else
+        {
+            html += "<p>Список в Python — изменяемая последовательность. Абзац " + QByteArray::number(paragraph)
+                    + " страницы " + QByteArray::number(number) + " содержит <b>выделенный</b> текст и "
+                    + "<a href=\"#section" + QByteArray::number(paragraph) + "\">ссылку</a>.</p>\n";
+        }
+        ++paragraph;
+    }
+
+    html += "</body></html>\n";
+    return html;
+}
+
+/**
+ * @brief Создает названия страниц из слов, встречающихся в названиях справочника.
+ */
+QStringList syntheticTitles(int count)
+{
+    static const QStringList words = {
+        "Синтаксис", "списки", "словари", "множества", "строки", "функции", "классы", "модули",
+        "исключения", "генераторы", "декораторы", "итераторы", "файлы", "кортежи", "циклы", "условия",
+        "Python", "lambda", "async", "методы", "операторы", "типы", "аргументы", "импорт"
+    };
+
+    QStringList titles;
+    titles.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        titles.append(QString("%1. %2 и %3 (%4)")
+                          .arg(i + 1)
+                          .arg(words[i % words.size()], words[(i / words.size()) % words.size()],
+                               words[(i * 7 + 3) % words.size()]));
+    }
+    return titles;
+}
+
+/**
+ * @brief Создает вложенное оглавление: главы по 10 разделов, разделы по 10 подразделов.
+ */
+QJsonArray syntheticNestedCatalog(int pages)
+{
+    QJsonArray chapters;
+    int number = 0;
+    auto entry = [&number](const QString& title) {
+        ++number;
+        return QJsonObject{{"title", title}, {"filePath", QString(":/texts/%1.html").arg(number)}};
+    };
+
+    while (number < pages)
+    {
+        QJsonObject chapter = entry(QString("Глава %1").arg(chapters.size() + 1));
+        QJsonArray sections;
+        for (int s = 0; s < 10 && number < pages; ++s)
+        {
+            QJsonObject section = entry(QString("Раздел %1").arg(number));
+            QJsonArray subsections;
+            for (int k = 0; k < 10 && number < pages; ++k)
+            {
+                subsections.append(entry(QString("Подраздел %1").arg(number)));
+            }
+            section["children"] = subsections;
+            sections.append(section);
+        }
+        chapter["children"] = sections;
+        chapters.append(chapter);
+    }
+    return chapters;
+}
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+    return file.write(data) == data.size();
+}
+
+} // namespace
+
+/**
+ * @class HandbookBench
+ * @brief Набор замеров QBENCHMARK для горячих путей главного окна.
+ *
+ * Класс объявлен другом MainWindow, чтобы замерять закрытые методы без изменения их видимости.
+ */
+class HandbookBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void loadDataFromFile_data();
+    void loadDataFromFile();
+
+    void loadTextFromFile_data();
+    void loadTextFromFile();
+
+    void switchPage_data();
+    void switchPage();
+    void coalescePageRequests();
+
+    void updateBookmarkButton_data();
+    void updateBookmarkButton();
+
+    void toggleBookmarkList_data();
+    void toggleBookmarkList();
+
+    void quickOpenMatch_data();
+    void quickOpenMatch();
+
+    void tocTreeNavigate_data();
+    void tocTreeNavigate();
+
+    void findInPage_data();
+    void findInPage();
+
+private:
+    QString catalogPath(int pages);
+    QString bookmarksPath(int count, int catalogPages);
+    void useCatalog(int pages);
+    void useBookmarks(int count, int catalogPages);
+
+    QTemporaryDir workDir;
+    MainWindow* window = nullptr;
+    int pageBytes = 4 * 1024;
+    QVector<int> catalogSizes;
+    QVector<int> bookmarkCounts;
+};
+
+void HandbookBench::initTestCase()
+{
+    QVERIFY(workDir.isValid());
+
+    bool ok = false;
+    const int pageKb = qEnvironmentVariableIntValue("HANDBOOK_BENCH_PAGE_KB", &ok);
+    if (ok && pageKb > 0)
+    {
+        pageBytes = pageKb * 1024;
+    }
+    catalogSizes = sizesFromEnvironment("HANDBOOK_BENCH_CATALOGS", {100, 1000, 10000});
+    bookmarkCounts = sizesFromEnvironment("HANDBOOK_BENCH_BOOKMARKS", {10, 1000, 100000});
+
+    qputenv("HANDBOOK_DATA_DIR", QFile::encodeName(workDir.path()));
+    window = new MainWindow;
+    window->resize(1200, 800);
+    window->show();
+    QVERIFY(QTest::qWaitForWindowExposed(window));
+    window->finishStartup();
+
+    // Фоновая подготовка соседних страниц вносила бы шум в замеры переключения,
+    // а окно объединения запросов — задержку таймера.
+    window->prefetcher->setRadius(0);
+    window->pageLoader->setCoalesceInterval(0);
+}
+
+void HandbookBench::cleanupTestCase()
+{
+    delete window;
+    window = nullptr;
+}
+
+/**
+ * @brief Возвращает data.json справочника из pages страниц, создавая его и страницы при первом обращении.
+ */
+QString HandbookBench::catalogPath(int pages)
+{
+    const QString dir = workDir.filePath(QString("catalog-%1").arg(pages));
+    const QString dataPath = dir + "/data.json";
+    if (QFile::exists(dataPath))
+    {
+        return dataPath;
+    }
+
+    QDir().mkpath(dir);
+    QJsonArray catalog;
+    for (int i = 0; i < pages; ++i)
+    {
+        const QString pagePath = QString("%1/%2.page.html").arg(dir).arg(i);
+        if (!writeFile(pagePath, syntheticPage(i, pageBytes)))
+        {
+            qWarning() << "Не удалось записать страницу" << pagePath;
+            return QString();
+        }
+
+        QJsonObject obj;
+        obj["title"] = QString("%1. Синтетический раздел").arg(i + 1);
+        obj["filePath"] = pagePath;
+        catalog.append(obj);
+    }
+
+    return writeFile(dataPath, QJsonDocument(catalog).toJson()) ? dataPath : QString();
+}
+
+/**
+ * @brief Возвращает снимок закладок из count записей. Первые закладки указывают на страницы справочника,
+ * остальные — на страницы, которых в нем нет.
+ */
+QString HandbookBench::bookmarksPath(int count, int catalogPages)
+{
+    const QString path = workDir.filePath(QString("bookmarks-%1-%2.json").arg(count).arg(catalogPages));
+    QFile::remove(path + ".journal");
+    if (QFile::exists(path))
+    {
+        return path;
+    }
+
+    const QString dir = QFileInfo(catalogPath(catalogPages)).path();
+    QJsonArray snapshot;
+    for (int i = 0; i < count; ++i)
+    {
+        QJsonObject obj;
+        obj["title"] = QString("Закладка %1").arg(i);
+        obj["filePath"] = QString("%1/%2.page.html").arg(dir).arg(i);
+        snapshot.append(obj);
+    }
+
+    return writeFile(path, QJsonDocument(snapshot).toJson()) ? path : QString();
+}
+
+void HandbookBench::useCatalog(int pages)
+{
+    const QString dataPath = catalogPath(pages);
+    QVERIFY(!dataPath.isEmpty());
+    QVERIFY(window->loadDataFromFile(dataPath));
+    window->syncBookmarkRows();
+    window->setCurrentRow(0);
+}
+
+void HandbookBench::useBookmarks(int count, int catalogPages)
+{
+    const QString path = bookmarksPath(count, catalogPages);
+    QVERIFY(!path.isEmpty());
+    QVERIFY(window->bookmarks.load(path));
+    window->syncBookmarkRows();
+}
+
+void HandbookBench::loadDataFromFile_data()
+{
+    QTest::addColumn<int>("pages");
+    for (int pages : catalogSizes)
+    {
+        QTest::addRow("%d pages", pages) << pages;
+    }
+}
+
+/**
+ * @brief Чтение data.json и заполнение модели оглавления.
+ */
+void HandbookBench::loadDataFromFile()
+{
+    QFETCH(int, pages);
+    const QString dataPath = catalogPath(pages);
+    QVERIFY(!dataPath.isEmpty());
+
+    QBENCHMARK
+    {
+        window->loadDataFromFile(dataPath);
+    }
+
+    QCOMPARE(window->tocModel->rowCount(), pages);
+}
+
+void HandbookBench::loadTextFromFile_data()
+{
+    QTest::addColumn<int>("sizeKb");
+    QTest::newRow("4 KiB") << 4;
+    QTest::newRow("64 KiB") << 64;
+    QTest::newRow("1 MiB") << 1024;
+}
+
+/**
+ * @brief Чтение одной страницы с диска.
+ */
+void HandbookBench::loadTextFromFile()
+{
+    QFETCH(int, sizeKb);
+    const QString path = workDir.filePath(QString("page-%1k.html").arg(sizeKb));
+    QVERIFY(writeFile(path, syntheticPage(0, sizeKb * 1024)));
+
+    QString text;
+    QBENCHMARK
+    {
+        text = MainWindow::loadTextFromFile(path);
+    }
+
+    QVERIFY(!text.isEmpty());
+}
+
+void HandbookBench::switchPage_data()
+{
+    QTest::addColumn<int>("pages");
+    QTest::addColumn<bool>("cached");
+    for (int pages : catalogSizes)
+    {
+        QTest::addRow("%d pages, cold", pages) << pages << false;
+        QTest::addRow("%d pages, cached", pages) << pages << true;
+    }
+}
+
+/**
+ * @brief Смена строки списка навигации: onNavigationItemSelected, чтение, разбор и верстка страницы
+ * в рабочем потоке, подстановка документа во вкладку и отрисовка.
+ *
+ * В холодном варианте кэш страниц отключен, и каждая смена строки разбирает страницу заново.
+ */
+void HandbookBench::switchPage()
+{
+    QFETCH(int, pages);
+    QFETCH(bool, cached);
+
+    useCatalog(pages);
+    const qint64 defaultBudget = window->pageCache.maxBytes();
+    window->pageCache.clear();
+    window->pageCache.setMaxBytes(cached ? defaultBudget : 0);
+
+    // Страницы из середины справочника: в кэшированном варианте обе уже лежат в кэше.
+    const int first = pages / 2;
+    const int second = qMin(first + 1, pages - 1);
+    // Страница загружается асинхронно: ждем, пока во вкладке появится новый документ.
+    // Уже выбранная строка нового документа не даст (в справочнике из одной страницы first == second).
+    auto selectRow = [this](int row) {
+        if (window->currentRow() == row && window->currentView()->pageDocument())
+        {
+            return;
+        }
+        const QTextDocument* previous = window->currentView()->pageDocument().data();
+        window->setCurrentRow(row);
+        QTRY_VERIFY_WITH_TIMEOUT(window->currentView()->pageDocument().data() != previous, 10000);
+    };
+
+    selectRow(first);
+    selectRow(second);
+    if (QTest::currentTestFailed())
+    {
+        window->pageCache.setMaxBytes(defaultBudget);
+        return;
+    }
+
+    int row = first;
+    QBENCHMARK
+    {
+        selectRow(row);
+        window->currentView()->viewport()->repaint();
+        row = row == first ? second : first;
+    }
+
+    QVERIFY(window->currentView()->pageDocument());
+    window->pageCache.setMaxBytes(defaultBudget);
+}
+
+/**
+ * @brief Проверка объединения запросов A -> B -> A: задача A отправлена первой, ее результат устарел,
+ * и после окна объединения A должна загрузиться заново и показаться ровно один раз.
+ */
+void HandbookBench::coalescePageRequests()
+{
+    const QString first = workDir.filePath("coalesce-a.html");
+    const QString second = workDir.filePath("coalesce-b.html");
+    QVERIFY(writeFile(first, syntheticPage(1, pageBytes)));
+    QVERIFY(writeFile(second, syntheticPage(2, pageBytes)));
+
+    AsyncPageLoader loader(&MainWindow::loadTextFromFile);
+    QStringList shown;
+    connect(&loader, &AsyncPageLoader::documentReady, this, [&shown](const QString& filePath) {
+        shown.append(filePath);
+    });
+
+    const QFont font = window->currentView()->font();
+    loader.request(first, font, 800);
+    loader.request(second, font, 800);
+    loader.request(first, font, 800);
+
+    QTRY_VERIFY_WITH_TIMEOUT(!shown.isEmpty(), 10000);
+    QTest::qWait(2 * AsyncPageLoader::DefaultCoalesceMs);
+    QCOMPARE(shown, QStringList{first});
+    QVERIFY(loader.pendingPath().isEmpty());
+}
+
+void HandbookBench::updateBookmarkButton_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("showingBookmarks");
+    for (int count : bookmarkCounts)
+    {
+        QTest::addRow("%d bookmarks", count) << count << false;
+        QTest::addRow("%d bookmarks, bookmark list", count) << count << true;
+    }
+}
+
+/**
+ * @brief Обновление кнопки закладки для текущей страницы.
+ */
+void HandbookBench::updateBookmarkButton()
+{
+    QFETCH(int, count);
+    QFETCH(bool, showingBookmarks);
+
+    const int pages = catalogSizes.first();
+    useCatalog(pages);
+    useBookmarks(count, pages);
+    window->showingBookmarks = showingBookmarks;
+    window->setCurrentRow(0);
+
+    QBENCHMARK
+    {
+        window->updateBookmarkButton();
+    }
+
+    window->showingBookmarks = false;
+}
+
+void HandbookBench::toggleBookmarkList_data()
+{
+    QTest::addColumn<int>("count");
+    for (int count : bookmarkCounts)
+    {
+        QTest::addRow("%d bookmarks", count) << count;
+    }
+}
+
+/**
+ * @brief Переключение списка навигации между закладками и всеми страницами.
+ */
+void HandbookBench::toggleBookmarkList()
+{
+    QFETCH(int, count);
+
+    const int pages = catalogSizes.last();
+    useCatalog(pages);
+    useBookmarks(count, pages);
+
+    QBENCHMARK
+    {
+        window->showBookmarkList();
+        window->restoreNavigationList();
+    }
+
+    QCOMPARE(window->navigationRowCount(), pages);
+}
+
+void HandbookBench::quickOpenMatch_data()
+{
+    QTest::addColumn<int>("titles");
+    QTest::addColumn<QString>("query");
+    for (int titles : sizesFromEnvironment("HANDBOOK_BENCH_TITLES", {1000, 100000}))
+    {
+        QTest::addRow("%d titles, prefix", titles) << titles << "слов";
+        QTest::addRow("%d titles, two words", titles) << titles << "генераторы итер";
+        QTest::addRow("%d titles, typo", titles) << titles << "декоратры";
+        QTest::addRow("%d titles, layout", titles) << titles << "cbynfrcbc";
+    }
+}
+
+/**
+ * @brief Поиск в окне быстрого перехода на одно нажатие клавиши.
+ */
+void HandbookBench::quickOpenMatch()
+{
+    QFETCH(int, titles);
+    QFETCH(QString, query);
+
+    TitleMatcher matcher(syntheticTitles(titles));
+    QVector<TitleMatcher::Match> matches;
+
+    QBENCHMARK
+    {
+        matches = matcher.match(query);
+    }
+
+    QVERIFY(!matches.isEmpty());
+}
+
+void HandbookBench::tocTreeNavigate_data()
+{
+    QTest::addColumn<int>("pages");
+    for (int pages : sizesFromEnvironment("HANDBOOK_BENCH_TREE", {1000, 100000}))
+    {
+        QTest::addRow("%d pages", pages) << pages;
+    }
+}
+
+/**
+ * @brief Загрузка вложенного оглавления и 200 переходов "Следующая" по дереву.
+ *
+ * После замера проверяется, что переходы шли в порядке чтения, а модель загрузила только верхний
+ * уровень и разделы глав, через которые прошли.
+ */
+void HandbookBench::tocTreeNavigate()
+{
+    QFETCH(int, pages);
+
+    const QJsonArray catalog = syntheticNestedCatalog(pages);
+    TocModel toc;
+    TocTreeModel tree(&toc);
+    const int steps = qMin(200, pages);
+    int row = -1;
+
+    QBENCHMARK
+    {
+        toc.loadFromJson(catalog);
+        row = 0;
+        for (int step = 1; step < steps; ++step)
+        {
+            row = toc.nextRow(row);
+            tree.indexOfRow(row);
+        }
+    }
+
+    // Страницы синтетического оглавления пронумерованы в порядке чтения.
+    QCOMPARE(toc.filePath(row), QString(":/texts/%1.html").arg(steps));
+    QCOMPARE(TocTreeModel::tocRow(tree.indexOfRow(row)), row);
+    QCOMPARE(tree.materializedCount(), toc.rowCount());
+    QVERIFY(toc.rowCount() <= catalog.size() + 2 * steps);
+}
+
+void HandbookBench::findInPage_data()
+{
+    QTest::addColumn<int>("kilobytes");
+    QTest::addColumn<QString>("query");
+    for (int kilobytes : sizesFromEnvironment("HANDBOOK_BENCH_FIND_KB", {256, 8192}))
+    {
+        QTest::addRow("%d KB, word", kilobytes) << kilobytes << "декоратор";
+        QTest::addRow("%d KB, one letter", kilobytes) << kilobytes << "и";
+    }
+}
+
+/**
+ * @brief Поиск по странице в рабочем потоке: свертка регистра проекции и поиск всех совпадений.
+ *
+ * Частый запрос дает десятки тысяч совпадений, как однобуквенный запрос на длинной странице.
+ */
+void HandbookBench::findInPage()
+{
+    QFETCH(int, kilobytes);
+    QFETCH(QString, query);
+
+    const QString paragraph = "Функция-ДЕКОРАТОР принимает функцию и возвращает новую функцию. ";
+    QString text;
+    text.reserve(kilobytes * 1024 / int(sizeof(QChar)) + paragraph.size());
+    while (text.size() * int(sizeof(QChar)) < kilobytes * 1024)
+    {
+        text += paragraph;
+    }
+    const QString needle = PageFinder::foldCase(query);
+    QVector<int> matches;
+
+    QBENCHMARK
+    {
+        matches = PageFinder::findAll(PageFinder::foldCase(text), needle);
+    }
+
+    QVERIFY(!matches.isEmpty());
+    QCOMPARE(PageFinder::foldCase(text.mid(matches.first(), needle.size())), needle);
+}
+
+QTEST_MAIN(HandbookBench)
+
+#include "handbook_bench.moc"
@@ -0,0 +1,283 @@
+/**
+ * @file bookmarkstore.cpp
+ * @brief Реализация хранилища закладок с журналом изменений.
+ */
+
+#include "bookmarkstore.h"
+#include "metrics.h"
+#include "trace.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+bool BookmarkStore::load(const QString &snapshotPath)
+{
+    TraceSpan span("bookmarks.load", "bookmarks");
+    MetricsTimer timer(Metrics::bookmarksLoad);
+
+    this->snapshotPath = snapshotPath;
+    entries.clear();
+    indexByPath.clear();
+    removedCount = 0;
+    journalLength = 0;
+
+    bool loaded = false;
+
+    QFile snapshot(snapshotPath);
+    if (snapshot.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        const QByteArray data = snapshot.readAll();
+        snapshot.close();
+        Metrics::bookmarkBytesRead.add(data.size());
+        QJsonDocument jsonDoc = QJsonDocument::fromJson(data);
+
+        if (jsonDoc.isArray())
+        {
+            const QJsonArray jsonArray = jsonDoc.array();
+            entries.reserve(jsonArray.size());
+            for (const QJsonValue& value : jsonArray)
+            {
+                QJsonObject obj = value.toObject();
+                insert(obj["title"].toString(), obj["filePath"].toString());
+            }
+            loaded = true;
+        }
+        else
+        {
+            qDebug() << "Файл закладок не является JSON массивом";
+        }
+    }
+
+    // Журнал применяется построчно. Оборванная последняя строка (сбой во время записи) пропускается.
+    QFile journal(journalPath());
+    if (journal.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        while (!journal.atEnd())
+        {
+            const QByteArray rawLine = journal.readLine();
+            Metrics::bookmarkBytesRead.add(rawLine.size());
+            const QByteArray line = rawLine.trimmed();
+            const QJsonObject obj = QJsonDocument::fromJson(line).object();
+            const QString op = obj["op"].toString();
+
+            if (op == "add")
+            {
+                insert(obj["title"].toString(), obj["filePath"].toString());
+            }
+            else if (op == "remove")
+            {
+                erase(obj["filePath"].toString());
+            }
+            else
+            {
+                continue;
+            }
+            ++journalLength;
+        }
+        journal.close();
+        loaded = true;
+    }
+
+    return loaded;
+}
+
+bool BookmarkStore::add(const QString &title, const QString &filePath)
+{
+    if (!insert(title, filePath))
+    {
+        return false;
+    }
+
+    QJsonObject obj;
+    obj["op"] = "add";
+    obj["title"] = title;
+    obj["filePath"] = filePath;
+    appendJournal(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+bool BookmarkStore::remove(const QString &filePath)
+{
+    if (!erase(filePath))
+    {
+        return false;
+    }
+
+    QJsonObject obj;
+    obj["op"] = "remove";
+    obj["filePath"] = filePath;
+    appendJournal(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+QVector<BookmarkStore::Bookmark> BookmarkStore::items() const
+{
+    QVector<Bookmark> result;
+    result.reserve(indexByPath.size());
+    for (const Bookmark& bookmark : entries)
+    {
+        if (!bookmark.filePath.isEmpty())
+        {
+            result.append(bookmark);
+        }
+    }
+    return result;
+}
+
+bool BookmarkStore::compact()
+{
+    TraceSpan span("bookmarks.compact", "bookmarks");
+
+    if (snapshotPath.isEmpty())
+    {
+        return false;
+    }
+
+    MetricsTimer timer(Metrics::bookmarksSave);
+
+    QJsonArray jsonArray;
+    for (const Bookmark& bookmark : entries)
+    {
+        if (bookmark.filePath.isEmpty())
+        {
+            continue;
+        }
+        QJsonObject obj;
+        obj["title"] = bookmark.title;
+        obj["filePath"] = bookmark.filePath;
+        jsonArray.append(obj);
+    }
+
+    QSaveFile file(snapshotPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        qDebug() << "Не удалось открыть файл для записи:" << file.errorString();
+        return false;
+    }
+
+    const QByteArray data = QJsonDocument(jsonArray).toJson();
+    file.write(data);
+    if (!file.commit())
+    {
+        qDebug() << "Не удалось сохранить снимок закладок:" << file.errorString();
+        return false;
+    }
+    Metrics::bookmarkBytesWritten.add(data.size());
+
+    // Снимок уже содержит все изменения журнала. Если программа завершится до очистки журнала,
+    // его повторное применение ничего не изменит: добавление и удаление идемпотентны.
+    QFile journal(journalPath());
+    if (journal.exists() && !journal.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qDebug() << "Не удалось очистить журнал закладок:" << journal.errorString();
+    }
+    journalLength = 0;
+
+    return true;
+}
+
+/**
+ * @brief Добавляет закладку в память без записи в журнал.
+ */
+bool BookmarkStore::insert(const QString &title, const QString &filePath)
+{
+    if (filePath.isEmpty() || indexByPath.contains(filePath))
+    {
+        return false;
+    }
+
+    indexByPath.insert(filePath, entries.size());
+    entries.append(Bookmark{title, filePath});
+    return true;
+}
+
+/**
+ * @brief Удаляет закладку из памяти без записи в журнал.
+ *
+ * Запись в entries только помечается удаленной, чтобы не сдвигать остальные. Когда удаленных
+ * записей становится больше половины, массив уплотняется.
+ */
+bool BookmarkStore::erase(const QString &filePath)
+{
+    auto it = indexByPath.find(filePath);
+    if (it == indexByPath.end())
+    {
+        return false;
+    }
+
+    entries[it.value()] = Bookmark();
+    indexByPath.erase(it);
+    ++removedCount;
+
+    if (removedCount > entries.size() / 2)
+    {
+        packSlots();
+    }
+    return true;
+}
+
+/**
+ * @brief Уплотняет массив закладок, убирая удаленные записи, и перестраивает индекс.
+ */
+void BookmarkStore::packSlots()
+{
+    QVector<Bookmark> packed;
+    packed.reserve(indexByPath.size());
+    for (const Bookmark& bookmark : entries)
+    {
+        if (!bookmark.filePath.isEmpty())
+        {
+            indexByPath[bookmark.filePath] = packed.size();
+            packed.append(bookmark);
+        }
+    }
+    entries = packed;
+    removedCount = 0;
+}
+
+/**
+ * @brief Дописывает строку в журнал и сбрасывает его на диск.
+ */
+void BookmarkStore::appendJournal(const QByteArray &line)
+{
+    TraceSpan span("bookmarks.journal", "bookmarks");
+
+    if (snapshotPath.isEmpty())
+    {
+        return;
+    }
+
+    MetricsTimer timer(Metrics::bookmarksJournal);
+
+    QFile journal(journalPath());
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    {
+        qDebug() << "Не удалось открыть журнал закладок:" << journal.errorString();
+        return;
+    }
+
+    journal.write(line + '\n');
+    journal.flush();
+    journal.close();
+    timer.end();
+    Metrics::bookmarkBytesWritten.add(line.size() + 1);
+
+    if (++journalLength >= CompactionThreshold)
+    {
+        compact();
+    }
+}
+
+QString BookmarkStore::journalPath() const
+{
+    QString path = snapshotPath;
+    if (path.endsWith(".json"))
+    {
+        path.chop(5);
+    }
+    return path + ".journal";
+}
@@ -0,0 +1,94 @@
+#ifndef BOOKMARKSTORE_H
+#define BOOKMARKSTORE_H
+
+/**
+ * @file bookmarkstore.h
+ * @brief Определение класса BookmarkStore — хранилища закладок с журналом изменений.
+ *
+ * Закладки хранятся в снимке bookmarks.json (прежний формат: массив объектов "title"/"filePath")
+ * и в журнале bookmarks.journal, куда каждое добавление и удаление дописывается сразу же.
+ * При запуске загружается снимок и к нему применяется журнал, поэтому аварийное завершение
+ * программы не теряет изменения сеанса. Когда журнал разрастается, он сворачивается в новый
+ * снимок, который записывается атомарно через QSaveFile.
+ */
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * @class BookmarkStore
+ * @brief Закладки с поиском по пути за O(1) и сохранением порядка добавления.
+ */
+class BookmarkStore
+{
+public:
+    /// Закладка: название и путь к странице.
+    struct Bookmark
+    {
+        QString title;
+        QString filePath;
+    };
+
+    BookmarkStore() = default;
+
+    /**
+     * @brief Загружает снимок и применяет к нему журнал.
+     * @param snapshotPath Путь к файлу снимка (bookmarks.json). Журнал лежит рядом с расширением .journal.
+     * @return true, если снимок или журнал удалось прочитать.
+     */
+    bool load(const QString& snapshotPath);
+
+    /**
+     * @brief Проверяет, есть ли закладка на страницу.
+     * @param filePath Путь к странице.
+     */
+    bool contains(const QString& filePath) const { return indexByPath.contains(filePath); }
+
+    /**
+     * @brief Добавляет закладку и записывает изменение в журнал.
+     * @return false, если закладка на эту страницу уже есть.
+     */
+    bool add(const QString& title, const QString& filePath);
+
+    /**
+     * @brief Удаляет закладку и записывает изменение в журнал.
+     * @return false, если закладки на эту страницу нет.
+     */
+    bool remove(const QString& filePath);
+
+    /**
+     * @brief Возвращает закладки в порядке добавления.
+     */
+    QVector<Bookmark> items() const;
+
+    int size() const { return indexByPath.size(); }
+    bool isEmpty() const { return indexByPath.isEmpty(); }
+
+    /**
+     * @brief Сворачивает журнал в новый снимок.
+     *
+     * Снимок записывается через QSaveFile, и только после успешной записи журнал очищается.
+     * @return true при успешной записи.
+     */
+    bool compact();
+
+    /// Количество записей журнала, после которого он автоматически сворачивается в снимок.
+    static constexpr int CompactionThreshold = 256;
+
+private:
+    bool insert(const QString& title, const QString& filePath);
+    bool erase(const QString& filePath);
+    void appendJournal(const QByteArray& line);
+    void packSlots();
+
+    QString journalPath() const;
+
+    QVector<Bookmark> entries;       ///< Закладки в порядке добавления; удаленные помечены пустым путем.
+    QHash<QString, int> indexByPath; ///< Номер записи в entries по пути к странице.
+    int removedCount = 0;            ///< Количество пустых записей в entries.
+    int journalLength = 0;           ///< Количество записей в журнале после последнего снимка.
+    QString snapshotPath;
+};
+
+#endif // BOOKMARKSTORE_H
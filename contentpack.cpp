@@ -0,0 +1,224 @@
+/**
+ * @file contentpack.cpp
+ * @brief Реализация чтения и записи файла с содержимым справочника.
+ */
+
+#include "contentpack.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "Формат пакета содержимого рассчитан на little-endian");
+
+constexpr char kMagic[8] = {'P', 'P', 'H', 'P', 'A', 'C', 'K', '\0'};
+
+ContentPack& globalPack()
+{
+    static ContentPack pack;
+    return pack;
+}
+
+} // namespace
+
+struct ContentPack::Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 entryCount;
+    quint64 indexOffset;
+    quint64 namesOffset;
+};
+
+struct ContentPack::Record
+{
+    quint32 id;
+    quint32 nameOffset;     ///< Смещение имени от начала раздела имен.
+    quint32 nameLength;
+    quint32 reserved;
+    quint64 offset;         ///< Смещение сжатых данных от начала файла.
+    quint32 compressedSize;
+    quint32 rawSize;
+    quint64 hash;
+};
+
+bool ContentPack::open(const QString &packPath)
+{
+    static_assert(sizeof(Header) == 32, "Неожиданный размер заголовка пакета");
+    static_assert(sizeof(Record) == 40, "Неожиданный размер записи пакета");
+
+    QSharedPointer<QFile> packFile(new QFile(packPath));
+    if (!packFile->open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 packSize = packFile->size();
+    const uchar* mapped = packFile->map(0, packSize);
+    if (!mapped || packSize < qint64(sizeof(Header)))
+    {
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(mapped);
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != FormatVersion
+        || header->indexOffset + quint64(header->entryCount) * sizeof(Record) > header->namesOffset
+        || header->namesOffset > quint64(packSize))
+    {
+        qDebug() << "Файл пакета поврежден или имеет другую версию:" << packPath;
+        return false;
+    }
+
+    const Record* records = reinterpret_cast<const Record*>(mapped + header->indexOffset);
+    const char* names = reinterpret_cast<const char*>(mapped + header->namesOffset);
+    const quint64 namesSize = quint64(packSize) - header->namesOffset;
+
+    QHash<QString, int> byName;
+    byName.reserve(header->entryCount);
+    for (quint32 i = 0; i < header->entryCount; ++i)
+    {
+        const Record& entry = records[i];
+        if (quint64(entry.nameOffset) + entry.nameLength > namesSize
+            || entry.offset + entry.compressedSize > quint64(packSize))
+        {
+            qDebug() << "Файл пакета поврежден:" << packPath;
+            return false;
+        }
+        byName.insert(QString::fromUtf8(names + entry.nameOffset, int(entry.nameLength)), int(i));
+    }
+
+    file = packFile;
+    data = mapped;
+    size = packSize;
+    entriesByName = byName;
+    return true;
+}
+
+bool ContentPack::contains(const QString &filePath) const
+{
+    return entriesByName.contains(entryName(filePath));
+}
+
+QByteArray ContentPack::read(const QString &filePath) const
+{
+    const int index = entriesByName.value(entryName(filePath), -1);
+    if (index < 0)
+    {
+        return QByteArray();
+    }
+
+    const Record* entry = record(index);
+    QByteArray result = qUncompress(data + entry->offset, qsizetype(entry->compressedSize));
+    if (result.size() != qsizetype(entry->rawSize))
+    {
+        qDebug() << "Запись пакета повреждена:" << filePath;
+        return QByteArray();
+    }
+    return result;
+}
+
+quint64 ContentPack::contentHash(const QString &filePath) const
+{
+    const int index = entriesByName.value(entryName(filePath), -1);
+    return index < 0 ? 0 : record(index)->hash;
+}
+
+bool ContentPack::write(const QString &packPath, const QVector<Entry> &entries)
+{
+    QByteArray names;
+    QVector<QByteArray> blobs;
+    QVector<Record> records(entries.size());
+    blobs.reserve(entries.size());
+
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        const QByteArray name = entries[i].name.toUtf8();
+        Record& entry = records[i];
+        memset(&entry, 0, sizeof(entry));
+        entry.id = quint32(i);
+        entry.nameOffset = quint32(names.size());
+        entry.nameLength = quint32(name.size());
+        entry.rawSize = quint32(entries[i].data.size());
+        entry.hash = hashOf(entries[i].data);
+        names.append(name);
+
+        blobs.append(qCompress(entries[i].data, 9));
+        entry.compressedSize = quint32(blobs.last().size());
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = FormatVersion;
+    header.entryCount = quint32(entries.size());
+    header.indexOffset = sizeof(Header);
+    header.namesOffset = header.indexOffset + quint64(records.size()) * sizeof(Record);
+
+    quint64 offset = header.namesOffset + quint64(names.size());
+    for (int i = 0; i < records.size(); ++i)
+    {
+        records[i].offset = offset;
+        offset += records[i].compressedSize;
+    }
+
+    QSaveFile packFile(packPath);
+    if (!packFile.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Не удалось открыть файл пакета для записи:" << packFile.errorString();
+        return false;
+    }
+
+    packFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    packFile.write(reinterpret_cast<const char*>(records.constData()), records.size() * sizeof(Record));
+    packFile.write(names);
+    for (const QByteArray& blob : blobs)
+    {
+        packFile.write(blob);
+    }
+
+    return packFile.commit();
+}
+
+quint64 ContentPack::hashOf(const QByteArray &data)
+{
+    const QByteArray digest = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    return qFromBigEndian<quint64>(digest.constData());
+}
+
+QString ContentPack::entryName(const QString &filePath)
+{
+    if (filePath.startsWith(":/"))
+    {
+        return filePath.mid(2);
+    }
+    return filePath;
+}
+
+bool ContentPack::mount(const QString &packPath)
+{
+    if (!globalPack().open(packPath))
+    {
+        return false;
+    }
+
+    qDebug() << "Подключен пакет содержимого" << packPath << "записей:" << globalPack().count();
+    return true;
+}
+
+const ContentPack *ContentPack::mounted()
+{
+    const ContentPack& pack = globalPack();
+    return pack.isOpen() ? &pack : nullptr;
+}
+
+const ContentPack::Record *ContentPack::record(int index) const
+{
+    const Header* header = reinterpret_cast<const Header*>(data);
+    return reinterpret_cast<const Record*>(data + header->indexOffset) + index;
+}
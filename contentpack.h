@@ -0,0 +1,120 @@
+#ifndef CONTENTPACK_H
+#define CONTENTPACK_H
+
+/**
+ * @file contentpack.h
+ * @brief Определение класса ContentPack — единого сжатого файла с содержимым справочника.
+ *
+ * Вместо сборки каждой страницы в ресурсы программы страницы и data.json можно поставлять одним
+ * файлом handbook.pack. Файл отображается в память, и любая страница читается одним срезом
+ * отображения и одной распаковкой, поэтому изменение текста не требует пересборки программы.
+ *
+ * Формат файла (версия 1, little-endian):
+ * - заголовок: сигнатура "PPHPACK", версия, количество записей, смещения таблицы записей и имен;
+ * - таблица записей: номер, имя, смещение, сжатый и исходный размер, хеш содержимого;
+ * - имена записей в UTF-8 (например "data.json" или "texts/1.welcome.html");
+ * - сжатые qCompress данные записей.
+ */
+
+#include <QByteArray>
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+class QFile;
+
+/**
+ * @class ContentPack
+ * @brief Чтение и запись файла с содержимым справочника.
+ *
+ * Чтение из открытого пакета потокобезопасно: отображенная память только читается,
+ * поэтому страницы можно распаковывать из рабочих потоков.
+ */
+class ContentPack
+{
+public:
+    /// Запись, добавляемая в пакет при сборке.
+    struct Entry
+    {
+        QString name;   ///< Имя записи без префикса ":/".
+        QByteArray data;
+    };
+
+    /// Текущая версия формата пакета.
+    static constexpr quint32 FormatVersion = 1;
+
+    ContentPack() = default;
+
+    /**
+     * @brief Открывает пакет и отображает его в память.
+     * @param packPath Путь к файлу пакета.
+     * @return true, если пакет открыт и его заголовок корректен.
+     */
+    bool open(const QString& packPath);
+
+    bool isOpen() const { return data != nullptr; }
+
+    /**
+     * @brief Проверяет, есть ли в пакете запись для пути.
+     * @param filePath Путь из data.json (":/texts/...") или имя записи.
+     */
+    bool contains(const QString& filePath) const;
+
+    /**
+     * @brief Читает и распаковывает запись.
+     * @param filePath Путь из data.json (":/texts/...") или имя записи.
+     * @return Содержимое или пустой массив, если записи нет или она повреждена.
+     */
+    QByteArray read(const QString& filePath) const;
+
+    /**
+     * @brief Возвращает хеш содержимого записи (первые 8 байт SHA-1) или 0.
+     */
+    quint64 contentHash(const QString& filePath) const;
+
+    int count() const { return entriesByName.size(); }
+
+    /**
+     * @brief Записывает пакет.
+     * @param packPath Путь к файлу пакета.
+     * @param entries Записи в порядке номеров.
+     * @return true при успешной записи.
+     */
+    static bool write(const QString& packPath, const QVector<Entry>& entries);
+
+    /**
+     * @brief Вычисляет хеш содержимого так же, как SearchIndex::contentHash.
+     */
+    static quint64 hashOf(const QByteArray& data);
+
+    /**
+     * @brief Приводит путь к имени записи: ":/texts/a.html" -> "texts/a.html".
+     */
+    static QString entryName(const QString& filePath);
+
+    /**
+     * @brief Подключает пакет, из которого будут читаться страницы и data.json.
+     * @param packPath Путь к файлу пакета.
+     * @return true, если пакет открыт.
+     */
+    static bool mount(const QString& packPath);
+
+    /**
+     * @brief Возвращает подключенный пакет или nullptr.
+     */
+    static const ContentPack* mounted();
+
+private:
+    struct Header;
+    struct Record;
+
+    const Record* record(int index) const;
+
+    QSharedPointer<QFile> file;
+    const uchar* data = nullptr;
+    qint64 size = 0;
+    QHash<QString, int> entriesByName; ///< Номер записи по имени.
+};
+
+#endif // CONTENTPACK_H
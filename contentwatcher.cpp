@@ -0,0 +1,170 @@
+/**
+ * @file contentwatcher.cpp
+ * @brief Реализация режима разработки с чтением содержимого из каталога.
+ */
+
+#include "contentwatcher.h"
+#include "contentpack.h"
+#include "trace.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+
+#include <utility>
+
+namespace {
+
+/// Подключенный каталог содержимого. Задается до создания окна и дальше только читается.
+QString mountedDirectory;
+
+} // namespace
+
+ContentWatcher::ContentWatcher(const QString &rootDir, QObject *parent)
+    : QObject(parent)
+    , root(QDir(rootDir).absolutePath())
+    , catalogPath(QDir(rootDir).absoluteFilePath("data.json"))
+{
+    debounceTimer.setSingleShot(true);
+    debounceTimer.setInterval(DefaultDebounceMs);
+    connect(&debounceTimer, &QTimer::timeout, this, &ContentWatcher::flush);
+
+    connect(&watcher, &QFileSystemWatcher::fileChanged, this, &ContentWatcher::onFileChanged);
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, this, [this]() {
+        directoryChanged = true;
+        debounceTimer.start();
+    });
+
+    watcher.addPath(catalogPath);
+    const QString textsDir = QDir(root).filePath("texts");
+    if (QFileInfo(textsDir).isDir())
+    {
+        watcher.addPath(textsDir);
+    }
+}
+
+void ContentWatcher::watchPages(const QStringList &filePaths)
+{
+    if (!watcher.files().isEmpty())
+    {
+        watcher.removePaths(watcher.files());
+    }
+    pagesByLocalPath.clear();
+    pagesByLocalPath.reserve(filePaths.size());
+
+    QStringList localPaths;
+    localPaths.reserve(filePaths.size() + 1);
+    localPaths.append(catalogPath);
+    for (const QString& filePath : filePaths)
+    {
+        const QString path = QDir(root).filePath(ContentPack::entryName(filePath));
+        pagesByLocalPath.insert(path, filePath);
+        localPaths.append(path);
+    }
+
+    const QStringList failed = watcher.addPaths(localPaths);
+    if (!failed.isEmpty())
+    {
+        // Обычно это предел inotify (fs.inotify.max_user_watches); такие страницы не обновляются сами.
+        qDebug() << "Не удалось следить за файлами содержимого:" << failed.size();
+    }
+}
+
+bool ContentWatcher::mount(const QString &rootDir)
+{
+    if (!QFileInfo(QDir(rootDir).filePath("data.json")).isFile())
+    {
+        qDebug() << "В каталоге содержимого нет data.json:" << rootDir;
+        return false;
+    }
+    mountedDirectory = QDir(rootDir).absolutePath();
+    return true;
+}
+
+QString ContentWatcher::mountedRoot()
+{
+    return mountedDirectory;
+}
+
+QString ContentWatcher::localPath(const QString &filePath)
+{
+    if (mountedDirectory.isEmpty())
+    {
+        return QString();
+    }
+    return QDir(mountedDirectory).filePath(ContentPack::entryName(filePath));
+}
+
+void ContentWatcher::onFileChanged(const QString &path)
+{
+    changedFiles.insert(path);
+    debounceTimer.start();
+}
+
+/**
+ * @brief Разбирает серию событий и посылает сигналы об измененных файлах.
+ *
+ * Файл, замененный переименованием, QFileSystemWatcher перестает отслеживать. Если такой файл
+ * снова существует, он берется под наблюдение и тоже считается измененным.
+ */
+void ContentWatcher::flush()
+{
+    TraceSpan span("content.changed", "content");
+
+    if (directoryChanged)
+    {
+        directoryChanged = false;
+        const QStringList watchedList = watcher.files();
+        const QSet<QString> watched(watchedList.cbegin(), watchedList.cend());
+        QStringList restored;
+        for (auto it = pagesByLocalPath.cbegin(); it != pagesByLocalPath.cend(); ++it)
+        {
+            if (!watched.contains(it.key()) && QFileInfo::exists(it.key()))
+            {
+                restored.append(it.key());
+                changedFiles.insert(it.key());
+            }
+        }
+        if (!watched.contains(catalogPath) && QFileInfo::exists(catalogPath))
+        {
+            restored.append(catalogPath);
+            changedFiles.insert(catalogPath);
+        }
+        if (!restored.isEmpty())
+        {
+            watcher.addPaths(restored);
+        }
+    }
+
+    // Файл, удаленный при замене, но еще не созданный заново, вернется событием каталога.
+    const QStringList watchedList = watcher.files();
+    for (const QString& path : std::as_const(changedFiles))
+    {
+        if (!watchedList.contains(path) && QFileInfo::exists(path))
+        {
+            watcher.addPath(path);
+        }
+    }
+
+    const bool catalog = changedFiles.remove(catalogPath);
+    QStringList pages;
+    for (const QString& path : std::as_const(changedFiles))
+    {
+        const QString filePath = pagesByLocalPath.value(path);
+        if (!filePath.isEmpty())
+        {
+            pages.append(filePath);
+        }
+    }
+    changedFiles.clear();
+    span.setDetail(QString::number(pages.size()) + (catalog ? " pages + data.json" : " pages"));
+
+    if (catalog)
+    {
+        emit catalogChanged();
+    }
+    if (!pages.isEmpty())
+    {
+        emit pagesChanged(pages);
+    }
+}
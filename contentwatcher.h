@@ -0,0 +1,101 @@
+#ifndef CONTENTWATCHER_H
+#define CONTENTWATCHER_H
+
+/**
+ * @file contentwatcher.h
+ * @brief Определение класса ContentWatcher — режима разработки с чтением содержимого из каталога.
+ *
+ * Если переменная окружения HANDBOOK_CONTENT_DIR указывает на каталог с data.json и texts/,
+ * программа читает оглавление и страницы из него, а не из ресурсов или пакета, и следит за их
+ * изменением через QFileSystemWatcher. Изменение страницы не требует ни пересборки resources.qrc,
+ * ни перезапуска: заново читается и разбирается только измененная страница.
+ */
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+/**
+ * @class ContentWatcher
+ * @brief Наблюдение за data.json и страницами каталога содержимого с объединением частых событий.
+ *
+ * Редакторы сохраняют файл по-разному: записью поверх, заменой через временный файл или несколькими
+ * записями подряд. События собираются в течение debounceInterval() после последнего из них, и
+ * сигналы посылаются один раз на всю серию. Файлы, замененные переименованием, выпадают из
+ * QFileSystemWatcher; их снова берет под наблюдение событие каталога texts/.
+ */
+class ContentWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Интервал объединения событий по умолчанию в миллисекундах.
+    static constexpr int DefaultDebounceMs = 200;
+
+    /**
+     * @brief Конструктор. Начинает наблюдение за data.json и каталогом texts/.
+     * @param rootDir Каталог содержимого.
+     * @param parent Родительский объект.
+     */
+    explicit ContentWatcher(const QString& rootDir, QObject* parent = nullptr);
+
+    /**
+     * @brief Задает страницы, за которыми нужно следить (пути из data.json).
+     */
+    void watchPages(const QStringList& filePaths);
+
+    /**
+     * @brief Задает интервал объединения событий. 0 — сигнал посылается на ближайшей итерации цикла событий.
+     */
+    void setDebounceInterval(int msec) { debounceTimer.setInterval(qMax(0, msec)); }
+    int debounceInterval() const { return debounceTimer.interval(); }
+
+    /**
+     * @brief Подключает каталог содержимого для loadTextFromFile и оглавления.
+     * @param rootDir Каталог с data.json и texts/.
+     * @return true, если в каталоге есть data.json.
+     */
+    static bool mount(const QString& rootDir);
+
+    /**
+     * @brief Возвращает подключенный каталог содержимого или пустую строку.
+     */
+    static QString mountedRoot();
+
+    /**
+     * @brief Возвращает путь к файлу страницы в подключенном каталоге.
+     * @param filePath Путь из data.json (":/texts/...").
+     * @return Путь на диске или пустая строка, если каталог не подключен.
+     */
+    static QString localPath(const QString& filePath);
+
+signals:
+    /**
+     * @brief Сигнал об изменении data.json.
+     */
+    void catalogChanged();
+
+    /**
+     * @brief Сигнал об изменении страниц.
+     * @param filePaths Пути измененных страниц из data.json.
+     */
+    void pagesChanged(const QStringList& filePaths);
+
+private:
+    void onFileChanged(const QString& path);
+    void flush();
+
+    QString root;
+    QString catalogPath;
+    QFileSystemWatcher watcher;
+    QHash<QString, QString> pagesByLocalPath; ///< Путь из data.json по пути файла на диске.
+    QSet<QString> changedFiles;               ///< Измененные файлы текущей серии событий.
+    bool directoryChanged = false;            ///< В серии было событие каталога texts/.
+    QTimer debounceTimer;
+};
+
+#endif // CONTENTWATCHER_H
@@ -0,0 +1,70 @@
+/**
+ * @file diagnosticsdialog.cpp
+ * @brief Реализация окна диагностики.
+ */
+
+#include "diagnosticsdialog.h"
+#include "metrics.h"
+
+#include <QClipboard>
+#include <QDialogButtonBox>
+#include <QFontDatabase>
+#include <QGuiApplication>
+#include <QJsonDocument>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QVBoxLayout>
+
+DiagnosticsDialog::DiagnosticsDialog(QWidget *parent)
+    : QDialog(parent)
+    , metricsView(new QPlainTextEdit(this))
+{
+    setWindowTitle("Диагностика");
+
+    metricsView->setReadOnly(true);
+    metricsView->setLineWrapMode(QPlainTextEdit::NoWrap);
+    metricsView->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    QPushButton* copyButton = buttons->addButton("Копировать JSON", QDialogButtonBox::ActionRole);
+    connect(copyButton, &QPushButton::clicked, this, &DiagnosticsDialog::copyJson);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(6, 6, 6, 6);
+    layout->addWidget(metricsView);
+    layout->addWidget(buttons);
+
+    refreshTimer.setInterval(RefreshIntervalMs);
+    connect(&refreshTimer, &QTimer::timeout, this, &DiagnosticsDialog::refresh);
+
+    resize(640, 420);
+}
+
+void DiagnosticsDialog::showEvent(QShowEvent *event)
+{
+    refresh();
+    refreshTimer.start();
+    QDialog::showEvent(event);
+}
+
+void DiagnosticsDialog::hideEvent(QHideEvent *event)
+{
+    // Закрытое окно не пересчитывает процентили впустую.
+    refreshTimer.stop();
+    QDialog::hideEvent(event);
+}
+
+void DiagnosticsDialog::refresh()
+{
+    // Обновление не сбрасывает прокрутку, если таблица не помещается в окно.
+    const int scroll = metricsView->verticalScrollBar()->value();
+    metricsView->setPlainText(Metrics::formatText());
+    metricsView->verticalScrollBar()->setValue(scroll);
+}
+
+void DiagnosticsDialog::copyJson()
+{
+    QGuiApplication::clipboard()->setText(QString::fromUtf8(QJsonDocument(Metrics::snapshot()).toJson()));
+}
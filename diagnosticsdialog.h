@@ -0,0 +1,42 @@
+#ifndef DIAGNOSTICSDIALOG_H
+#define DIAGNOSTICSDIALOG_H
+
+/**
+ * @file diagnosticsdialog.h
+ * @brief Определение класса DiagnosticsDialog — скрытого окна диагностики (Ctrl+Shift+D).
+ *
+ * Окно показывает снимок метрик Metrics: время загрузки, чтения, разбора и верстки страниц,
+ * попадания в кэш страниц, занятую документами память и работу с файлами закладок.
+ */
+
+#include <QDialog>
+#include <QTimer>
+
+class QPlainTextEdit;
+
+/**
+ * @class DiagnosticsDialog
+ * @brief Таблица метрик, которая обновляется раз в секунду, пока окно открыто.
+ */
+class DiagnosticsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    static constexpr int RefreshIntervalMs = 1000;
+
+    explicit DiagnosticsDialog(QWidget* parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private:
+    void refresh();
+    void copyJson();
+
+    QPlainTextEdit* metricsView;
+    QTimer refreshTimer;
+};
+
+#endif // DIAGNOSTICSDIALOG_H
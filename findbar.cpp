@@ -0,0 +1,179 @@
+/**
+ * @file findbar.cpp
+ * @brief Реализация панели поиска по странице.
+ */
+
+#include "findbar.h"
+
+#include <QHBoxLayout>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QToolButton>
+
+FindBar::FindBar(QWidget *parent)
+    : QWidget(parent)
+    , queryEdit(new QLineEdit(this))
+    , counterLabel(new QLabel(this))
+    , previousButton(new QToolButton(this))
+    , nextButton(new QToolButton(this))
+    , closeButton(new QToolButton(this))
+{
+    queryEdit->setPlaceholderText("Найти на странице");
+    queryEdit->setClearButtonEnabled(true);
+    queryEdit->installEventFilter(this);
+
+    // Ширина счетчика не меняется вместе с числами, чтобы строка запроса не прыгала при наборе.
+    counterLabel->setMinimumWidth(counterLabel->fontMetrics().horizontalAdvance("99999 из 99999"));
+    counterLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+
+    previousButton->setArrowType(Qt::UpArrow);
+    previousButton->setToolTip("Предыдущее совпадение (Shift+Enter)");
+    nextButton->setArrowType(Qt::DownArrow);
+    nextButton->setToolTip("Следующее совпадение (Enter)");
+    closeButton->setText("✕");
+    closeButton->setToolTip("Закрыть (Esc)");
+    for (QToolButton* button : {previousButton, nextButton, closeButton})
+    {
+        button->setAutoRaise(true);
+        button->setFocusPolicy(Qt::NoFocus);
+    }
+
+    QHBoxLayout* layout = new QHBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(queryEdit, 1);
+    layout->addWidget(counterLabel);
+    layout->addWidget(previousButton);
+    layout->addWidget(nextButton);
+    layout->addWidget(closeButton);
+
+    connect(queryEdit, &QLineEdit::textChanged, this, [this](const QString& text) {
+        if (finder)
+        {
+            finder->setQuery(text);
+        }
+    });
+    connect(previousButton, &QToolButton::clicked, this, [this]() {
+        if (finder)
+        {
+            finder->findPrevious();
+        }
+    });
+    connect(nextButton, &QToolButton::clicked, this, [this]() {
+        if (finder)
+        {
+            finder->findNext();
+        }
+    });
+    connect(closeButton, &QToolButton::clicked, this, &FindBar::dismiss);
+
+    // Панель появляется только по Ctrl+F.
+    hide();
+}
+
+void FindBar::setFinder(PageFinder *finder)
+{
+    if (this->finder == finder)
+    {
+        return;
+    }
+
+    if (this->finder)
+    {
+        disconnect(this->finder, nullptr, this, nullptr);
+    }
+    this->finder = finder;
+    if (finder)
+    {
+        connect(finder, &PageFinder::resultsChanged, this, &FindBar::updateCounter);
+
+        // Открытая панель продолжает поиск и в другой вкладке.
+        if (isVisible() && finder->query().isEmpty())
+        {
+            finder->setQuery(queryEdit->text());
+        }
+
+        if (!finder->query().isEmpty())
+        {
+            const QSignalBlocker blocker(queryEdit);
+            queryEdit->setText(finder->query());
+        }
+    }
+    updateCounter();
+}
+
+void FindBar::activate()
+{
+    show();
+    if (finder && finder->query().isEmpty())
+    {
+        finder->setQuery(queryEdit->text());
+    }
+    queryEdit->selectAll();
+    queryEdit->setFocus();
+}
+
+bool FindBar::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == queryEdit && event->type() == QEvent::KeyPress && finder)
+    {
+        const QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
+        switch (keyEvent->key())
+        {
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            if (keyEvent->modifiers() & Qt::ShiftModifier)
+            {
+                finder->findPrevious();
+            }
+            else
+            {
+                finder->findNext();
+            }
+            return true;
+        case Qt::Key_Escape:
+            dismiss();
+            return true;
+        default:
+            break;
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+/**
+ * @brief Скрывает панель и убирает подсветку. Запрос остается в строке до следующего Ctrl+F.
+ */
+void FindBar::dismiss()
+{
+    if (finder)
+    {
+        finder->clear();
+    }
+    hide();
+    emit closed();
+}
+
+void FindBar::updateCounter()
+{
+    if (!finder || finder->query().isEmpty())
+    {
+        counterLabel->clear();
+    }
+    else if (finder->isSearching() && finder->matchCount() == 0)
+    {
+        counterLabel->setText("…");
+    }
+    else if (finder->matchCount() == 0)
+    {
+        counterLabel->setText("Нет совпадений");
+    }
+    else
+    {
+        counterLabel->setText(QString("%1 из %2").arg(finder->currentMatch() + 1).arg(finder->matchCount()));
+    }
+
+    const bool hasMatches = finder && finder->matchCount() > 0;
+    previousButton->setEnabled(hasMatches);
+    nextButton->setEnabled(hasMatches);
+}
@@ -0,0 +1,69 @@
+#ifndef FINDBAR_H
+#define FINDBAR_H
+
+/**
+ * @file findbar.h
+ * @brief Определение класса FindBar — панели поиска по странице (Ctrl+F).
+ *
+ * Панель одна на окно и управляет поиском текущей вкладки: у каждой вкладки свой PageFinder
+ * со своим запросом и совпадениями, и при смене вкладки панель переключается на ее поиск.
+ */
+
+#include <QPointer>
+#include <QWidget>
+
+#include "pagefinder.h"
+
+class QLabel;
+class QLineEdit;
+class QToolButton;
+
+/**
+ * @class FindBar
+ * @brief Строка запроса, счетчик «n из m» и кнопки перехода между совпадениями.
+ *
+ * Enter переходит к следующему совпадению, Shift+Enter — к предыдущему, Esc закрывает панель
+ * и убирает подсветку. Поиск запускается на каждое изменение запроса.
+ */
+class FindBar : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FindBar(QWidget* parent = nullptr);
+
+    /**
+     * @brief Переключает панель на поиск другой вкладки.
+     * @param finder Поиск текущей вкладки.
+     */
+    void setFinder(PageFinder* finder);
+
+    /**
+     * @brief Показывает панель и выделяет запрос, чтобы его можно было сразу заменить.
+     *
+     * Если у вкладки еще нет запроса, ищется текст, оставшийся в строке с прошлого поиска.
+     */
+    void activate();
+
+signals:
+    /**
+     * @brief Сигнал о закрытии панели: фокус возвращается странице.
+     */
+    void closed();
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+    void dismiss();
+    void updateCounter();
+
+    QPointer<PageFinder> finder;
+    QLineEdit* queryEdit;
+    QLabel* counterLabel;
+    QToolButton* previousButton;
+    QToolButton* nextButton;
+    QToolButton* closeButton;
+};
+
+#endif // FINDBAR_H
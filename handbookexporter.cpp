@@ -0,0 +1,463 @@
+/**
+ * @file handbookexporter.cpp
+ * @brief Реализация пакетного экспорта справочника.
+ */
+
+#include "handbookexporter.h"
+#include "contentpack.h"
+#include "mainwindow.h"
+#include "pythonhighlighter.h"
+#include "searchindex.h"
+#include "toc_generated.h"
+#include "tocmodel.h"
+#include "trace.h"
+
+#include <QAbstractTextDocumentLayout>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMimeDatabase>
+#include <QPdfWriter>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QTextCursor>
+#include <QTextDocumentFragment>
+#include <QTextStream>
+#include <QTextTable>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+namespace {
+
+const QString HandbookTitle = QStringLiteral("Справочник по языку программирования Python");
+
+/// Страница, обрабатываемая одной задачей пула.
+struct ExportTask
+{
+    int row;
+    QString title;
+    QString filePath;
+    QString error;                          ///< Пустая строка, если страница экспортирована.
+    QSharedPointer<QTextDocument> document; ///< Разобранная страница для сборки общего PDF.
+};
+
+/**
+ * @brief Возвращает путь к результату внутри каталога экспорта, повторяя путь страницы.
+ * @param outDir Каталог экспорта.
+ * @param filePath Путь к странице из оглавления.
+ * @param suffix Новое расширение файла с точкой или пустая строка, чтобы оставить прежнее.
+ */
+QString outputPath(const QDir& outDir, const QString& filePath, const QString& suffix)
+{
+    QString name = ContentPack::entryName(filePath);
+    if (QDir::isAbsolutePath(name))
+    {
+        name = QFileInfo(name).fileName();
+    }
+    if (!suffix.isEmpty())
+    {
+        const QFileInfo info(name);
+        name = info.path() + '/' + info.completeBaseName() + suffix;
+    }
+
+    const QString path = QDir::cleanPath(outDir.filePath(name));
+    QDir().mkpath(QFileInfo(path).path());
+    return path;
+}
+
+/**
+ * @brief Находит файл изображения так же, как документ страницы в программе:
+ * относительно текущего каталога или каталога программы.
+ */
+QString resolveImage(const QString& source)
+{
+    if (source.startsWith("data:") || (source.contains("://") && !source.startsWith("file:")
+                                       && !source.startsWith("qrc:")))
+    {
+        return QString();
+    }
+
+    QString path = source;
+    if (source.startsWith("qrc:"))
+    {
+        path = source.mid(3);
+    }
+    else if (source.startsWith("file:"))
+    {
+        path = QUrl(source).toLocalFile();
+    }
+
+    if (QFileInfo::exists(path))
+    {
+        return path;
+    }
+
+    const QString besideProgram = QDir(QCoreApplication::applicationDirPath()).filePath(path);
+    return QFileInfo::exists(besideProgram) ? besideProgram : QString();
+}
+
+/**
+ * @brief Делает страницу самостоятельной: изображения встраиваются как data: URL,
+ * а кодировка указывается явно.
+ */
+QString standaloneHtml(const QString& html)
+{
+    static const QRegularExpression imageSource("(<img\\b[^>]*?\\bsrc\\s*=\\s*)([\"'])([^\"']+)\\2",
+                                                QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression headOpen("<head[^>]*>", QRegularExpression::CaseInsensitiveOption);
+    static const QMimeDatabase mimeDatabase;
+
+    QString result;
+    result.reserve(html.size());
+
+    qsizetype last = 0;
+    QRegularExpressionMatchIterator images = imageSource.globalMatch(html);
+    while (images.hasNext())
+    {
+        const QRegularExpressionMatch match = images.next();
+        const QString path = resolveImage(match.captured(3));
+        if (path.isEmpty())
+        {
+            continue;
+        }
+
+        QFile image(path);
+        if (!image.open(QIODevice::ReadOnly))
+        {
+            continue;
+        }
+
+        const QString mimeType = mimeDatabase.mimeTypeForFile(path).name();
+        result += html.mid(last, match.capturedStart(3) - last);
+        result += "data:" + mimeType + ";base64," + QString::fromLatin1(image.readAll().toBase64());
+        last = match.capturedEnd(3);
+    }
+    result += html.mid(last);
+
+    if (!result.contains("charset", Qt::CaseInsensitive))
+    {
+        const QRegularExpressionMatch head = headOpen.match(result);
+        const QString meta = "<meta charset=\"utf-8\">";
+        if (head.hasMatch())
+        {
+            result.insert(head.capturedEnd(), meta);
+        }
+        else
+        {
+            result.prepend("<!DOCTYPE html>\n<html><head>" + meta + "</head>");
+            result += "</html>";
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Настраивает печать: A4, поля 15 мм. Разрешение 96 точек на дюйм выбрано, чтобы размеры
+ * в пикселях из стилей страниц печатались так же, как выглядят на экране.
+ */
+void setupWriter(QPdfWriter& writer, const QString& title)
+{
+    writer.setResolution(96);
+    writer.setPageSize(QPageSize(QPageSize::A4));
+    writer.setPageMargins(QMarginsF(15, 15, 15, 15), QPageLayout::Millimeter);
+    writer.setTitle(title);
+    writer.setCreator(QCoreApplication::applicationName());
+}
+
+/**
+ * @brief Разбирает страницу в документ с подсветкой примеров кода.
+ */
+QSharedPointer<QTextDocument> parsePage(const QString& html)
+{
+    QSharedPointer<QTextDocument> document(new QTextDocument);
+    document->setUndoRedoEnabled(false);
+    document->setHtml(html);
+    PythonHighlighter::highlightDocument(document.data(), SearchIndex::contentHash(html));
+    return document;
+}
+
+void exportPage(ExportTask& task, const QString& format, const QDir& outDir, bool merge)
+{
+    TraceSpan span("export.page", "export");
+    span.setDetail(task.filePath);
+
+    const QString html = MainWindow::loadTextFromFile(task.filePath);
+    if (html.isEmpty())
+    {
+        task.error = "не удалось прочитать страницу";
+        return;
+    }
+
+    if (format == "html")
+    {
+        QSaveFile file(outputPath(outDir, task.filePath, QString()));
+        const QByteArray data = standaloneHtml(html).toUtf8();
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+        {
+            task.error = "не удалось записать " + file.fileName() + ": " + file.errorString();
+        }
+        return;
+    }
+
+    QSharedPointer<QTextDocument> document = parsePage(html);
+    if (merge)
+    {
+        // Документ дописывается в общий PDF в главном потоке.
+        document->moveToThread(QCoreApplication::instance()->thread());
+        task.document = document;
+        return;
+    }
+
+    const QString path = outputPath(outDir, task.filePath, ".pdf");
+    {
+        QPdfWriter writer(path);
+        setupWriter(writer, task.title);
+        document->print(&writer);
+    }
+    if (QFileInfo(path).size() <= 0)
+    {
+        task.error = "не удалось записать " + path;
+    }
+}
+
+/**
+ * @brief Собирает все страницы в один PDF: оглавление с номерами страниц, затем разделы,
+ * каждый с новой страницы.
+ *
+ * Страницы разбираются параллельно порциями, а дописываются в общий документ по порядку,
+ * поэтому одновременно в памяти держится только одна порция разобранных страниц.
+ */
+bool exportMerged(QVector<ExportTask>& tasks, const QDir& outDir)
+{
+    const QString path = outDir.filePath("handbook.pdf");
+    QPdfWriter writer(path);
+    setupWriter(writer, HandbookTitle);
+
+    // Документ верстается сразу под страницы PDF, чтобы номера страниц в оглавлении совпали с печатью.
+    QTextDocument book;
+    book.setUndoRedoEnabled(false);
+    book.documentLayout()->setPaintDevice(&writer);
+    book.setPageSize(QSizeF(writer.width(), writer.height()));
+
+    QTextCursor cursor(&book);
+    QTextCharFormat titleFormat;
+    titleFormat.setFontPointSize(24);
+    titleFormat.setFontWeight(QFont::Bold);
+    cursor.insertText(HandbookTitle, titleFormat);
+
+    QTextBlockFormat headingBlock;
+    headingBlock.setTopMargin(24);
+    headingBlock.setBottomMargin(12);
+    QTextCharFormat headingFormat;
+    headingFormat.setFontPointSize(18);
+    headingFormat.setFontWeight(QFont::Bold);
+    cursor.insertBlock(headingBlock, headingFormat);
+    cursor.insertText("Содержание");
+
+    QTextTableFormat tableFormat;
+    tableFormat.setBorder(0);
+    tableFormat.setCellPadding(2);
+    tableFormat.setWidth(QTextLength(QTextLength::PercentageLength, 100));
+    tableFormat.setColumnWidthConstraints({QTextLength(QTextLength::PercentageLength, 88),
+                                           QTextLength(QTextLength::PercentageLength, 12)});
+    QTextTable* contents = cursor.insertTable(tasks.size(), 2, tableFormat);
+    for (int i = 0; i < tasks.size(); ++i)
+    {
+        contents->cellAt(i, 0).firstCursorPosition().insertText(tasks[i].title, QTextCharFormat());
+    }
+
+    QTextBlockFormat sectionBreak;
+    sectionBreak.setPageBreakPolicy(QTextFormat::PageBreak_AlwaysBefore);
+
+    QVector<int> sectionStarts(tasks.size(), -1);
+    const int batchSize = qMax(1, QThreadPool::globalInstance()->maxThreadCount() * 4);
+    for (int batchStart = 0; batchStart < tasks.size(); batchStart += batchSize)
+    {
+        const int batchEnd = qMin<int>(batchStart + batchSize, tasks.size());
+        auto first = tasks.begin() + batchStart;
+        auto last = tasks.begin() + batchEnd;
+        QtConcurrent::blockingMap(first, last, [&outDir](ExportTask& task) {
+            exportPage(task, "pdf", outDir, true);
+        });
+
+        TraceSpan appendSpan("export.append", "export");
+        for (auto it = first; it != last; ++it)
+        {
+            if (!it->document)
+            {
+                continue;
+            }
+
+            cursor = QTextCursor(book.rootFrame()->lastCursorPosition());
+            cursor.insertBlock(QTextBlockFormat(), QTextCharFormat());
+            const int start = cursor.position();
+            cursor.insertFragment(QTextDocumentFragment(it->document.data()));
+            it->document.clear();
+
+            // Разрыв страницы задается после вставки: первый блок раздела получает формат из фрагмента.
+            QTextCursor sectionCursor(book.findBlock(start));
+            sectionCursor.mergeBlockFormat(sectionBreak);
+            sectionStarts[it - tasks.begin()] = start;
+        }
+    }
+
+    TraceSpan layoutSpan("export.layout", "export");
+    const qreal pageHeight = book.pageSize().height();
+    QVector<int> pageNumbers(tasks.size(), 0);
+    for (int i = 0; i < tasks.size(); ++i)
+    {
+        if (sectionStarts[i] >= 0)
+        {
+            const QRectF rect = book.documentLayout()->blockBoundingRect(book.findBlock(sectionStarts[i]));
+            pageNumbers[i] = int(rect.top() / pageHeight) + 1;
+        }
+    }
+
+    // Номера занимают отдельную колонку таблицы, поэтому их вставка не меняет разбиение на страницы.
+    QTextBlockFormat numberBlock;
+    numberBlock.setAlignment(Qt::AlignRight);
+    for (int i = 0; i < tasks.size(); ++i)
+    {
+        if (pageNumbers[i] > 0)
+        {
+            QTextCursor cell = contents->cellAt(i, 1).firstCursorPosition();
+            cell.setBlockFormat(numberBlock);
+            cell.insertText(QString::number(pageNumbers[i]), QTextCharFormat());
+        }
+    }
+    layoutSpan.end();
+
+    TraceSpan printSpan("export.print", "export");
+    book.print(&writer);
+    return book.pageCount() > 0;
+}
+
+} // namespace
+
+bool HandbookExporter::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (qstrcmp(argv[i], "--export") == 0 || qstrncmp(argv[i], "--export=", 9) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HandbookExporter::loadCatalog(TocModel *toc)
+{
+    const ContentPack* pack = ContentPack::mounted();
+    if (pack && pack->contains(":/data.json"))
+    {
+        const QJsonDocument jsonDoc = QJsonDocument::fromJson(pack->read(":/data.json"));
+        if (!jsonDoc.isArray())
+        {
+            qDebug() << "Файл data.json из пакета содержимого не является JSON массивом";
+            return false;
+        }
+        toc->loadFromJson(jsonDoc.array());
+        return true;
+    }
+
+    toc->loadFromTable(GeneratedToc::entries, GeneratedToc::pathOrder, GeneratedToc::count);
+    return true;
+}
+
+int HandbookExporter::run(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Пакетный экспорт страниц справочника");
+    parser.addHelpOption();
+    parser.addOption({"export", "Формат экспорта: pdf или html.", "format"});
+    parser.addOption({"out", "Каталог для результатов.", "dir"});
+    parser.addOption({"merge", "Собрать все страницы в один handbook.pdf с оглавлением."});
+    parser.addOption({"jobs", "Количество потоков (по умолчанию — все ядра).", "count"});
+    parser.addOption({"trace", "Файл трассировки.", "file"});
+    parser.process(arguments);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const QString format = parser.value("export").toLower();
+    const QString outPath = parser.value("out");
+    const bool merge = parser.isSet("merge");
+    if ((format != "pdf" && format != "html") || outPath.isEmpty())
+    {
+        err << "Использование: --export pdf|html --out <каталог> [--merge] [--jobs N]" << Qt::endl;
+        return 2;
+    }
+    if (merge && format != "pdf")
+    {
+        err << "--merge поддерживается только для --export pdf" << Qt::endl;
+        return 2;
+    }
+
+    const int jobs = parser.value("jobs").toInt();
+    if (jobs > 0)
+    {
+        QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+    }
+
+    const QDir outDir(outPath);
+    if (!QDir().mkpath(outDir.absolutePath()))
+    {
+        err << "Не удалось создать каталог " << outPath << Qt::endl;
+        return 1;
+    }
+
+    TocModel toc;
+    if (!loadCatalog(&toc))
+    {
+        return 1;
+    }
+
+    QVector<ExportTask> tasks;
+    tasks.reserve(toc.rowCount());
+    for (int row = 0; row < toc.rowCount(); ++row)
+    {
+        tasks.append({row, toc.title(row), toc.filePath(row), QString(), {}});
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    bool mergedOk = true;
+    if (merge)
+    {
+        mergedOk = exportMerged(tasks, outDir);
+    }
+    else
+    {
+        QtConcurrent::blockingMap(tasks, [&format, &outDir](ExportTask& task) {
+            exportPage(task, format, outDir, false);
+        });
+    }
+
+    int failed = 0;
+    for (const ExportTask& task : tasks)
+    {
+        if (!task.error.isEmpty())
+        {
+            err << task.filePath << ": " << task.error << Qt::endl;
+            ++failed;
+        }
+    }
+    if (!mergedOk)
+    {
+        err << "Не удалось записать " << outDir.filePath("handbook.pdf") << Qt::endl;
+    }
+
+    out << "Экспортировано страниц: " << tasks.size() - failed << " из " << tasks.size()
+        << " за " << QString::number(timer.elapsed() / 1000.0, 'f', 1) << " с, потоков: "
+        << QThreadPool::globalInstance()->maxThreadCount() << Qt::endl;
+
+    return failed == 0 && mergedOk ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+#ifndef HANDBOOKEXPORTER_H
+#define HANDBOOKEXPORTER_H
+
+/**
+ * @file handbookexporter.h
+ * @brief Определение класса HandbookExporter — пакетного экспорта справочника без окна.
+ *
+ * Режим включается параметром --export:
+ *     PythonProgrammingHandbook --export pdf|html --out <каталог> [--merge] [--jobs N]
+ *
+ * Программа запускается на QGuiApplication с платформой offscreen, загружает оглавление так же,
+ * как главное окно (из подключенного пакета содержимого или собранной в программу таблицы),
+ * и обрабатывает все страницы параллельно:
+ * - pdf — каждая страница печатается в свой PDF через QTextDocument::print и QPdfWriter;
+ * - html — каждая страница записывается самостоятельным HTML файлом со встроенными изображениями;
+ * - pdf --merge — все страницы собираются в один handbook.pdf с оглавлением и номерами страниц.
+ */
+
+#include <QStringList>
+
+class TocModel;
+
+/**
+ * @class HandbookExporter
+ * @brief Экспорт всех страниц справочника в PDF или HTML.
+ */
+class HandbookExporter
+{
+public:
+    /**
+     * @brief Проверяет, запрошен ли экспорт параметрами командной строки.
+     *
+     * Вызывается до создания QApplication, чтобы выбрать QGuiApplication и платформу offscreen.
+     */
+    static bool isRequested(int argc, char* argv[]);
+
+    /**
+     * @brief Выполняет экспорт.
+     * @param arguments Параметры командной строки (QCoreApplication::arguments()).
+     * @return Код завершения программы: 0, если все страницы экспортированы.
+     */
+    static int run(const QStringList& arguments);
+
+    /**
+     * @brief Загружает оглавление так же, как главное окно: data.json из подключенного пакета
+     * содержимого или таблицу, собранную в программу.
+     * @param toc Модель оглавления.
+     * @return false, если data.json из пакета не удалось разобрать.
+     */
+    static bool loadCatalog(TocModel* toc);
+};
+
+#endif // HANDBOOKEXPORTER_H
@@ -0,0 +1,620 @@
+/**
+ * @file handbookverifier.cpp
+ * @brief Реализация проверки целостности содержимого справочника.
+ */
+
+#include "handbookverifier.h"
+#include "contentpack.h"
+#include "handbookexporter.h"
+#include "pagereferences.h"
+#include "tocjson.h"
+#include "tocmodel.h"
+#include "trace.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+namespace {
+
+/// Найденная проблема.
+struct Issue
+{
+    bool error;         ///< Ошибка или предупреждение.
+    QString check;      ///< Вид проверки: catalog, read, encoding, html, link, image, budget.
+    QString message;
+    QString target;     ///< Ссылка или путь, к которому относится проблема.
+    int line = 0;       ///< Строка страницы или 0.
+};
+
+/// Ссылка или путь к изображению вместе со строкой, где они встретились.
+struct Reference
+{
+    QString value;
+    int line;
+};
+
+/// Страница из оглавления и собранные при разборе якоря и ссылки.
+struct Page
+{
+    QString title;
+    QString filePath;       ///< Путь из оглавления (":/texts/1.welcome.html").
+    QString entryName;      ///< Путь относительно корня ("texts/1.welcome.html").
+    qint64 bytes = 0;
+    bool readOk = false;
+    QSet<QString> anchors;  ///< Значения атрибутов name и id.
+    QVector<Reference> links;
+    QVector<Reference> images;
+    QVector<Issue> issues;
+};
+
+/// Сведения о файле изображения.
+struct ImageInfo
+{
+    bool exists = false;
+    bool readable = false;
+    qint64 bytes = 0;
+};
+
+/// Откуда читаются страницы и изображения.
+struct ContentSource
+{
+    const ContentPack* pack = nullptr;
+    bool fromRoot = false;  ///< Страницы читаются из каталога исходников, а не из программы.
+    QDir root;              ///< Каталог исходников или текущий каталог программы.
+
+    QByteArray read(const Page& page, bool* ok) const
+    {
+        if (!fromRoot && pack && pack->contains(page.filePath))
+        {
+            *ok = true;
+            return pack->read(page.filePath);
+        }
+
+        QFile file(fromRoot ? root.filePath(page.entryName) : page.filePath);
+        *ok = file.open(QIODevice::ReadOnly);
+        return *ok ? file.readAll() : QByteArray();
+    }
+};
+
+/// Элементы без закрывающего тега.
+const QSet<QString>& voidElements()
+{
+    static const QSet<QString> tags = {
+        "area", "base", "br", "col", "embed", "hr", "img", "input", "link", "meta", "param", "source",
+        "track", "wbr"
+    };
+    return tags;
+}
+
+/// Элементы, закрывающий тег которых можно опустить.
+const QSet<QString>& optionalCloseElements()
+{
+    static const QSet<QString> tags = {
+        "html", "head", "body", "p", "li", "dt", "dd", "tr", "td", "th", "thead", "tbody", "tfoot",
+        "colgroup", "option"
+    };
+    return tags;
+}
+
+/**
+ * @brief Разбирает страницу: проверяет вложенность тегов и собирает якоря, ссылки и изображения.
+ *
+ * Разбор упрощенный, но быстрый: на десятках тысяч страниц QTextDocument::setHtml занял бы
+ * слишком много времени, а ошибок вложенности он все равно не сообщает.
+ */
+void scanPage(Page& page, const QString& html)
+{
+    static const QRegularExpression token("<!--.*?-->|<(script|style)\\b[^>]*>.*?</\\1\\s*>"
+                                          "|<(/?)([a-zA-Z][a-zA-Z0-9]*)((?:[^>\"']|\"[^\"]*\"|'[^']*')*?)(/?)>"
+                                          "|<![^>]*>",
+                                          QRegularExpression::DotMatchesEverythingOption
+                                              | QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression attribute("([a-zA-Z_:][-a-zA-Z0-9_:.]*)(?:\\s*=\\s*(\"[^\"]*\"|'[^']*'|[^\\s\"'>]+))?");
+
+    struct Open
+    {
+        QString name;
+        int line;
+    };
+    QVector<Open> stack;
+
+    int line = 1;
+    qsizetype counted = 0;
+    auto lineAt = [&](qsizetype position) {
+        for (; counted < position; ++counted)
+        {
+            if (html.at(counted) == '\n')
+            {
+                ++line;
+            }
+        }
+        return line;
+    };
+
+    auto htmlIssue = [&page](const QString& message, int at) {
+        page.issues.append({true, "html", message, QString(), at});
+    };
+
+    QRegularExpressionMatchIterator it = token.globalMatch(html);
+    while (it.hasNext())
+    {
+        const QRegularExpressionMatch match = it.next();
+        const QString name = match.captured(3).toLower();
+        if (name.isEmpty())
+        {
+            continue; // Комментарии, DOCTYPE, script и style.
+        }
+        const int at = lineAt(match.capturedStart());
+
+        if (!match.captured(2).isEmpty())
+        {
+            // Закрывающий тег закрывает ближайший такой же открытый элемент и все, что открыто внутри него.
+            int index = stack.size() - 1;
+            while (index >= 0 && stack[index].name != name)
+            {
+                --index;
+            }
+            if (index < 0)
+            {
+                htmlIssue("лишний закрывающий тег </" + name + ">", at);
+                continue;
+            }
+            for (int i = stack.size() - 1; i > index; --i)
+            {
+                if (!optionalCloseElements().contains(stack[i].name))
+                {
+                    htmlIssue("тег <" + stack[i].name + "> из строки " + QString::number(stack[i].line)
+                                  + " не закрыт до </" + name + ">", at);
+                }
+            }
+            stack.resize(index);
+            continue;
+        }
+
+        QRegularExpressionMatchIterator attributes = attribute.globalMatch(match.captured(4));
+        while (attributes.hasNext())
+        {
+            const QRegularExpressionMatch attr = attributes.next();
+            const QString attrName = attr.captured(1).toLower();
+            QString value = attr.captured(2);
+            if (value.startsWith('"') || value.startsWith('\''))
+            {
+                value = value.mid(1, value.size() - 2);
+            }
+
+            if (attrName == "id" || (attrName == "name" && name == "a"))
+            {
+                if (page.anchors.contains(value))
+                {
+                    page.issues.append({false, "html", "якорь объявлен повторно", value, at});
+                }
+                page.anchors.insert(value);
+            }
+            else if (attrName == "href" && name == "a")
+            {
+                page.links.append({value, at});
+            }
+            else if (attrName == "src" && name == "img")
+            {
+                page.images.append({value, at});
+            }
+        }
+
+        if (!voidElements().contains(name) && match.captured(5).isEmpty())
+        {
+            stack.append({name, at});
+        }
+    }
+
+    for (const Open& open : stack)
+    {
+        if (!optionalCloseElements().contains(open.name))
+        {
+            htmlIssue("тег <" + open.name + "> не закрыт", open.line);
+        }
+    }
+}
+
+/**
+ * @brief Возвращает пути, по которым программа будет искать изображение, в порядке проверки.
+ */
+QStringList imageCandidates(const ContentSource& source, const QString& pageDir, const QString& path)
+{
+    if (source.fromRoot)
+    {
+        return PageReferences::imageCandidates(source.root, pageDir, path);
+    }
+    if (path.startsWith(":/"))
+    {
+        return {path};
+    }
+
+    QStringList candidates = PageReferences::imageCandidates(source.root, pageDir, path);
+    if (QDir::isRelativePath(path))
+    {
+        candidates.append(QDir(QCoreApplication::applicationDirPath()).filePath(path));
+    }
+    return candidates;
+}
+
+/**
+ * @brief Сведения об изображении. Одно изображение обычно встречается на многих страницах,
+ * поэтому результат запоминается.
+ */
+ImageInfo probeImage(const QString& path)
+{
+    static QMutex mutex;
+    static QHash<QString, ImageInfo> probed;
+    {
+        QMutexLocker locker(&mutex);
+        const auto it = probed.constFind(path);
+        if (it != probed.constEnd())
+        {
+            return *it;
+        }
+    }
+
+    ImageInfo info;
+    const QFileInfo fileInfo(path);
+    info.exists = fileInfo.isFile();
+    if (info.exists)
+    {
+        info.bytes = fileInfo.size();
+        QImageReader reader(path);
+        info.readable = reader.canRead() && reader.size().isValid();
+    }
+
+    QMutexLocker locker(&mutex);
+    probed.insert(path, info);
+    return info;
+}
+
+/**
+ * @brief Проверяет ссылки и изображения страницы по якорям, собранным со всех страниц.
+ */
+void checkReferences(Page& page, const QHash<QString, const Page*>& pagesByName,
+                     const ContentSource& source, qint64 maxImageBytes)
+{
+    const QString pageDir = QFileInfo(page.entryName).path();
+
+    for (const Reference& link : page.links)
+    {
+        const PageReferences::Link resolved = PageReferences::resolveLink(link.value, pageDir);
+        if (resolved.external)
+        {
+            continue;
+        }
+
+        const Page* targetPage = &page;
+        if (!resolved.entryName.isEmpty())
+        {
+            targetPage = pagesByName.value(resolved.entryName, nullptr);
+            if (!targetPage)
+            {
+                page.issues.append({true, "link", "ссылка на страницу не из оглавления", link.value, link.line});
+                continue;
+            }
+        }
+        if (resolved.empty)
+        {
+            page.issues.append({false, "link", "пустая ссылка", link.value, link.line});
+        }
+        else if (!resolved.anchor.isEmpty() && targetPage->readOk && !targetPage->anchors.contains(resolved.anchor))
+        {
+            page.issues.append({true, "link", "ссылка на несуществующий якорь", link.value, link.line});
+        }
+    }
+
+    for (const Reference& image : page.images)
+    {
+        const QString local = PageReferences::localReference(image.value);
+        if (local.isEmpty())
+        {
+            if (image.value.isEmpty())
+            {
+                page.issues.append({true, "image", "пустой путь к изображению", image.value, image.line});
+            }
+            continue;
+        }
+
+        ImageInfo info;
+        for (const QString& candidate : imageCandidates(source, pageDir, local))
+        {
+            info = probeImage(candidate);
+            if (info.exists)
+            {
+                break;
+            }
+        }
+
+        if (!info.exists)
+        {
+            page.issues.append({true, "image", "изображение не найдено", image.value, image.line});
+        }
+        else if (!info.readable)
+        {
+            page.issues.append({true, "image", "файл не читается как изображение", image.value, image.line});
+        }
+        else if (info.bytes > maxImageBytes)
+        {
+            page.issues.append({true, "budget", "изображение " + QString::number(info.bytes / 1024)
+                                                    + " КиБ больше бюджета " + QString::number(maxImageBytes / 1024)
+                                                    + " КиБ", image.value, image.line});
+        }
+    }
+}
+
+QJsonObject issueToJson(const Issue& issue, const QString& filePath)
+{
+    QJsonObject object;
+    object["severity"] = issue.error ? "error" : "warning";
+    object["check"] = issue.check;
+    object["page"] = filePath;
+    object["message"] = issue.message;
+    if (!issue.target.isEmpty())
+    {
+        object["target"] = issue.target;
+    }
+    if (issue.line > 0)
+    {
+        object["line"] = issue.line;
+    }
+    return object;
+}
+
+} // namespace
+
+bool HandbookVerifier::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (qstrcmp(argv[i], "--verify") == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int HandbookVerifier::run(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Проверка целостности содержимого справочника");
+    parser.addHelpOption();
+    parser.addOption({"verify", "Проверить оглавление, страницы, ссылки и изображения."});
+    parser.addOption({"data", "Проверить data.json и страницы исходников вместо содержимого программы.", "file"});
+    parser.addOption({"root", "Каталог исходников, относительно которого ищутся страницы.", "dir"});
+    parser.addOption({"report", "Файл отчета в формате JSON.", "file"});
+    parser.addOption({"max-page-kb", "Бюджет размера страницы в КиБ (по умолчанию 1024).", "kb", "1024"});
+    parser.addOption({"max-image-kb", "Бюджет размера изображения в КиБ (по умолчанию 2048).", "kb", "2048"});
+    parser.addOption({"jobs", "Количество потоков (по умолчанию — все ядра).", "count"});
+    parser.addOption({"trace", "Файл трассировки.", "file"});
+    parser.process(arguments);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const qint64 maxPageBytes = parser.value("max-page-kb").toLongLong() * 1024;
+    const qint64 maxImageBytes = parser.value("max-image-kb").toLongLong() * 1024;
+    const int jobs = parser.value("jobs").toInt();
+    if (jobs > 0)
+    {
+        QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Оглавление.
+    TraceSpan catalogSpan("verify.catalog", "verify");
+    ContentSource source;
+    QVector<Page> pages;
+    QVector<Issue> catalogIssues;
+    QString catalogName;
+
+    if (parser.isSet("data"))
+    {
+        const QString dataPath = parser.value("data");
+        catalogName = dataPath;
+        source.fromRoot = true;
+        source.root = QDir(parser.isSet("root") ? parser.value("root") : QFileInfo(dataPath).path());
+
+        QFile dataFile(dataPath);
+        if (!dataFile.open(QIODevice::ReadOnly))
+        {
+            err << "Не удалось открыть " << dataPath << ": " << dataFile.errorString() << Qt::endl;
+            return 1;
+        }
+        QJsonParseError parseError;
+        const QJsonDocument jsonDoc = QJsonDocument::fromJson(dataFile.readAll(), &parseError);
+        if (!jsonDoc.isArray())
+        {
+            err << dataPath << " не является JSON массивом: " << parseError.errorString() << Qt::endl;
+            return 1;
+        }
+
+        const QVector<TocJson::Entry> entries = TocJson::flatten(jsonDoc.array());
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            const QJsonObject& entry = entries[i].object;
+            Page page;
+            page.title = entry["title"].toString();
+            page.filePath = entry["filePath"].toString();
+            if (page.filePath.isEmpty())
+            {
+                catalogIssues.append({true, "catalog", "запись " + QString::number(i) + " без пути к странице",
+                                      page.title});
+                continue;
+            }
+            pages.append(page);
+        }
+    }
+    else
+    {
+        catalogName = "data.json";
+        source.pack = ContentPack::mounted();
+        source.root = QDir::current();
+
+        TocModel toc;
+        if (!HandbookExporter::loadCatalog(&toc))
+        {
+            return 1;
+        }
+        pages.reserve(toc.rowCount());
+        for (int row = 0; row < toc.rowCount(); ++row)
+        {
+            Page page;
+            page.title = toc.title(row);
+            page.filePath = toc.filePath(row);
+            pages.append(page);
+        }
+    }
+
+    QHash<QString, const Page*> pagesByName;
+    for (Page& page : pages)
+    {
+        page.entryName = ContentPack::entryName(page.filePath);
+        if (page.title.trimmed().isEmpty())
+        {
+            page.issues.append({true, "catalog", "у записи нет названия"});
+        }
+        if (pagesByName.contains(page.entryName))
+        {
+            page.issues.append({true, "catalog", "путь повторяется в оглавлении", page.filePath});
+        }
+        else
+        {
+            pagesByName.insert(page.entryName, &page);
+        }
+    }
+    catalogSpan.end();
+
+    // Чтение и разбор страниц независимы, поэтому выполняются параллельно.
+    TraceSpan pagesSpan("verify.pages", "verify");
+    QtConcurrent::blockingMap(pages, [&source, maxPageBytes](Page& page) {
+        bool ok = false;
+        const QByteArray data = source.read(page, &ok);
+        if (!ok)
+        {
+            page.issues.append({true, "read", "не удалось прочитать страницу"});
+            return;
+        }
+        page.readOk = true;
+        page.bytes = data.size();
+
+        if (data.trimmed().isEmpty())
+        {
+            page.issues.append({true, "read", "страница пустая"});
+            return;
+        }
+        if (page.bytes > maxPageBytes)
+        {
+            page.issues.append({true, "budget", "страница " + QString::number(page.bytes / 1024)
+                                                    + " КиБ больше бюджета " + QString::number(maxPageBytes / 1024) + " КиБ"});
+        }
+
+        const QString html = QString::fromUtf8(data);
+        if (html.count(QChar::ReplacementCharacter) != data.count("\xEF\xBF\xBD"))
+        {
+            page.issues.append({true, "encoding", "текст страницы не в UTF-8"});
+        }
+        scanPage(page, html);
+    });
+    pagesSpan.end();
+
+    // Ссылки проверяются после разбора всех страниц: якоря других страниц уже собраны и не меняются.
+    TraceSpan referencesSpan("verify.references", "verify");
+    QtConcurrent::blockingMap(pages, [&pagesByName, &source, maxImageBytes](Page& page) {
+        if (page.readOk)
+        {
+            checkReferences(page, pagesByName, source, maxImageBytes);
+        }
+    });
+    referencesSpan.end();
+
+    // Отчет.
+    int errors = 0;
+    int warnings = 0;
+    int links = 0;
+    int images = 0;
+    QJsonArray issues;
+    auto report = [&](const Issue& issue, const QString& filePath) {
+        (issue.error ? errors : warnings)++;
+        issues.append(issueToJson(issue, filePath));
+        err << (issue.error ? "ошибка: " : "предупреждение: ") << (filePath.isEmpty() ? catalogName : filePath);
+        if (issue.line > 0)
+        {
+            err << ':' << issue.line;
+        }
+        err << ": " << issue.message;
+        if (!issue.target.isEmpty())
+        {
+            err << " (" << issue.target << ')';
+        }
+        err << Qt::endl;
+    };
+
+    for (const Issue& issue : catalogIssues)
+    {
+        report(issue, QString());
+    }
+    for (const Page& page : pages)
+    {
+        links += page.links.size();
+        images += page.images.size();
+        for (const Issue& issue : page.issues)
+        {
+            report(issue, page.filePath);
+        }
+    }
+
+    const qint64 elapsed = timer.elapsed();
+    if (parser.isSet("report"))
+    {
+        QJsonObject budgets;
+        budgets["pageBytes"] = double(maxPageBytes);
+        budgets["imageBytes"] = double(maxImageBytes);
+
+        QJsonObject root;
+        root["ok"] = errors == 0;
+        root["catalog"] = catalogName;
+        root["pages"] = pages.size();
+        root["links"] = links;
+        root["images"] = images;
+        root["errors"] = errors;
+        root["warnings"] = warnings;
+        root["elapsedMs"] = double(elapsed);
+        root["threads"] = QThreadPool::globalInstance()->maxThreadCount();
+        root["budgets"] = budgets;
+        root["issues"] = issues;
+
+        QSaveFile file(parser.value("report"));
+        const QByteArray data = QJsonDocument(root).toJson();
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+        {
+            err << "Не удалось записать отчет " << file.fileName() << ": " << file.errorString() << Qt::endl;
+            return 1;
+        }
+    }
+
+    out << "Проверено страниц: " << pages.size() << ", ссылок: " << links << ", изображений: " << images
+        << " за " << elapsed << " мс; ошибок: " << errors << ", предупреждений: " << warnings << Qt::endl;
+
+    return errors == 0 ? 0 : 1;
+}
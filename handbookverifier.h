@@ -0,0 +1,51 @@
+#ifndef HANDBOOKVERIFIER_H
+#define HANDBOOKVERIFIER_H
+
+/**
+ * @file handbookverifier.h
+ * @brief Определение класса HandbookVerifier — проверки целостности содержимого справочника.
+ *
+ * Режим включается параметром --verify:
+ *     PythonProgrammingHandbook --verify [--data data.json --root <каталог>] [--report отчет.json]
+ *                               [--max-page-kb N] [--max-image-kb N] [--jobs N]
+ *
+ * Без --data проверяется то содержимое, которое покажет программа: оглавление и страницы из
+ * подключенного пакета содержимого или из ресурсов программы. С --data проверяются data.json
+ * и страницы исходников относительно --root (по умолчанию — каталог data.json).
+ *
+ * Проверяется:
+ * - оглавление: у каждой записи есть название и путь, пути не повторяются;
+ * - страницы: файл читается, текст в UTF-8, теги HTML закрыты и вложены правильно;
+ * - ссылки: якоря на той же странице и ссылки на другие страницы справочника и их якоря;
+ * - изображения: файл найден и читается как изображение;
+ * - размеры страниц и изображений не превышают бюджет.
+ *
+ * Страницы разбираются параллельно, ссылки проверяются по уже собранным якорям тоже параллельно.
+ * Отчет в формате JSON записывается в файл --report; код завершения 1, если найдены ошибки.
+ */
+
+#include <QStringList>
+
+/**
+ * @class HandbookVerifier
+ * @brief Проверка оглавления, страниц, ссылок и изображений справочника.
+ */
+class HandbookVerifier
+{
+public:
+    /**
+     * @brief Проверяет, запрошена ли проверка параметрами командной строки.
+     *
+     * Вызывается до создания QApplication, чтобы программа запустилась без главного окна.
+     */
+    static bool isRequested(int argc, char* argv[]);
+
+    /**
+     * @brief Выполняет проверку.
+     * @param arguments Параметры командной строки (QCoreApplication::arguments()).
+     * @return Код завершения программы: 0, если ошибок не найдено.
+     */
+    static int run(const QStringList& arguments);
+};
+
+#endif // HANDBOOKVERIFIER_H
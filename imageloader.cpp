@@ -0,0 +1,421 @@
+/**
+ * @file imageloader.cpp
+ * @brief Реализация фонового декодирования изображений страниц.
+ */
+
+#include "imageloader.h"
+#include "trace.h"
+
+#include <QAbstractTextDocumentLayout>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QImageReader>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <climits>
+#include <utility>
+
+QAtomicPointer<ImageLoader> ImageLoader::current;
+
+namespace {
+
+/// Цвет заглушки: заметен и на светлом, и на темном фоне, но не отвлекает от текста.
+const QColor PlaceholderColor(128, 128, 128, 40);
+
+} // namespace
+
+ImageLoader::ImageLoader(QObject *parent)
+    : QObject(parent)
+    , devicePixelRatio(qApp ? qApp->devicePixelRatio() : 1.0)
+{
+    setMaxBytes(DefaultMaxBytes);
+    pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+    current.storeRelease(this);
+}
+
+ImageLoader::~ImageLoader()
+{
+    current.testAndSetRelease(this, nullptr);
+
+    {
+        QMutexLocker locker(&mutex);
+        waiting.clear();
+    }
+    pool.waitForDone();
+}
+
+ImageLoader *ImageLoader::instance()
+{
+    return current.loadAcquire();
+}
+
+QVariant ImageLoader::load(PageDocument *document, const QUrl &url)
+{
+    const QString path = resolvePath(document, url);
+    if (path.isEmpty())
+    {
+        return {};
+    }
+
+    // Картинка шире текста уменьшается до ширины области просмотра с учетом плотности пикселей экрана.
+    const QSize natural = naturalSize(path);
+    QSize display = natural;
+    const qreal available = document->textWidth() > 0 ? document->textWidth() - 2 * document->documentMargin() : 0;
+    if (natural.isValid() && available > 0 && natural.width() > available)
+    {
+        display = natural.scaled(QSize(int(available), INT_MAX), Qt::KeepAspectRatio);
+    }
+
+    QSize target = display;
+    if (display.isValid())
+    {
+        target = (QSizeF(display) * devicePixelRatio).toSize();
+        if (target.width() > natural.width())
+        {
+            target = natural;
+        }
+    }
+
+    ImageRequest request;
+    request.key = path + '@' + QString::number(target.width());
+    request.url = url;
+    request.placeholderSize = display.isValid() ? display : QSize(16, 16);
+    request.path = path;
+    request.targetSize = target;
+
+    if (QThread::currentThread() != thread())
+    {
+        // Документ верстается в рабочем потоке: картинку он получит через adopt() после переноса
+        // в главный поток, а декодирование начинается уже сейчас.
+        {
+            QMutexLocker locker(&mutex);
+            if (!failed.contains(request.key))
+            {
+                document->pendingImages.append(request);
+                if (!pixmaps.contains(request.key) && !decoding.contains(request.key))
+                {
+                    decoding.insert(request.key);
+                    startDecode(request);
+                }
+            }
+        }
+
+        // Заглушка кладется в ресурсы документа, иначе QTextDocument запрашивал бы ее при каждой отрисовке.
+        QImage placeholder(request.placeholderSize, QImage::Format_ARGB32_Premultiplied);
+        placeholder.fill(PlaceholderColor);
+        document->addResource(QTextDocument::ImageResource, url, placeholder);
+        return placeholder;
+    }
+
+    QMutexLocker locker(&mutex);
+    if (const QPixmap* pixmap = pixmaps.object(request.key))
+    {
+        const QPixmap image = *pixmap;
+        locker.unlock();
+        document->addResource(QTextDocument::ImageResource, url, image);
+        return image;
+    }
+
+    // Для битого файла документ навсегда оставляет заглушку.
+    if (!failed.contains(request.key))
+    {
+        addWaiter({document, request});
+        if (!decoding.contains(request.key))
+        {
+            decoding.insert(request.key);
+            startDecode(request);
+        }
+    }
+    locker.unlock();
+
+    QPixmap placeholder(request.placeholderSize);
+    placeholder.fill(PlaceholderColor);
+    document->addResource(QTextDocument::ImageResource, url, placeholder);
+    return placeholder;
+}
+
+void ImageLoader::adopt(QTextDocument *document)
+{
+    PageDocument* page = dynamic_cast<PageDocument*>(document);
+    if (!page || page->thread() != thread() || page->pendingImages.isEmpty())
+    {
+        return;
+    }
+
+    const QVector<ImageRequest> requests = std::move(page->pendingImages);
+    page->pendingImages.clear();
+
+    // Готовые картинки подставляются одним проходом, по одной на ключ.
+    QHash<QString, QPixmap> ready;
+    QHash<QString, QVector<Waiter>> readyWaiters;
+
+    QMutexLocker locker(&mutex);
+    for (const ImageRequest& request : requests)
+    {
+        const Waiter waiter{page, request};
+        if (const QPixmap* pixmap = pixmaps.object(request.key))
+        {
+            ready.insert(request.key, *pixmap);
+            readyWaiters[request.key].append(waiter);
+            continue;
+        }
+
+        if (failed.contains(request.key))
+        {
+            continue;
+        }
+
+        // Картинка еще декодируется или уже вытеснена из кэша.
+        addWaiter(waiter);
+        if (!decoding.contains(request.key))
+        {
+            decoding.insert(request.key);
+            startDecode(request);
+        }
+    }
+    locker.unlock();
+
+    for (auto it = readyWaiters.cbegin(); it != readyWaiters.cend(); ++it)
+    {
+        apply(it.value(), ready.value(it.key()));
+    }
+}
+
+void ImageLoader::setMaxBytes(qint64 maxBytes)
+{
+    QMutexLocker locker(&mutex);
+    pixmaps.setMaxCost(int(qBound<qint64>(0, maxBytes, INT_MAX)));
+}
+
+qint64 ImageLoader::maxBytes() const
+{
+    QMutexLocker locker(&mutex);
+    return pixmaps.maxCost();
+}
+
+void ImageLoader::clear()
+{
+    QMutexLocker locker(&mutex);
+    pixmaps.clear();
+    failed.clear();
+}
+
+/**
+ * @brief Находит файл изображения так же, как QTextDocument: относительно baseUrl документа
+ * или текущего каталога. Дополнительно проверяется каталог программы, рядом с которым
+ * сборка копирует папку images.
+ * @return Путь к файлу или пустая строка, если файла нет или адрес не локальный.
+ */
+QString ImageLoader::resolvePath(const QTextDocument *document, const QUrl &url) const
+{
+    QUrl resolved = url;
+    if (url.isRelative() && document->baseUrl().isValid())
+    {
+        resolved = document->baseUrl().resolved(url);
+    }
+
+    QString path;
+    if (resolved.scheme() == QLatin1String("qrc"))
+    {
+        path = ':' + resolved.path();
+    }
+    else if (resolved.isLocalFile())
+    {
+        path = resolved.toLocalFile();
+    }
+    else if (resolved.scheme().isEmpty())
+    {
+        path = resolved.toString(QUrl::RemoveQuery | QUrl::RemoveFragment);
+    }
+    else
+    {
+        return QString();
+    }
+
+    if (QFileInfo::exists(path))
+    {
+        return path;
+    }
+
+    if (QDir::isRelativePath(path) && !path.startsWith(':'))
+    {
+        const QString besideProgram = QDir(QCoreApplication::applicationDirPath()).filePath(path);
+        if (QFileInfo::exists(besideProgram))
+        {
+            return besideProgram;
+        }
+    }
+
+    return QString();
+}
+
+/**
+ * @brief Возвращает размер изображения из заголовка файла, не декодируя пиксели.
+ */
+QSize ImageLoader::naturalSize(const QString &path)
+{
+    {
+        QMutexLocker locker(&mutex);
+        const auto it = naturalSizes.constFind(path);
+        if (it != naturalSizes.constEnd())
+        {
+            return it.value();
+        }
+    }
+
+    const QSize size = QImageReader(path).size();
+
+    QMutexLocker locker(&mutex);
+    naturalSizes.insert(path, size);
+    return size;
+}
+
+/**
+ * @brief Добавляет документ в ожидающие картинку, если он еще не ждет ее под тем же адресом.
+ * Вызывается с захваченным mutex.
+ */
+void ImageLoader::addWaiter(const Waiter &waiter)
+{
+    QVector<Waiter>& waiters = waiting[waiter.request.key];
+    for (const Waiter& existing : std::as_const(waiters))
+    {
+        if (existing.document == waiter.document && existing.request.url == waiter.request.url)
+        {
+            return;
+        }
+    }
+    waiters.append(waiter);
+}
+
+/**
+ * @brief Запускает декодирование в пуле потоков. Вызывается с захваченным mutex.
+ */
+void ImageLoader::startDecode(const ImageRequest &request)
+{
+    const QString key = request.key;
+    const QString path = request.path;
+    const QSize targetSize = request.targetSize;
+    const QSize displaySize = request.placeholderSize;
+    QtConcurrent::run(&pool, [this, key, path, targetSize, displaySize]() {
+        TraceSpan span("image.decode", "page");
+        span.setDetail(path);
+
+        QImageReader reader(path);
+        const QSize natural = reader.size();
+        if (targetSize.isValid() && targetSize != natural)
+        {
+            reader.setScaledSize(targetSize);
+        }
+
+        QImage image = reader.read();
+        if (image.isNull())
+        {
+            qDebug() << "Не удалось декодировать изображение" << path << reader.errorString();
+        }
+        else if (targetSize.isValid())
+        {
+            // Картинка хранится в физических пикселях экрана, а на странице занимает размер заглушки.
+            image.setDevicePixelRatio(qreal(image.width()) / displaySize.width());
+        }
+        QMetaObject::invokeMethod(this, [this, key, image]() { finishDecode(key, image); }, Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief Кладет декодированную картинку в кэш и подставляет ее в ожидающие документы.
+ */
+void ImageLoader::finishDecode(const QString &key, const QImage &image)
+{
+    if (image.isNull())
+    {
+        // Документы оставляют заглушку: повторные попытки для битого файла бессмысленны.
+        QMutexLocker locker(&mutex);
+        decoding.remove(key);
+        waiting.remove(key);
+        failed.insert(key);
+        return;
+    }
+
+    const QPixmap pixmap = QPixmap::fromImage(image);
+    const qint64 cost = qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+
+    // Картинка попадает в кэш в тот же момент, когда снимается отметка о декодировании,
+    // иначе параллельный запрос из рабочего потока запустил бы декодирование повторно.
+    QMutexLocker locker(&mutex);
+    decoding.remove(key);
+    pixmaps.insert(key, new QPixmap(pixmap), int(qMin<qint64>(cost, INT_MAX)));
+    const QVector<Waiter> waiters = waiting.take(key);
+    locker.unlock();
+
+    apply(waiters, pixmap);
+}
+
+/**
+ * @brief Подставляет картинку в документы главного потока.
+ *
+ * Если размер картинки совпал с заглушкой, документ только перерисовывается.
+ */
+void ImageLoader::apply(const QVector<Waiter> &waiters, const QPixmap &pixmap)
+{
+    const QSizeF logicalSize = QSizeF(pixmap.size()) / pixmap.devicePixelRatio();
+
+    QSet<QTextDocument*> relayout;
+    QSet<QTextDocument*> repaint;
+
+    for (const Waiter& waiter : waiters)
+    {
+        QTextDocument* document = waiter.document.data();
+        if (!document)
+        {
+            continue;
+        }
+
+        document->addResource(QTextDocument::ImageResource, waiter.request.url, pixmap);
+        if (logicalSize.toSize() != waiter.request.placeholderSize)
+        {
+            relayout.insert(document);
+        }
+        else
+        {
+            repaint.insert(document);
+        }
+    }
+
+    for (QTextDocument* document : std::as_const(relayout))
+    {
+        document->markContentsDirty(0, document->characterCount());
+        repaint.remove(document);
+    }
+    for (QTextDocument* document : std::as_const(repaint))
+    {
+        emit document->documentLayout()->update();
+    }
+}
+
+QVariant PageDocument::loadResource(int type, const QUrl &name)
+{
+    if (type == QTextDocument::ImageResource)
+    {
+        if (ImageLoader* loader = ImageLoader::instance())
+        {
+            const QVariant image = loader->load(this, name);
+            if (image.isValid())
+            {
+                return image;
+            }
+        }
+    }
+
+    const QVariant resource = QTextDocument::loadResource(type, name);
+    if (type == QTextDocument::ImageResource && !resource.isValid())
+    {
+        // Отсутствующая картинка запоминается пустой, чтобы файл не искался при каждой отрисовке;
+        // вместо нее QTextDocument рисует стандартный значок.
+        addResource(type, name, QImage());
+    }
+    return resource;
+}
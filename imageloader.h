@@ -0,0 +1,168 @@
+#ifndef IMAGELOADER_H
+#define IMAGELOADER_H
+
+/**
+ * @file imageloader.h
+ * @brief Определение классов ImageLoader и PageDocument — фонового декодирования изображений страниц.
+ *
+ * QTextDocument декодирует изображение при первой верстке или отрисовке, в том потоке, где это
+ * происходит, и в исходном разрешении. Документ страницы PageDocument вместо этого сразу получает
+ * заглушку нужного размера, а изображение декодируется в пуле потоков с уменьшением до ширины
+ * области просмотра. Готовая картинка подставляется в документ без повторной верстки.
+ */
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QPixmap>
+#include <QPointer>
+#include <QSet>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QUrl>
+
+class PageDocument;
+
+/**
+ * @struct ImageRequest
+ * @brief Изображение, запрошенное документом: куда его подставить и до какого размера декодировать.
+ */
+struct ImageRequest
+{
+    QString key;            ///< Ключ кэша: путь и ширина декодированной картинки.
+    QUrl url;               ///< Адрес из атрибута src, под которым картинка подставляется в документ.
+    QSize placeholderSize;  ///< Размер заглушки, то есть место картинки на странице.
+    QString path;
+    QSize targetSize;       ///< Размер декодированной картинки в пикселях; пустой — исходный.
+};
+
+/**
+ * @class ImageLoader
+ * @brief Фоновое декодирование изображений и кэш готовых картинок с ограничением по объему памяти.
+ *
+ * Объект живет в главном потоке, а load() можно вызывать из любого потока: документы соседних
+ * страниц верстаются в рабочих потоках. Ключ кэша — путь к файлу и ширина, до которой уменьшено
+ * изображение, поэтому одна картинка на нескольких страницах декодируется один раз.
+ *
+ * Документ из рабочего потока запоминает запрошенные картинки у себя и получает их после переноса
+ * в главный поток, когда загрузчик страниц передает его в adopt(). Так ImageLoader обращается
+ * к документам только в главном потоке.
+ */
+class ImageLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Бюджет памяти кэша картинок по умолчанию в байтах.
+    static constexpr qint64 DefaultMaxBytes = 32 * 1024 * 1024;
+
+    /**
+     * @brief Конструктор. Созданный объект становится доступен через instance().
+     *
+     * Бюджет кэша картинок — DefaultMaxBytes, его можно изменить через setMaxBytes().
+     * @param parent Родительский объект.
+     */
+    explicit ImageLoader(QObject* parent = nullptr);
+
+    /**
+     * @brief Деструктор. Дожидается завершения запущенного декодирования.
+     */
+    ~ImageLoader() override;
+
+    /**
+     * @brief Возвращает загрузчик, созданный главным окном, или nullptr.
+     */
+    static ImageLoader* instance();
+
+    /**
+     * @brief Возвращает изображение для документа.
+     *
+     * Если картинка уже декодирована, в главном потоке возвращается она сама. Иначе возвращается
+     * заглушка того размера, который картинка займет на странице, а после декодирования картинка
+     * подставляется в документ через QTextDocument::addResource(). В рабочем потоке декодирование
+     * только запускается, а картинку документ получит через adopt().
+     *
+     * Возвращенное значение сразу кладется в ресурсы документа, поэтому для каждого адреса метод
+     * вызывается один раз. Картинка, которую не удалось декодировать, больше не декодируется
+     * и остается заглушкой.
+     * @param document Документ, который запрашивает изображение.
+     * @param url Адрес изображения из атрибута src.
+     * @return QPixmap в главном потоке, QImage в рабочих потоках или пустое значение, если файла нет.
+     */
+    QVariant load(PageDocument* document, const QUrl& url);
+
+    /**
+     * @brief Подставляет картинки, запрошенные документом при верстке в рабочем потоке.
+     *
+     * Вызывается в главном потоке, когда готовый документ пришел из рабочего потока. Уже декодированные
+     * картинки подставляются сразу, остальные — по окончании декодирования.
+     * @param document Документ, перенесенный в главный поток. Другие документы пропускаются.
+     */
+    void adopt(QTextDocument* document);
+
+    /**
+     * @brief Задает бюджет памяти кэша картинок.
+     * @param maxBytes Бюджет в байтах.
+     */
+    void setMaxBytes(qint64 maxBytes);
+    qint64 maxBytes() const;
+
+    /**
+     * @brief Очищает кэш картинок.
+     */
+    void clear();
+
+private:
+    /// Документ главного потока, ожидающий декодирования картинки.
+    struct Waiter
+    {
+        QPointer<QTextDocument> document;
+        ImageRequest request;
+    };
+
+    QString resolvePath(const QTextDocument* document, const QUrl& url) const;
+    QSize naturalSize(const QString& path);
+    void addWaiter(const Waiter& waiter);
+    void startDecode(const ImageRequest& request);
+    void finishDecode(const QString& key, const QImage& image);
+    void apply(const QVector<Waiter>& waiters, const QPixmap& pixmap);
+
+    static QAtomicPointer<ImageLoader> current;
+
+    mutable QMutex mutex; ///< Защищает все поля ниже: load() вызывается из рабочих потоков.
+    QCache<QString, QPixmap> pixmaps;          ///< Готовые картинки, стоимость — размер в байтах.
+    QHash<QString, QSize> naturalSizes;        ///< Размеры файлов изображений, прочитанные из заголовков.
+    QSet<QString> decoding;                    ///< Картинки, которые сейчас декодируются.
+    QHash<QString, QVector<Waiter>> waiting;   ///< Документы главного потока, ожидающие картинку.
+    QSet<QString> failed;                      ///< Картинки, которые не удалось декодировать.
+
+    QThreadPool pool;
+    qreal devicePixelRatio = 1.0;
+};
+
+/**
+ * @class PageDocument
+ * @brief Документ страницы, который загружает изображения через ImageLoader.
+ *
+ * QTextBrowser::loadResource вызывается только для документов, принадлежащих самому QTextBrowser,
+ * а документы страниц создаются отдельно (в том числе в рабочих потоках) и показываются через
+ * setDocument(). Поэтому загрузка ресурсов переопределена в самом документе.
+ */
+class PageDocument : public QTextDocument
+{
+public:
+    using QTextDocument::QTextDocument;
+
+protected:
+    QVariant loadResource(int type, const QUrl& name) override;
+
+private:
+    friend class ImageLoader;
+
+    /// Картинки, запрошенные при верстке в рабочем потоке; читаются только потоком-владельцем документа.
+    QVector<ImageRequest> pendingImages;
+};
+
+#endif // IMAGELOADER_H
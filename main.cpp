@@ -6,17 +6,103 @@
  * Здесь создается объект `QApplication`, который управляет основным циклом обработки событий
  * для приложения на основе Qt. Затем создается и отображается главное окно приложения
  * с установленным заголовком "Справочник по языку программирования Python".
+ *
+ * Если рядом с программой лежит пакет содержимого handbook.pack (или путь к нему задан переменной
+ * окружения HANDBOOK_PACK), страницы и data.json читаются из него, а не из ресурсов программы.
+ * В режиме разработки переменная HANDBOOK_CONTENT_DIR указывает каталог с data.json и texts/:
+ * содержимое читается из него, а правки страниц подхватываются без перезапуска (см. ContentWatcher).
+ *
+ * Параметр --trace <файл> (или переменная окружения HANDBOOK_TRACE) включает трассировку запуска
+ * и переключения страниц; трасса записывается при завершении программы. Счетчики и гистограммы
+ * работающей программы (см. Metrics) отдаются в JSON через локальный сокет HANDBOOK_METRICS_SOCKET.
+ *
+ * Закладки, состояние сеанса и поисковый индекс хранятся рядом с программой или в каталоге
+ * из переменной окружения HANDBOOK_DATA_DIR.
+ *
+ * Параметр --export запускает пакетный экспорт страниц (см. HandbookExporter), а --verify — проверку
+ * целостности содержимого (см. HandbookVerifier); главное окно в этих режимах не создается.
  */
 
 #include "mainwindow.h"
+#include "contentpack.h"
+#include "contentwatcher.h"
+#include "handbookexporter.h"
+#include "handbookverifier.h"
+#include "metricsserver.h"
+#include "trace.h"
 
 #include <QApplication>
 
+namespace {
+
+/**
+ * @brief Подключает пакет содержимого из HANDBOOK_PACK или из handbook.pack рядом с программой.
+ */
+void mountContentPack()
+{
+    QString packPath = qEnvironmentVariable("HANDBOOK_PACK");
+    if (packPath.isEmpty())
+    {
+        packPath = QCoreApplication::applicationDirPath() + "/handbook.pack";
+    }
+    if (QFile::exists(packPath))
+    {
+        ContentPack::mount(packPath);
+    }
+}
+
+} // namespace
+
 int main(int argc, char *argv[])
 {
+    Trace::configure(argc, argv);
+
+    const bool exportRequested = HandbookExporter::isRequested(argc, argv);
+    if (exportRequested || HandbookVerifier::isRequested(argc, argv))
+    {
+        // Экспорту и проверке не нужен дисплей: страницы только разбираются, верстаются и печатаются.
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+        QGuiApplication app(argc, argv);
+        qAddPostRoutine(Trace::finish);
+        mountContentPack();
+        return exportRequested ? HandbookExporter::run(app.arguments()) : HandbookVerifier::run(app.arguments());
+    }
+
+    TraceSpan applicationSpan("QApplication", "startup");
     QApplication a(argc, argv);
+    applicationSpan.end();
+
+    // Трасса записывается из деструктора QApplication, уже после закрытия главного окна.
+    qAddPostRoutine(Trace::finish);
+
+    mountContentPack();
+
+    const QString contentDir = qEnvironmentVariable("HANDBOOK_CONTENT_DIR");
+    if (!contentDir.isEmpty())
+    {
+        ContentWatcher::mount(contentDir);
+    }
+
+    // Снимок метрик в JSON отдается через локальный сокет, если задана переменная HANDBOOK_METRICS_SOCKET.
+    MetricsServer metricsServer;
+    const QString metricsSocket = qEnvironmentVariable("HANDBOOK_METRICS_SOCKET");
+    if (!metricsSocket.isEmpty())
+    {
+        metricsServer.listen(metricsSocket);
+    }
+
+    TraceSpan windowSpan("MainWindow", "startup");
     MainWindow w;
+    windowSpan.end();
+
     w.setWindowTitle("Справочник по языку программирования Python");
+
+    TraceSpan showSpan("show", "startup");
     w.show();
+    showSpan.end();
+
     return a.exec();
 }
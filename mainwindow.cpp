@@ -22,6 +22,19 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 
+#include "metrics.h"
+#include "pagereferences.h"
+#include "theme.h"
+#include "toc_generated.h"
+#include "trace.h"
+
+#include <QDesktopServices>
+#include <QDir>
+#include <QFileInfo>
+#include <QMenu>
+#include <QTimer>
+#include <QtConcurrent>
+
 /**
  * @brief Конструктор класса MainWindow.
  *
@@ -33,30 +46,208 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , tocModel(new TocModel(this))
+    , navigationModel(new BookmarkFilterModel(this))
+    , tocTree(new TocTreeModel(tocModel, this))
     , showingBookmarks(false)
+    , prefetcher(new PagePrefetcher(&pageCache, &MainWindow::loadTextFromFile, this))
+    , progressiveRenderer(new ProgressiveRenderer(this))
+    , pageLoader(new AsyncPageLoader(&MainWindow::loadTextFromFile, this))
+    , imageLoader(new ImageLoader(this))
+    , session(new SessionState(this))
 
 {
+    TraceSpan setupSpan("setupUi", "startup");
     ui->setupUi(this);
 
-    loadBookmarksFromFile();
+    navigationModel->setSourceModel(tocModel);
+    setupSpan.end();
+
+    // Тема разбирается один раз: дальше оформление меняется только свойствами theme и state,
+    // а документы страниц создаются уже со шрифтом текстового поля из темы.
+    // Вариант темы можно выбрать переменной окружения HANDBOOK_THEME (light или dark).
+    TraceSpan styleSpan("style.apply", "style");
+    styleSpan.setDetail("theme.qss");
+    const QString themeName = qEnvironmentVariable("HANDBOOK_THEME") == Theme::Dark ? Theme::Dark : Theme::Light;
+    Theme::install(this, loadStyleSheetFromFile(":/theme.qss"), themeName);
+    ui->menuDarkTheme->setChecked(themeName == Theme::Dark);
+    ui->textBrowser->ensurePolished();
+    styleSpan.end();
+
+    // Бюджет кэша страниц можно изменить переменной окружения HANDBOOK_PAGE_CACHE_MB.
+    bool budgetOk = false;
+    const int budgetMb = qEnvironmentVariableIntValue("HANDBOOK_PAGE_CACHE_MB", &budgetOk);
+    if (budgetOk && budgetMb > 0)
+    {
+        pageCache.setMaxBytes(qint64(budgetMb) * 1024 * 1024);
+    }
+
+    // Бюджет кэша декодированных изображений задается переменной HANDBOOK_IMAGE_CACHE_MB.
+    bool imageBudgetOk = false;
+    const int imageBudgetMb = qEnvironmentVariableIntValue("HANDBOOK_IMAGE_CACHE_MB", &imageBudgetOk);
+    if (imageBudgetOk && imageBudgetMb > 0)
+    {
+        imageLoader->setMaxBytes(qint64(imageBudgetMb) * 1024 * 1024);
+    }
+
+    // Количество заранее подготавливаемых соседних страниц задается переменной HANDBOOK_PREFETCH_RADIUS.
+    bool radiusOk = false;
+    const int radius = qEnvironmentVariableIntValue("HANDBOOK_PREFETCH_RADIUS", &radiusOk);
+    if (radiusOk)
+    {
+        prefetcher->setRadius(radius);
+    }
+
+    connect(progressiveRenderer, &ProgressiveRenderer::finished, this,
+            [this](const QString& filePath, const QSharedPointer<QTextDocument>& document, qint64 cost) {
+        pageCache.insert(filePath, document, cost);
+    });
+
+    // Результаты асинхронной загрузки приходят только для последней выбранной страницы.
+    connect(pageLoader, &AsyncPageLoader::documentReady, this,
+            [this](const QString& filePath, const QSharedPointer<QTextDocument>& document, qint64 cost) {
+        pageCache.insert(filePath, document, cost);
+        progressiveRenderer->cancel();
+        displayDocument(filePath, document);
+    });
+    connect(pageLoader, &AsyncPageLoader::largePageReady, this, [this](const QString& filePath, const QString& html) {
+        displayDocument(filePath, progressiveRenderer->start(filePath, html, currentView()->font(),
+                                                             currentView()->viewport()->width()));
+    });
+
+    connectView(ui->textBrowser);
+
+    // Действие диагностики не добавлено ни в одно меню, поэтому его сочетание клавиш регистрируется у окна.
+    addAction(ui->menuDiagnostics);
+
+    // Панель поиска управляет поиском текущей вкладки; после ее закрытия фокус возвращается странице.
+    ui->findBar->setFinder(ui->textBrowser->finder());
+    connect(ui->findBar, &FindBar::closed, this, [this]() { currentView()->setFocus(); });
+
+    // Любую страницу списка можно открыть в новой вкладке из контекстного меню.
+    ui->navigationList->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->navigationList, &QWidget::customContextMenuRequested, this, [this](const QPoint& pos) {
+        const QModelIndex index = ui->navigationList->indexAt(pos);
+        if (!index.isValid())
+        {
+            return;
+        }
+
+        const QString filePath = index.data(TocModel::FilePathRole).toString();
+        QMenu menu(this);
+        menu.addAction("Открыть в новой вкладке", this, [this, filePath]() { openTab(filePath); });
+        menu.exec(ui->navigationList->viewport()->mapToGlobal(pos));
+    });
+
+    // Последняя страница прошлого сеанса показывается раньше всего остального: файл состояния
+    // постоянного размера читается одним вызовом, а оглавление, закладки и поисковый индекс
+    // загружаются уже после ее отрисовки, поэтому время до показа текста не зависит от размера справочника.
+    session->load(dataFilePath("session.state"));
+    const QString lastPage = session->currentPage();
+    bool lastPageShown = false;
+    if (!lastPage.isEmpty())
+    {
+        TraceSpan firstPageSpan("firstPage", "startup");
+        firstPageSpan.setDetail(lastPage);
+        lastPageShown = showPage(lastPage);
+    }
+
+    if (lastPageShown)
+    {
+        ui->textBrowser->viewport()->installEventFilter(this);
+    }
+    else
+    {
+        finishStartup();
+    }
+}
 
-    if (!loadDataFromFile(":/data.json"))
+void MainWindow::finishStartup()
+{
+    if (startupFinished)
     {
-        QMessageBox::critical(this, "Ошибка", "Не удалось загрузить файл с данными");
         return;
     }
+    startupFinished = true;
 
-    connect(ui->navigationList, &QListWidget::currentRowChanged, this, &MainWindow::onNavigationItemSelected);
-    connect(ui->navigationList, &QListWidget::currentRowChanged, this, &MainWindow::updateNavigationButtons);
+    TraceSpan startupSpan("deferredStartup", "startup");
 
-    if (ui->navigationList->count() > 0)
+    loadBookmarksFromFile();
+
+    // Оглавление собрано в программу при сборке. data.json читается только из каталога содержимого
+    // в режиме разработки или из подключенного пакета, который поставляется отдельно от программы
+    // и может менять оглавление.
+    const QString contentRoot = ContentWatcher::mountedRoot();
+    const ContentPack* pack = ContentPack::mounted();
+    if (!contentRoot.isEmpty())
+    {
+        if (!loadDataFromFile(QDir(contentRoot).filePath("data.json")))
+        {
+            QMessageBox::critical(this, "Ошибка", "Не удалось загрузить файл с данными");
+            return;
+        }
+        startContentWatcher();
+    }
+    else if (pack && pack->contains(":/data.json"))
     {
-        ui->navigationList->setCurrentRow(0);
-        updateOpenBookmarksButton();
-        updateNavigationButtons();
-        updateBookmarkButton();
+        if (!loadDataFromFile(":/data.json"))
+        {
+            QMessageBox::critical(this, "Ошибка", "Не удалось загрузить файл с данными");
+            return;
+        }
+    }
+    else
+    {
+        TraceSpan tocSpan("loadGeneratedToc", "startup");
+        tocModel->loadFromTable(GeneratedToc::entries, GeneratedToc::pathOrder, GeneratedToc::count);
     }
 
+    syncBookmarkRows();
+    startSearchIndexBuild();
+
+    // Создается только верхний уровень дерева; разделы глав появляются при их раскрытии.
+    setNavigationModel(tocTree);
+
+    if (navigationRowCount() == 0)
+    {
+        return;
+    }
+
+    const QString shownPage = currentView()->filePath();
+    if (!shownPage.isEmpty() && tocModel->rowOfFilePath(shownPage) >= 0)
+    {
+        // Страница прошлого сеанса уже на экране: восстанавливаются только список и режим закладок.
+        if (session->bookmarksShown() && bookmarks.contains(shownPage))
+        {
+            showingBookmarks = true;
+            ui->OpenBookmarksButton->setText("Скрыть закладки");
+            navigationModel->setShowBookmarksOnly(true);
+            setNavigationModel(navigationModel);
+        }
+        selectPage(shownPage);
+        updateTabTitle(currentView());
+    }
+    else
+    {
+        // Выбор строки сам загружает страницу (onNavigationItemSelected), как при любом переходе.
+        setCurrentRow(0);
+    }
+
+    updateOpenBookmarksButton();
+    updateNavigationButtons();
+    updateBookmarkButton();
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Paint && watched == ui->textBrowser->viewport())
+    {
+        // Страница рисуется в этом же событии; остальной запуск выполняется сразу после него.
+        watched->removeEventFilter(this);
+        Trace::instant("firstPageShown", "startup");
+        QTimer::singleShot(0, this, &MainWindow::finishStartup);
+    }
+    return QMainWindow::eventFilter(watched, event);
 }
 
 /**
@@ -67,217 +258,896 @@ MainWindow::MainWindow(QWidget *parent)
 MainWindow::~MainWindow()
 {
     saveBookmarksToFile();
+    session->flush();
+
+    // Останавливаем фоновую подготовку и отсоединяем документы от вкладок до того, как кэш освободит их.
+    delete pageLoader;
+    pageLoader = nullptr;
+    delete prefetcher;
+    prefetcher = nullptr;
+    progressiveRenderer->cancel();
+    if (searchIndexWatcher)
+    {
+        searchIndexWatcher->waitForFinished();
+    }
+    disconnect(ui->pageTabs, nullptr, this, nullptr);
+    for (int i = 0; i < ui->pageTabs->count(); ++i)
+    {
+        static_cast<PageView*>(ui->pageTabs->widget(i))->clearDocument();
+    }
+    pageCache.clear();
     delete ui;
 }
 
 /**
- * @brief Сохраняет закладки в файл.
+ * @brief Сохраняет закладки в файл.
+ *
+ * Каждое изменение закладок уже записано в журнал bookmarks.journal. Здесь журнал сворачивается в снимок
+ * bookmarks.json в формате JSON, который содержит значения "title" (название раздела) и "filePath" (путь до HTML файла).
+ * Снимок записывается атомарно, поэтому сбой во время сохранения не портит прежний файл.
+ */
+void MainWindow::saveBookmarksToFile()
+{
+    QString filePath = dataFilePath("bookmarks.json");
+
+    if (!bookmarks.compact())
+    {
+        return;
+    }
+
+    qDebug() << "Закладки успешно сохранены в" << filePath;
+}
+
+QString MainWindow::dataFilePath(const QString &fileName)
+{
+    const QString dataDir = qEnvironmentVariable("HANDBOOK_DATA_DIR");
+    return QDir(dataDir.isEmpty() ? QCoreApplication::applicationDirPath() : dataDir).filePath(fileName);
+}
+
+/**
+ * @brief Загружает закладки из файла bookmarks.json.
+ *
+ * Закладки считываются из снимка bookmarks.json, после чего к ним применяются изменения из журнала
+ * bookmarks.journal, сделанные после последнего сохранения снимка.
+ */
+void MainWindow::loadBookmarksFromFile()
+{
+    TraceSpan span("loadBookmarksFromFile", "bookmarks");
+    QString filePath = dataFilePath("bookmarks.json");
+
+    if (!bookmarks.load(filePath))
+    {
+        qDebug() << "Не удалось открыть файл для чтения:" << filePath;
+        return;
+    }
+
+    qDebug() << "Закладки успешно загружены из" << filePath;
+}
+
+/**
+ * @brief Загружает данные из JSON файла.
+ *
+ * Функция загружает данные из указанного JSON файла в модель оглавления, которую показывает список навигации.
+ * @param fileName Имя JSON файла. В нашем случае data.json, который содержит значения "title" (название раздела) и "filePath" (путь до HTML файла).
+ * Необязательное значение "hash" (хеш содержимого страницы) позволяет поисковому индексу не читать неизмененные страницы.
+ * Если подключен пакет содержимого handbook.pack, файл читается из него.
+ * @return Возвращает true при успешной загрузке файла, иначе false.
+ */
+bool MainWindow::loadDataFromFile(const QString& fileName)
+{
+    TraceSpan span("loadDataFromFile", "startup");
+    span.setDetail(fileName);
+
+    QByteArray fileData;
+
+    const ContentPack* pack = ContentPack::mounted();
+    if (pack && pack->contains(fileName))
+    {
+        fileData = pack->read(fileName);
+    }
+    else
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            qDebug() << "Не удалось открыть файл:" << file.errorString();
+            return false;
+        }
+
+        fileData = file.readAll();
+        file.close();
+    }
+
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(fileData);
+
+    if (!jsonDoc.isArray())
+    {
+        qDebug() << "Файл не является JSON массивом";
+        return false;
+
+    }
+
+    tocModel->loadFromJson(jsonDoc.array());
+
+    // Индекс названий быстрого перехода построен по прежнему оглавлению.
+    if (quickOpen)
+    {
+        quickOpen->deleteLater();
+        quickOpen = nullptr;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Загружает содержимое CSS файла.
+ *
+ * Функция читает и возвращает содержимое CSS файла по указанному пути.
+ *
+ * @param filePath Путь к CSS файлу.
+ * @return Содержимое CSS файла в виде строки.
+ */
+QString MainWindow::loadStyleSheetFromFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qDebug() << "Не удалось открыть CSS файл: " << file.errorString();
+        return "";
+    }
+
+    QString cssContent = file.readAll();
+    file.close();
+
+    return cssContent;
+}
+
+/**
+ * @brief Обработчик выбора элемента в списке навигации.
+ *
+ * Показывает выбранную страницу. Если страница недавно открывалась, готовый документ берется из кэша
+ * без повторного чтения файла и разбора HTML, иначе страница загружается асинхронно, и список
+ * остается отзывчивым, даже когда строки быстро сменяют друг друга.
+ *
+ * @param currentRow Индекс выбранного элемента в списке.
+ */
+void MainWindow::onNavigationItemSelected(int currentRow)
+{
+    QString filePath = filePathAt(currentRow);
+    if (filePath.isEmpty())
+    {
+        return;
+    }
+
+    TraceSpan span("pageSwitch", "page");
+    span.setDetail(filePath);
+
+    requestPage(filePath);
+
+    updateNavigationButtons();
+    updateBookmarkButton();
+}
+
+/**
+ * @brief Создает готовый к показу документ страницы.
+ *
+ * Документ получает шрифт текстового поля (заданный темой theme.qss) и верстается по ширине
+ * его области просмотра. Отмена/повтор отключены: документы страниц только читаются.
+ *
+ * @param filePath Путь к HTML файлу.
+ * @return Документ или пустой указатель, если файл пустой или не открылся.
+ */
+QSharedPointer<QTextDocument> MainWindow::buildPageDocument(const QString &filePath)
+{
+    TraceSpan readSpan("page.read", "page");
+    QString fileContent = loadTextFromFile(filePath);
+    readSpan.end();
+    if (fileContent.isEmpty())
+    {
+        return {};
+    }
+
+    // Большие страницы верстаются постепенно: документ с первой частью показывается сразу,
+    // а в кэш он попадет, когда ProgressiveRenderer допишет остальное.
+    if (ProgressiveRenderer::shouldRender(fileContent))
+    {
+        return progressiveRenderer->start(filePath, fileContent, currentView()->font(),
+                                          currentView()->viewport()->width());
+    }
+
+    QSharedPointer<QTextDocument> document =
+        PagePrefetcher::buildDocument(fileContent, currentView()->font(), currentView()->viewport()->width());
+
+    pageCache.insert(filePath, document, PageCache::estimateCost(document.data(), fileContent.size()));
+    return document;
+}
+
+/**
+ * @brief Показывает страницу в текущей вкладке.
+ *
+ * Документ из кэша просто подставляется в текстовое поле. Прежний документ остается в кэше
+ * и освобождается только при вытеснении. Постепенная верстка другой страницы при этом отменяется.
+ *
+ * @param filePath Путь к HTML файлу.
+ * @return true, если страница показана, иначе false (предыдущая страница остается на экране).
+ */
+bool MainWindow::showPage(const QString &filePath)
+{
+    if (progressiveRenderer->isActive())
+    {
+        if (progressiveRenderer->filePath() == filePath)
+        {
+            return true;
+        }
+        progressiveRenderer->cancel();
+    }
+
+    QSharedPointer<QTextDocument> document = pageCache.object(filePath);
+    if (!document)
+    {
+        document = buildPageDocument(filePath);
+    }
+
+    if (!document)
+    {
+        return false;
+    }
+
+    displayDocument(filePath, document);
+    return true;
+}
+
+/**
+ * @brief Запрашивает показ страницы, не блокируя главный поток.
+ *
+ * Страница из кэша (или уже постепенно верстаемая) показывается сразу, а незавершенная загрузка
+ * другой страницы отменяется. Остальные страницы загружаются AsyncPageLoader: частые запросы
+ * объединяются, а результаты устаревших запросов отбрасываются до показа.
+ *
+ * @param filePath Путь к HTML файлу.
+ */
+void MainWindow::requestPage(const QString &filePath)
+{
+    // Пользователь ушел на другую страницу раньше, чем открылась страница из ссылки.
+    if (filePath != linkTargetPath)
+    {
+        linkTargetPath.clear();
+        linkTargetAnchor.clear();
+    }
+
+    if (progressiveRenderer->isActive() && progressiveRenderer->filePath() == filePath)
+    {
+        pageLoader->cancel();
+        return;
+    }
+
+    // Время загрузки считается от первого запроса страницы до ее показа в displayDocument().
+    if (pageLoadPath != filePath)
+    {
+        pageLoadPath = filePath;
+        pageLoadStart = Metrics::now();
+    }
+
+    if (pageCache.contains(filePath))
+    {
+        pageLoader->cancel();
+        showPage(filePath);
+        return;
+    }
+
+    if (pageLoader->pendingPath() == filePath)
+    {
+        return;
+    }
+
+    // Промах учитывается здесь: до showPage() и PageCache::object() такая страница уже не дойдет.
+    Metrics::pageCacheMisses.add();
+    pageLoader->request(filePath, currentView()->font(), currentView()->viewport()->width());
+}
+
+/**
+ * @brief Подставляет готовый документ в текущую вкладку и запускает подготовку соседних страниц.
+ *
+ * Вкладки, открытые на одной странице, показывают один и тот же документ из кэша.
+ *
+ * @param filePath Путь к странице.
+ * @param document Документ страницы.
+ */
+void MainWindow::displayDocument(const QString &filePath, const QSharedPointer<QTextDocument> &document)
+{
+    PageView* view = currentView();
+    view->showDocument(filePath, document, session->scrollPosition(filePath));
+    session->setCurrentPage(filePath);
+    if (filePath == linkTargetPath)
+    {
+        showAnchor(view, linkTargetAnchor);
+        linkTargetPath.clear();
+        linkTargetAnchor.clear();
+    }
+    updateTabTitle(view);
+
+    if (filePath == pageLoadPath)
+    {
+        Metrics::pageLoad.record(Metrics::now() - pageLoadStart);
+        pageLoadPath.clear();
+    }
+
+    // При трассировке страница рисуется сразу, чтобы время отрисовки попало в трассу отдельным участком.
+    if (Trace::isEnabled())
+    {
+        TraceSpan paintSpan("page.paint", "page");
+        view->viewport()->repaint();
+    }
+
+    prefetchAround(currentRow());
+}
+
+/**
+ * @brief Запускает фоновую подготовку страниц вокруг текущей строки списка.
+ *
+ * Подготавливаются строки на расстоянии до radius() в обе стороны, сначала ближайшие, и
+ * следующая страница раньше предыдущей. Если пользователь перешел далеко от прошлой позиции,
+ * незавершенные задачи для старых соседей отменяются.
+ *
+ * @param currentRow Текущая строка списка навигации.
+ */
+void MainWindow::prefetchAround(int currentRow)
+{
+    const int radius = prefetcher->radius();
+    if (radius <= 0 || currentRow < 0)
+    {
+        return;
+    }
+
+    QStringList filePaths;
+    QString currentPath;
+    if (navigationModel->showBookmarksOnly())
+    {
+        currentPath = filePathAt(currentRow);
+        for (int distance = 1; distance <= radius; ++distance)
+        {
+            for (int row : {currentRow + distance, currentRow - distance})
+            {
+                const QString filePath = filePathAt(row);
+                if (!filePath.isEmpty())
+                {
+                    filePaths.append(filePath);
+                }
+            }
+        }
+    }
+    else
+    {
+        // Строки ленивой модели идут в порядке загрузки, поэтому соседи ищутся обходом в порядке чтения.
+        currentPath = tocModel->filePath(currentRow);
+        int next = currentRow;
+        int previous = currentRow;
+        for (int distance = 1; distance <= radius; ++distance)
+        {
+            if (next >= 0)
+            {
+                next = tocModel->nextRow(next);
+            }
+            if (previous >= 0)
+            {
+                previous = tocModel->previousRow(previous);
+            }
+            for (int row : {next, previous})
+            {
+                if (row >= 0 && !tocModel->filePath(row).isEmpty())
+                {
+                    filePaths.append(tocModel->filePath(row));
+                }
+            }
+        }
+    }
+
+    // Переход на соседнюю страницу оставляет в очереди ее соседей; при переходе дальше
+    // подготовка прежней окрестности больше не нужна.
+    if (!prefetchNeighbours.isEmpty() && !prefetchNeighbours.contains(currentPath))
+    {
+        prefetcher->cancelPending();
+    }
+    prefetchNeighbours = filePaths;
+
+    prefetcher->setLayoutParameters(currentView()->font(), currentView()->viewport()->width());
+    prefetcher->prefetch(filePaths);
+}
+
+/**
+ * @brief Запускает фоновое построение поискового индекса.
+ *
+ * Список страниц берется из модели оглавления. Индекс хранится в файле search.index
+ * рядом с bookmarks.json: если страницы не менялись, файл просто отображается в память, иначе
+ * заново разбираются только измененные страницы. Интерфейс при этом остается доступным; до окончания
+ * построения поиск сообщает, что индекс еще готовится.
+ *
+ * Прежний индекс окна освобождается до запуска: построение может перезаписать search.index,
+ * а на Windows отображенный в память файл заменить нельзя.
+ */
+void MainWindow::startSearchIndexBuild()
+{
+    if (searchIndexWatcher && searchIndexWatcher->isRunning())
+    {
+        searchIndexStale = true;
+        return;
+    }
+
+    // Индексируются все страницы, в том числе из нераскрытых глав, которые модель еще не загрузила.
+    QVector<SearchIndex::Page> pages;
+    pages.reserve(tocModel->rowCount());
+    tocModel->forEachPage([&pages](const QString& title, const QString& filePath, quint64 hash) {
+        pages.append({title, filePath, hash});
+    });
+
+    const QString indexPath = dataFilePath("search.index");
+
+    // Построение по всему оглавлению учитывает и страницы, ждавшие обновления.
+    staleIndexPages.clear();
+    searchIndexPatching = false;
+    searchIndex = SearchIndex();
+    watchSearchIndexTask(QtConcurrent::run([pages, indexPath]() {
+        return SearchIndex::openOrUpdate(indexPath, pages, &MainWindow::loadTextFromFile, &MainWindow::pageStamp);
+    }));
+}
+
+/**
+ * @brief Заменяет в поисковом индексе только измененные страницы.
+ *
+ * Остальные страницы не читаются и не разбираются заново (см. SearchIndex::updatePages()). Окно
+ * отдает индекс задаче и на время замены остается без него, чтобы файл можно было перезаписать.
+ */
+void MainWindow::updateSearchIndex(const QStringList &filePaths)
+{
+    if (searchIndexWatcher && searchIndexWatcher->isRunning())
+    {
+        for (const QString& filePath : filePaths)
+        {
+            if (!staleIndexPages.contains(filePath))
+            {
+                staleIndexPages.append(filePath);
+            }
+        }
+        return;
+    }
+
+    if (searchIndex.isEmpty())
+    {
+        startSearchIndexBuild();
+        return;
+    }
+
+    QVector<SearchIndex::Page> pages;
+    for (const QString& filePath : filePaths)
+    {
+        const int row = tocModel->rowOfFilePath(filePath);
+        if (row >= 0)
+        {
+            pages.append({tocModel->title(row), filePath, tocModel->contentHash(row)});
+        }
+    }
+    if (pages.isEmpty())
+    {
+        return;
+    }
+
+    const QString indexPath = dataFilePath("search.index");
+    SearchIndex base = searchIndex;
+    searchIndex = SearchIndex();
+    searchIndexPatching = true;
+    watchSearchIndexTask(QtConcurrent::run([base, pages, indexPath]() mutable {
+        return SearchIndex::updatePages(std::move(base), indexPath, pages, &MainWindow::loadTextFromFile,
+                                        &MainWindow::pageStamp);
+    }));
+}
+
+/**
+ * @brief Принимает готовый индекс и запускает построение, отложенное на время предыдущего.
+ */
+void MainWindow::watchSearchIndexTask(const QFuture<SearchIndex> &future)
+{
+    if (!searchIndexWatcher)
+    {
+        searchIndexWatcher = new QFutureWatcher<SearchIndex>(this);
+        connect(searchIndexWatcher, &QFutureWatcher<SearchIndex>::finished, this, [this]() {
+            searchIndex = searchIndexWatcher->result();
+
+            // Замена страниц не удалась (например, индекс на диске не совпал с оглавлением):
+            // индекс строится по всему оглавлению.
+            if (searchIndexPatching && searchIndex.isEmpty())
+            {
+                searchIndexStale = true;
+            }
+
+            // В data.json каталога содержимого хешей нет: их дает индекс, и следующее обновление
+            // уже не читает неизмененные страницы.
+            if (contentWatcher && !searchIndexPatching)
+            {
+                tocModel->fillContentHashes(searchIndex.contentHashes());
+            }
+
+            if (searchIndexStale)
+            {
+                searchIndexStale = false;
+                startSearchIndexBuild();
+            }
+            else if (!staleIndexPages.isEmpty())
+            {
+                const QStringList filePaths = staleIndexPages;
+                staleIndexPages.clear();
+                updateSearchIndex(filePaths);
+            }
+
+            if (!ui->searchLineEdit->text().isEmpty())
+            {
+                on_searchLineEdit_textChanged(ui->searchLineEdit->text());
+            }
+        });
+    }
+    searchIndexWatcher->setFuture(future);
+}
+
+void MainWindow::startContentWatcher()
+{
+    contentWatcher = new ContentWatcher(ContentWatcher::mountedRoot(), this);
+    connect(contentWatcher, &ContentWatcher::catalogChanged, this, &MainWindow::reloadCatalog);
+    connect(contentWatcher, &ContentWatcher::pagesChanged, this, &MainWindow::reloadChangedPages);
+    watchContentPages();
+}
+
+void MainWindow::watchContentPages()
+{
+    QStringList filePaths;
+    filePaths.reserve(tocModel->rowCount());
+    tocModel->forEachPage([&filePaths](const QString&, const QString& filePath, quint64) {
+        filePaths.append(filePath);
+    });
+    contentWatcher->watchPages(filePaths);
+}
+
+/**
+ * @brief Обновляет только изменившиеся страницы.
+ *
+ * Сохранение файла без изменения текста ничего не сбрасывает: хеш содержимого сравнивается с прежним.
+ * Документы измененных страниц удаляются из кэша, открытая страница перерисовывается на месте
+ * (положение прокрутки восстанавливается из состояния сеанса), а другие вкладки с этой страницей
+ * получат новый документ при переключении на них. В поисковом индексе заменяются только эти страницы.
+ */
+void MainWindow::reloadChangedPages(const QStringList &filePaths)
+{
+    TraceSpan span("content.reload", "content");
+
+    QStringList changed;
+    for (const QString& filePath : filePaths)
+    {
+        const int row = tocModel->rowOfFilePath(filePath);
+        const quint64 hash = SearchIndex::contentHash(loadTextFromFile(filePath));
+        if (row >= 0 && hash == tocModel->contentHash(row))
+        {
+            continue;
+        }
+        tocModel->setContentHash(row, hash);
+        changed.append(filePath);
+    }
+    span.setDetail(QString::number(changed.size()) + " of " + QString::number(filePaths.size()));
+    if (changed.isEmpty())
+    {
+        return;
+    }
+
+    for (const QString& filePath : changed)
+    {
+        pageCache.remove(filePath);
+        if (progressiveRenderer->isActive() && progressiveRenderer->filePath() == filePath)
+        {
+            progressiveRenderer->cancel();
+        }
+    }
+
+    PageView* current = currentView();
+    for (int i = 0; i < ui->pageTabs->count(); ++i)
+    {
+        PageView* view = static_cast<PageView*>(ui->pageTabs->widget(i));
+        const QString filePath = view->filePath();
+        if (view != current && changed.contains(filePath))
+        {
+            view->clearDocument();
+            view->setFilePath(filePath);
+        }
+    }
+
+    if (changed.contains(current->filePath()))
+    {
+        pageLoader->cancel();
+        requestPage(current->filePath());
+    }
+
+    updateSearchIndex(changed);
+}
+
+/**
+ * @brief Перечитывает data.json каталога содержимого.
  *
- * Закладки сохрняются в файл bookmark.json в формате JSON, который содержит значения "title" (название раздела) и "filePath" (путь до HTML файла).
+ * Документы страниц от оглавления не зависят и остаются в кэше, а известные хеши страниц
+ * переносятся в новое оглавление. Пока data.json сохранен не полностью и не разбирается,
+ * остается прежнее оглавление.
  */
-void MainWindow::saveBookmarksToFile()
+void MainWindow::reloadCatalog()
 {
-    QString filePath = QCoreApplication::applicationDirPath() + "/bookmarks.json";
+    TraceSpan span("content.catalog", "content");
 
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    QHash<QString, quint64> hashes;
+    hashes.reserve(tocModel->rowCount());
+    for (int row = 0; row < tocModel->rowCount(); ++row)
     {
-        qDebug() << "Не удалось открыть файл для записи:" << file.errorString();
-        return;
+        hashes.insert(tocModel->filePath(row), tocModel->contentHash(row));
     }
 
-    QJsonArray jsonArray;
-    for (const auto& bookmark : bookmarks)
+    const QString shownPage = currentView()->filePath();
+    if (!loadDataFromFile(QDir(ContentWatcher::mountedRoot()).filePath("data.json")))
     {
-        QJsonObject obj;
-        obj["title"] = bookmark.first;
-        obj["filePath"] = bookmark.second;
-        jsonArray.append(obj);
+        return;
     }
 
-    QJsonDocument jsonDoc(jsonArray);
-    file.write(jsonDoc.toJson());
-    file.close();
+    tocModel->fillContentHashes(hashes);
 
-    qDebug() << "Закладки успешно сохранены в" << filePath;
+    syncBookmarkRows();
+    watchContentPages();
+    startSearchIndexBuild();
+
+    selectPage(shownPage);
+    updateTabTitle(currentView());
+    updateOpenBookmarksButton();
+    updateNavigationButtons();
+    updateBookmarkButton();
 }
 
 /**
- * @brief Загружает закладки из файла bookmarks.json.
+ * @brief Слот для изменения текста в строке поиска.
  *
- * Закладки считываются из файла bookmarks.json и добавляются в вектор пар bookmarks.
+ * При непустом запросе список навигации скрывается и вместо него показываются найденные страницы:
+ * название и фрагмент текста вокруг совпадения. При очистке строки возвращается список навигации.
+ *
+ * @param text Текст запроса.
  */
-void MainWindow::loadBookmarksFromFile()
+void MainWindow::on_searchLineEdit_textChanged(const QString &text)
 {
-    QString filePath = QCoreApplication::applicationDirPath() + "/bookmarks.json";
+    const bool searching = !text.trimmed().isEmpty();
+    ui->navigationList->setVisible(!searching);
+    ui->searchResultsList->setVisible(searching);
+    ui->searchResultsList->clear();
 
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (!searching)
     {
-        qDebug() << "Не удалось открыть файл для чтения:" << file.errorString();
         return;
     }
 
-    QByteArray fileData = file.readAll();
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(fileData);
-    file.close();
-
-    if (!jsonDoc.isArray())
+    if (searchIndex.isEmpty())
     {
-        qDebug() << "Файл закладок не является JSON массивом";
+        ui->searchResultsList->addItem("Поисковый индекс еще строится...");
         return;
     }
 
-    QJsonArray jsonArray = jsonDoc.array();
-    bookmarks.clear();
-
-    for (int i = 0; i < jsonArray.size(); ++i)
+    const QVector<SearchIndex::Hit> hits = searchIndex.search(text);
+    if (hits.isEmpty())
     {
-        QJsonObject obj = jsonArray[i].toObject();
-        QString title = obj["title"].toString();
-        QString filePath = obj["filePath"].toString();
-        bookmarks.append(qMakePair(title, filePath));
+        ui->searchResultsList->addItem("Ничего не найдено");
+        return;
     }
 
-    qDebug() << "Закладки успешно загружены из" << filePath;
+    for (const SearchIndex::Hit& hit : hits)
+    {
+        QListWidgetItem* item = new QListWidgetItem(hit.title + "\n" + hit.snippet);
+        item->setData(Qt::UserRole, hit.filePath);
+        item->setToolTip(hit.snippet);
+        ui->searchResultsList->addItem(item);
+    }
 }
 
 /**
- * @brief Загружает данные из JSON файла.
+ * @brief Слот для выбора результата поиска.
  *
- * Функция загружает данные из указанного JSON файла и добавляет элементы в список навигации.
- * @param fileName Имя JSON файла. В нашем случае data.json, который содержит значения "title" (название раздела) и "filePath" (путь до HTML файла).
- * @return Возвращает true при успешной загрузке файла, иначе false.
+ * Открывает найденную страницу в списке навигации. Строка поиска при этом сохраняется,
+ * чтобы можно было перейти к следующему результату.
+ *
+ * @param item Выбранный результат.
  */
-bool MainWindow::loadDataFromFile(const QString& fileName)
+void MainWindow::on_searchResultsList_itemClicked(QListWidgetItem *item)
 {
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    const QString filePath = item->data(Qt::UserRole).toString();
+    if (!filePath.isEmpty())
     {
-        qDebug() << "Не удалось открыть файл:" << file.errorString();
-        return false;
+        selectPage(filePath);
     }
+}
 
-    QByteArray fileData = file.readAll();
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(fileData);
-    file.close();
+/**
+ * @brief Выделяет в списке навигации страницу с указанным путем.
+ *
+ * @param filePath Путь к странице.
+ */
+void MainWindow::selectPage(const QString &filePath)
+{
+    const int row = tocModel->rowOfFilePath(filePath);
+    if (row < 0)
+    {
+        return;
+    }
 
-    if (!jsonDoc.isArray())
+    if (navigationModel->showBookmarksOnly())
     {
-        qDebug() << "Файл не является JSON массивом";
-        return false;
+        const QModelIndex index = navigationModel->mapFromSource(tocModel->index(row));
+        if (index.isValid())
+        {
+            ui->navigationList->setCurrentIndex(index);
+            return;
+        }
 
+        // Страницы нет среди закладок: возвращаемся к полному списку.
+        setShowingBookmarks(false);
     }
 
-    QJsonArray jsonArray = jsonDoc.array();
-
-    for (int i = 0; i < jsonArray.size(); ++i) {
-        QJsonObject obj = jsonArray[i].toObject();
-        QString title = obj["title"].toString();
-        QString filePath = obj["filePath"].toString();
+    setCurrentRow(row);
+}
 
-        QListWidgetItem* item = new QListWidgetItem(title);
-        item->setData(Qt::UserRole, filePath);
-        ui->navigationList->addItem(item);
+void MainWindow::setNavigationModel(QAbstractItemModel *model)
+{
+    if (ui->navigationList->model() == model)
+    {
+        return;
     }
 
-    return true;
+    // Представление создает новую модель выделения, а прежнюю удалять должен владелец.
+    QItemSelectionModel* previousSelection = ui->navigationList->selectionModel();
+    ui->navigationList->setModel(model);
+    delete previousSelection;
+    ui->navigationList->setRootIsDecorated(model == tocTree);
+
+    connect(ui->navigationList->selectionModel(), &QItemSelectionModel::currentChanged, this,
+            [this]() { onNavigationItemSelected(currentRow()); });
+    connect(ui->navigationList->selectionModel(), &QItemSelectionModel::currentChanged, this,
+            &MainWindow::updateNavigationButtons);
 }
 
-/**
- * @brief Загружает содержимое CSS файла.
- *
- * Функция читает и возвращает содержимое CSS файла по указанному пути.
- *
- * @param filePath Путь к CSS файлу.
- * @return Содержимое CSS файла в виде строки.
- */
-QString MainWindow::loadStyleSheetFromFile(const QString &filePath)
+int MainWindow::currentRow() const
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    const QModelIndex index = ui->navigationList->currentIndex();
+    return navigationModel->showBookmarksOnly() ? index.row() : TocTreeModel::tocRow(index);
+}
+
+void MainWindow::setCurrentRow(int row)
+{
+    if (navigationModel->showBookmarksOnly())
     {
-        qDebug() << "Не удалось открыть CSS файл: " << file.errorString();
-        return "";
+        ui->navigationList->setCurrentIndex(navigationModel->index(row, 0));
+        return;
     }
 
-    QString cssContent = file.readAll();
-    file.close();
+    // Раскрываются только главы, в которых лежит строка, поэтому переходы "Следующая" и "Предыдущая"
+    // идут в порядке обхода в глубину, не создавая узлы остальных глав.
+    const QModelIndex index = tocTree->indexOfRow(row);
+    ui->navigationList->setCurrentIndex(index);
+    ui->navigationList->scrollTo(index);
+}
 
-    return cssContent;
+int MainWindow::navigationRowCount() const
+{
+    return navigationModel->rowCount();
 }
 
-/**
- * @brief Обработчик выбора элемента в списке навигации.
- *
- * Загружает содержимое выбранного файла и применяет к нему CSS стили.
- *
- * @param currentRow Индекс выбранного элемента в списке.
- */
-void MainWindow::onNavigationItemSelected(int currentRow)
+bool MainWindow::nextRowExists() const
 {
-    QListWidgetItem* currentItem = ui->navigationList->item(currentRow);
-    if (!currentItem)
+    if (navigationModel->showBookmarksOnly())
     {
-        return;
+        return currentRow() < navigationRowCount() - 1;
     }
+    return tocModel->hasNextRow(currentRow());
+}
 
-    QString filePath = currentItem->data(Qt::UserRole).toString();
-    QString fileContent = loadTextFromFile(filePath);
-    QString cssContent = loadStyleSheetFromFile(":/style.css");
+QString MainWindow::filePathAt(int row) const
+{
+    return navigationModel->index(row, 0).data(TocModel::FilePathRole).toString();
+}
 
-    if (!fileContent.isEmpty())
+QString MainWindow::titleAt(int row) const
+{
+    return navigationModel->index(row, 0).data(Qt::DisplayRole).toString();
+}
+
+/**
+ * @brief Передает в модель навигации строки оглавления, находящиеся в закладках.
+ *
+ * Закладки на страницы, которых нет в оглавлении, в списке не показываются.
+ */
+void MainWindow::syncBookmarkRows()
+{
+    // Страницы из нераскрытых глав ищутся одним проходом по оглавлению для всех закладок.
+    QStringList filePaths;
+    filePaths.reserve(bookmarks.size());
+    for (const auto& bookmark : bookmarks.items())
     {
-        ui->textBrowser->setHtml(fileContent);
-        ui->textBrowser->setStyleSheet(cssContent);
+        filePaths.append(bookmark.filePath);
     }
 
-    updateNavigationButtons();
-    updateBookmarkButton();
+    QVector<int> rows = tocModel->rowsOfFilePaths(filePaths);
+    rows.removeAll(-1);
+    navigationModel->setBookmarkRows(rows);
 }
 
 /**
  * @brief Загружает текст из файла.
  *
  * Функция читает и возвращает содержимое из файла, в нашем случае HTML, по указанному пути.
+ * Если подключен пакет содержимого и в нем есть такая страница, она читается из пакета.
  *
  * @param filePath Путь к файлу.
  * @return Содержимое файла в виде строки.
  */
 QString MainWindow::loadTextFromFile(const QString &filePath)
 {
-    QFile file(filePath);
+    // В режиме разработки страницы читаются из каталога содержимого, чтобы правки были видны сразу.
+    const QString localPath = ContentWatcher::localPath(filePath);
+
+    // Функция вызывается и из рабочих потоков, поэтому учитывается только в атомарных метриках.
+    MetricsTimer readTimer(Metrics::pageRead);
+
+    // Страница из пакета содержимого читается одним срезом отображенного файла и одной распаковкой.
+    const ContentPack* pack = ContentPack::mounted();
+    if (localPath.isEmpty() && pack && pack->contains(filePath))
+    {
+        const QByteArray data = pack->read(filePath);
+        Metrics::pageBytesRead.add(data.size());
+        return QString::fromUtf8(data);
+    }
+
+    QFile file(localPath.isEmpty() ? filePath : localPath);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
     {
+        readTimer.cancel();
         qDebug() << "Не удалось открыть файл текста:" << file.errorString();
         return "";
     }
 
-    QString fileContent = file.readAll();
+    const QByteArray data = file.readAll();
     file.close();
+    Metrics::pageBytesRead.add(data.size());
+
+    return QString::fromUtf8(data);
+}
+
+SearchIndex::FileStamp MainWindow::pageStamp(const QString &filePath)
+{
+    const QString localPath = ContentWatcher::localPath(filePath);
+    const ContentPack* pack = ContentPack::mounted();
+    if (localPath.isEmpty() && pack && pack->contains(filePath))
+    {
+        return {};
+    }
 
-    return fileContent;
+    // Для страниц ресурсов Qt возвращает время изменения исходного файла на момент сборки.
+    const QFileInfo info(localPath.isEmpty() ? filePath : localPath);
+    if (!info.exists())
+    {
+        return {};
+    }
+    return {info.size(), info.lastModified().toMSecsSinceEpoch()};
 }
 
 /**
  * @brief Отображает список закаладок в навигационном меню.
  *
- * Добавляет закладки в список навигации, заменяя все существующие разделы.
+ * Переключает модель навигации в режим закладок: список не пересоздается, модель просто
+ * начинает показывать только строки оглавления, находящиеся в закладках.
  */
 void MainWindow::showBookmarkList()
 {
-    ui->navigationList->clear();
-
-    for (const auto& bookmark : bookmarks)
-    {
-        QListWidgetItem* item = new QListWidgetItem(bookmark.first);
-        item->setData(Qt::UserRole, bookmark.second);
-        ui->navigationList->addItem(item);
-    }
+    navigationModel->setShowBookmarksOnly(true);
+    setNavigationModel(navigationModel);
+    session->setBookmarksShown(true);
 
-    if (ui->navigationList->count() > 0)
+    if (navigationRowCount() > 0)
     {
-        ui->navigationList->setCurrentRow(0);
+        setCurrentRow(0);
     }
 
     updateOpenBookmarksButton();
@@ -286,17 +1156,18 @@ void MainWindow::showBookmarkList()
 /**
  * @brief Восстанавливает элементы навигационного списка после скрытия закладок.
  *
- * Загружает данные из основного JSON файла (data.json) и восстанавливает навигациионный список со всеми разделами.
+ * Выключает режим закладок в модели навигации, и список снова показывает все разделы оглавления
+ * без повторного чтения data.json.
  */
 void MainWindow::restoreNavigationList()
 {
-    ui->navigationList->clear();
+    navigationModel->setShowBookmarksOnly(false);
+    setNavigationModel(tocTree);
+    session->setBookmarksShown(false);
 
-    loadDataFromFile(":/data.json");
-
-    if (ui->navigationList->count() > 0)
+    if (navigationRowCount() > 0)
     {
-        ui->navigationList->setCurrentRow(0);
+        setCurrentRow(0);
     }
 }
 
@@ -311,18 +1182,22 @@ void MainWindow::restoreNavigationList()
  */
 void MainWindow::on_OpenBookmarksButton_clicked()
 {
-    if (showingBookmarks)
+    setShowingBookmarks(!showingBookmarks);
+}
+
+void MainWindow::setShowingBookmarks(bool show)
+{
+    if (show)
     {
-        restoreNavigationList();
-        showingBookmarks = false;
-        ui->OpenBookmarksButton->setText("Показать закладки");
+        showBookmarkList();
+        ui->OpenBookmarksButton->setText("Скрыть закладки");
     }
     else
     {
-        showBookmarkList();
-        showingBookmarks = true;
-        ui->OpenBookmarksButton->setText("Скрыть закладки");
+        restoreNavigationList();
+        ui->OpenBookmarksButton->setText("Показать закладки");
     }
+    showingBookmarks = show;
     updateBookmarkButton();
     updateNavigationButtons();
 }
@@ -343,27 +1218,15 @@ void MainWindow::on_OpenBookmarksButton_clicked()
  */
 void MainWindow::on_BookmarkButton_clicked()
 {
-    int currentRow = ui->navigationList->currentRow();
+    int currentRow = this->currentRow();
     if (currentRow >= 0)
     {
-        QListWidgetItem* currentItem = ui->navigationList->item(currentRow);
-        if (currentItem)
+        QString filePath = filePathAt(currentRow);
+        if (!filePath.isEmpty())
         {
-            QString title = currentItem->text();
-            QString filePath = currentItem->data(Qt::UserRole).toString();
+            QString title = titleAt(currentRow);
 
-            bool alreadyBookmarked = false;
-            int bookmarkIndex = -1;
-
-            for (int i = 0; i < bookmarks.size(); ++i)
-            {
-                if (bookmarks[i].second == filePath)
-                {
-                    alreadyBookmarked = true;
-                    bookmarkIndex = i;
-                    break;
-                }
-            }
+            bool alreadyBookmarked = bookmarks.contains(filePath);
 
             if (!alreadyBookmarked)
             {
@@ -377,7 +1240,8 @@ void MainWindow::on_BookmarkButton_clicked()
 
                 if (confirmBox.exec() == QMessageBox::Yes)
                 {
-                    bookmarks.append(qMakePair(title, filePath));
+                    bookmarks.add(title, filePath);
+                    navigationModel->appendBookmarkRow(tocModel->rowOfFilePath(filePath));
                     qDebug() << "Закладка добавлена: " << title;
 
                     QMessageBox msgbox;
@@ -404,8 +1268,8 @@ void MainWindow::on_BookmarkButton_clicked()
 
                     if (confirmBox.exec() == QMessageBox::Yes)
                     {
-                        bookmarks.removeAt(bookmarkIndex);
-                        delete ui->navigationList->takeItem(currentRow);
+                        bookmarks.remove(filePath);
+                        navigationModel->removeBookmarkRow(tocModel->rowOfFilePath(filePath));
                         qDebug() << "Закладка удалена: " << title;
 
                         if (bookmarks.isEmpty())
@@ -437,24 +1301,24 @@ void MainWindow::on_BookmarkButton_clicked()
  * @brief Обновляет состояние кнопки "Открыть/Скрыть закладки"
  *
  * Эта функция изменяет состояние кнопки "Открыть/Скрыть закладки" в зависимости от наличия закладок.
- * Если список закладок пуст, кнопка отключается и ей назначается стиль для неактивного состояния.
- * В противном случае кнопка становится активной и ей назначается стиль для активного состояния.
+ * Если список закладок пуст, кнопка отключается и получает состояние "disabled" темы.
+ * В противном случае кнопка становится активной и получает состояние "normal".
  *
  */
 void MainWindow::updateOpenBookmarksButton()
 {
-    QString bookmarksButtonStyle = "background-color: rgb(72, 61, 139); border-radius: 10px; border: 1px solid transparent; color: #FFFFFF; font-family: \"Inter var\",ui-sans-serif,system-ui,-apple-system,system-ui,\"Segoe UI\",Roboto,\"Helvetica Neue\",Arial,\"Noto Sans\",sans-serif,\"Apple Color Emoji\",\"Segoe UI Emoji\",\"Segoe UI Symbol\",\"Noto Color Emoji\";";
-    QString bookmarksButtonDisabledStyle = "background-color: #231b62; color: #a9a9a9; border-radius: 10px;";
+    TraceSpan span("style.apply", "style");
+    span.setDetail("OpenBookmarksButton");
 
     if (bookmarks.isEmpty())
     {
         ui->OpenBookmarksButton->setEnabled(false);
-        ui->OpenBookmarksButton->setStyleSheet(bookmarksButtonDisabledStyle);
+        Theme::setState(ui->OpenBookmarksButton, "disabled");
     }
     else
     {
         ui->OpenBookmarksButton->setEnabled(true);
-        ui->OpenBookmarksButton->setStyleSheet(bookmarksButtonStyle);
+        Theme::setState(ui->OpenBookmarksButton, "normal");
     }
 }
 
@@ -474,48 +1338,38 @@ void MainWindow::updateOpenBookmarksButton()
  */
 void MainWindow::updateBookmarkButton()
 {
-    QString bookmarksButtonStyle = "background-color: rgb(72, 61, 139); border-radius: 10px; border: 1px solid transparent; color: #FFFFFF; font-family: \"Inter var\",ui-sans-serif,system-ui,-apple-system,system-ui,\"Segoe UI\",Roboto,\"Helvetica Neue\",Arial,\"Noto Sans\",sans-serif,\"Apple Color Emoji\",\"Segoe UI Emoji\",\"Segoe UI Symbol\",\"Noto Color Emoji\";";
-    QString bookmarksButtonDisabledStyle = "background-color: #231b62; color: #a9a9a9; border-radius: 10px;";
+    TraceSpan span("style.apply", "style");
+    span.setDetail("BookmarkButton");
 
-    int currentRow = ui->navigationList->currentRow();
+    int currentRow = this->currentRow();
     if (currentRow < 0) {
         return;
     }
 
-    QListWidgetItem* currentItem = ui->navigationList->item(currentRow);
-    if (!currentItem) {
+    QString filePath = filePathAt(currentRow);
+    if (filePath.isEmpty()) {
         return;
     }
 
-    QString filePath = currentItem->data(Qt::UserRole).toString();
-
-    bool alreadyBookmarked = false;
-    for (const auto& bookmark : bookmarks)
-    {
-        if (bookmark.second == filePath)
-        {
-            alreadyBookmarked = true;
-            break;
-        }
-    }
+    bool alreadyBookmarked = bookmarks.contains(filePath);
 
     if (alreadyBookmarked && showingBookmarks)
     {
         ui->BookmarkButton->setText("Удалить из закладок");
         ui->BookmarkButton->setEnabled(true);
-        ui->BookmarkButton->setStyleSheet(bookmarksButtonStyle);
+        Theme::setState(ui->BookmarkButton, "normal");
     }
     else if (alreadyBookmarked && !showingBookmarks)
     {
         ui->BookmarkButton->setText("Добавить в закладки");
         ui->BookmarkButton->setEnabled(false);
-        ui->BookmarkButton->setStyleSheet(bookmarksButtonDisabledStyle);
+        Theme::setState(ui->BookmarkButton, "disabled");
     }
     else if (!alreadyBookmarked)
     {
         ui->BookmarkButton->setText("Добавить в закладки");
         ui->BookmarkButton->setEnabled(true);
-        ui->BookmarkButton->setStyleSheet(bookmarksButtonStyle);
+        Theme::setState(ui->BookmarkButton, "normal");
     }
 }
 
@@ -525,8 +1379,9 @@ void MainWindow::updateBookmarkButton()
  * Функция проверяет, есть ли предыдущие и последующие элементы в списке навигации (ui->navigationList),
  * и на основе этого активирует или деактивирует кнопки навигации.
  *
- * Если текущий элемент не первый в списке, кнопка "Предыдущая страница" становится активной и применяет
- * стиль для активной кнопки. Если элемент первый, кнопка деактивируется и применяет стиль для неактивной кнопки.
+ * Если текущий элемент не первый в списке, кнопка "Предыдущая страница" становится активной и получает
+ * состояние "normal" темы. Если элемент первый, кнопка деактивируется и получает состояние "disabled".
+ * Стиль заново применяется только к кнопке, состояние которой действительно изменилось.
  *
  * Аналогично, если текущий элемент не последний в списке, кнопка "Следующая страница" активируется,
  * в противном случае она становится неактивной.
@@ -534,29 +1389,29 @@ void MainWindow::updateBookmarkButton()
  */
 void MainWindow::updateNavigationButtons()
 {
-    QString navigationButtonsStyle = "background-color: rgb(125, 113, 216); border: 1px solid transparent; color: #FFFFFF; font-family: \"Inter var\",ui-sans-serif,system-ui,-apple-system,system-ui,\"Segoe UI\",Roboto,\"Helvetica Neue\",Arial,\"Noto Sans\",sans-serif,\"Apple Color Emoji\",\"Segoe UI Emoji\",\"Segoe UI Symbol\",\"Noto Color Emoji\";";
-    QString navigationButtonsDisabledStyle = "background-color: #231e44; color: #a9a9a9; border-radius: 10px;";
+    TraceSpan span("style.apply", "style");
+    span.setDetail("NavigationButtons");
 
-    if (ui->navigationList->currentRow() > 0)
+    if (currentRow() > 0)
     {
         ui->PreviousPageButton->setEnabled(true);
-        ui->PreviousPageButton->setStyleSheet(navigationButtonsStyle);
+        Theme::setState(ui->PreviousPageButton, "normal");
     }
     else
     {
         ui->PreviousPageButton->setEnabled(false);
-        ui->PreviousPageButton->setStyleSheet(navigationButtonsDisabledStyle);
+        Theme::setState(ui->PreviousPageButton, "disabled");
     }
 
-    if (ui->navigationList->currentRow() < ui->navigationList->count() - 1)
+    if (nextRowExists())
     {
         ui->NextPageButton->setEnabled(true);
-        ui->NextPageButton->setStyleSheet(navigationButtonsStyle);
+        Theme::setState(ui->NextPageButton, "normal");
     }
     else
     {
         ui->NextPageButton->setEnabled(false);
-        ui->NextPageButton->setStyleSheet(navigationButtonsDisabledStyle);
+        Theme::setState(ui->NextPageButton, "disabled");
     }
 }
 
@@ -564,15 +1419,28 @@ void MainWindow::updateNavigationButtons()
  * @brief Слот, вызываемый при нажатии кнопки "Следующая страница".
  *
  * Функция перемещает выделение в списке (ui->navigationList) на следующий элемент,
- * если текущий элемент не является последним. После этого обновляется состояние
- * кнопок навигации для синхронизации их активности (вызов updateNavigationButtons()).
+ * если текущий элемент не является последним. В дереве оглавления следующий элемент берется
+ * в порядке чтения: первый раздел, затем следующая запись уровня; загружается только нужный уровень.
+ * После этого обновляется состояние кнопок навигации для синхронизации их активности
+ * (вызов updateNavigationButtons()).
  */
 void MainWindow::on_NextPageButton_clicked()
 {
-    int currentRow = ui->navigationList->currentRow();
-    if (currentRow < ui->navigationList->count() - 1)
+    int currentRow = this->currentRow();
+    if (navigationModel->showBookmarksOnly())
     {
-        ui->navigationList->setCurrentRow(currentRow + 1);
+        if (currentRow < navigationRowCount() - 1)
+        {
+            setCurrentRow(currentRow + 1);
+        }
+    }
+    else
+    {
+        const int next = tocModel->nextRow(currentRow);
+        if (next >= 0)
+        {
+            setCurrentRow(next);
+        }
     }
 
     updateNavigationButtons();
@@ -582,15 +1450,16 @@ void MainWindow::on_NextPageButton_clicked()
  * @brief Слот, вызываемый при нажатии кнопки "Предыдущая страница".
  *
  * Функция перемещает выделение в списке (ui->navigationList) на предыдущий элемент,
- * если текущий элемент не является первым. После этого обновляется состояние
- * кнопок навигации для синхронизации их активности (вызов updateNavigationButtons()).
+ * если текущий элемент не является первым. В дереве оглавления это предыдущая запись в порядке
+ * чтения. После этого обновляется состояние кнопок навигации для синхронизации их активности
+ * (вызов updateNavigationButtons()).
  */
 void MainWindow::on_PreviousPageButton_clicked()
 {
-    int currentRow = ui->navigationList->currentRow();
+    int currentRow = this->currentRow();
     if (currentRow > 0)
     {
-        ui->navigationList->setCurrentRow(currentRow - 1);
+        setCurrentRow(navigationModel->showBookmarksOnly() ? currentRow - 1 : tocModel->previousRow(currentRow));
     }
 
     updateNavigationButtons();
@@ -640,4 +1509,227 @@ void MainWindow::on_menuAbout_triggered()
     msgbox.exec();       
 }
 
+/**
+ * @brief Слот для пункта меню "Темная тема".
+ *
+ * Переключает вариант темы окна. Таблица стилей при этом не пересобирается.
+ *
+ * @param checked true для темной темы, false для светлой.
+ */
+void MainWindow::on_menuDarkTheme_toggled(bool checked)
+{
+    TraceSpan span("style.apply", "style");
+    span.setDetail("theme");
+    Theme::setTheme(this, checked ? Theme::Dark : Theme::Light);
+}
+
+PageView *MainWindow::currentView() const
+{
+    return static_cast<PageView*>(ui->pageTabs->currentWidget());
+}
+
+void MainWindow::updateTabTitle(PageView *view)
+{
+    const QString filePath = view->filePath();
+    const int row = tocModel->rowOfFilePath(filePath);
+    const QString title = row >= 0 ? tocModel->title(row) : QFileInfo(filePath).completeBaseName();
+    const int index = ui->pageTabs->indexOf(view);
+    ui->pageTabs->setTabText(index, title);
+    ui->pageTabs->setTabToolTip(index, title);
+}
+
+/**
+ * @brief Открывает страницу в новой вкладке.
+ *
+ * Документ страницы не копируется: если она уже открыта в другой вкладке или лежит в кэше,
+ * новая вкладка показывает тот же документ. Вкладка становится текущей, и документ подставляется
+ * в нее в on_pageTabs_currentChanged().
+ *
+ * @param filePath Путь к странице.
+ */
+void MainWindow::openTab(const QString &filePath)
+{
+    if (filePath.isEmpty())
+    {
+        return;
+    }
+
+    PageView* view = new PageView(ui->pageTabs);
+    view->setFilePath(filePath);
+    connectView(view);
+
+    const int index = ui->pageTabs->addTab(view, QString());
+    view->ensurePolished();
+    ui->pageTabs->setCurrentIndex(index);
+}
+
+void MainWindow::connectView(PageView *view)
+{
+    // Положение прокрутки запоминается для каждой страницы и записывается в файл состояния с задержкой.
+    connect(view, &PageView::scrollPositionChanged, this, [this, view](int position) {
+        session->setScrollPosition(view->filePath(), position);
+    });
+
+    connect(view, &QTextBrowser::anchorClicked, this, [this, view](const QUrl& url) { openLink(view, url); });
+}
+
+void MainWindow::openLink(PageView *view, const QUrl &url)
+{
+    const QString pageDir = QFileInfo(ContentPack::entryName(view->filePath())).path();
+    const PageReferences::Link link = PageReferences::resolveLink(url.toString(), pageDir);
+    if (link.external)
+    {
+        QDesktopServices::openUrl(url);
+        return;
+    }
+    if (link.empty)
+    {
+        return;
+    }
+
+    const QString filePath = link.entryName.isEmpty() ? view->filePath() : ":/" + link.entryName;
+    if (filePath == view->filePath())
+    {
+        showAnchor(view, link.anchor);
+        return;
+    }
+
+    if (tocModel->rowOfFilePath(filePath) < 0)
+    {
+        qDebug() << "Ссылка на страницу, которой нет в оглавлении:" << url.toString();
+        return;
+    }
+
+    // Страница загружается как при выборе в списке, а якорь прокручивается в displayDocument().
+    linkTargetPath = filePath;
+    linkTargetAnchor = link.anchor;
+    selectPage(filePath);
+}
+
+void MainWindow::showAnchor(PageView *view, const QString &anchor)
+{
+    if (anchor.isEmpty())
+    {
+        return;
+    }
+
+    // Якорь, который еще не сверстан, дописывает страницу до него раньше остальных частей.
+    if (progressiveRenderer->isActive() && progressiveRenderer->filePath() == view->filePath())
+    {
+        progressiveRenderer->ensureAnchorLoaded(anchor);
+    }
+    view->showAnchor(anchor);
+}
+
+/**
+ * @brief Слот для пункта меню "Быстрый переход".
+ *
+ * Выбранная страница выделяется в списке навигации, как если бы пользователь нашел ее там сам.
+ */
+void MainWindow::on_menuQuickOpen_triggered()
+{
+    if (!quickOpen)
+    {
+        quickOpen = new QuickOpenDialog(tocModel, this);
+        connect(quickOpen, &QuickOpenDialog::pageChosen, this, [this](const QString& filePath) {
+            selectPage(filePath);
+            currentView()->setFocus();
+        });
+    }
+    quickOpen->popup();
+}
+
+/**
+ * @brief Слот для пункта меню "Найти на странице".
+ *
+ * Поиск идет в рабочем потоке по странице текущей вкладки, поэтому набор запроса не ждет
+ * поиска даже на самых длинных страницах.
+ */
+void MainWindow::on_menuFind_triggered()
+{
+    ui->findBar->activate();
+}
+
+/**
+ * @brief Слот для пункта меню "Новая вкладка".
+ *
+ * Открывает текущую страницу во второй вкладке, после чего в одной из вкладок можно перейти
+ * к другой странице и сравнивать их, не загружая заново.
+ */
+void MainWindow::on_menuNewTab_triggered()
+{
+    openTab(currentView()->filePath());
+}
+
+/**
+ * @brief Слот для пункта меню "Закрыть вкладку".
+ */
+void MainWindow::on_menuCloseTab_triggered()
+{
+    on_pageTabs_tabCloseRequested(ui->pageTabs->currentIndex());
+}
+
+/**
+ * @brief Слот для скрытого действия "Диагностика".
+ *
+ * Действия нет в меню: окно нужно при отладке и нагрузочных прогонах, а не при чтении справочника.
+ */
+void MainWindow::on_menuDiagnostics_triggered()
+{
+    if (!diagnostics)
+    {
+        diagnostics = new DiagnosticsDialog(this);
+    }
+    diagnostics->show();
+    diagnostics->raise();
+    diagnostics->activateWindow();
+}
+
+/**
+ * @brief Закрывает вкладку. Последняя вкладка не закрывается.
+ *
+ * Документ страницы остается в кэше; если его не показывает другая вкладка и он уже вытеснен,
+ * он освобождается вместе с вкладкой.
+ *
+ * @param index Номер вкладки.
+ */
+void MainWindow::on_pageTabs_tabCloseRequested(int index)
+{
+    if (ui->pageTabs->count() <= 1)
+    {
+        return;
+    }
 
+    QWidget* view = ui->pageTabs->widget(index);
+    ui->pageTabs->removeTab(index);
+    delete view;
+}
+
+/**
+ * @brief Слот смены текущей вкладки.
+ *
+ * Список навигации следует за вкладкой. Если у вкладки еще нет документа или постепенная верстка
+ * ее страницы была прервана переходом в другой вкладке, страница запрашивается заново.
+ *
+ * @param index Номер новой текущей вкладки.
+ */
+void MainWindow::on_pageTabs_currentChanged(int index)
+{
+    Q_UNUSED(index);
+
+    PageView* view = currentView();
+    ui->findBar->setFinder(view ? view->finder() : nullptr);
+    if (!view || view->filePath().isEmpty())
+    {
+        return;
+    }
+
+    const QString filePath = view->filePath();
+    session->setCurrentPage(filePath);
+    selectPage(filePath);
+
+    if (view->pageDocument().isNull() || !pageCache.contains(filePath))
+    {
+        requestPage(filePath);
+    }
+}
@@ -8,12 +8,14 @@
  * Этот файл является заголовочным файлом главного окна приложения, содержащим объявление класса MainWindow,
  * слотов, методов и переменных, необходимых для функционирования приложения. Основная задача класса MainWindow -
  * управление пользовательским интерфейсом приложения, реализация навигации по разделам справочника, добавления
- * закладок и работы с сохраненными закладками. Используются элементы управления Qt, такие как QListWidget,
- * QTextBrowser.
+ * закладок и работы с сохраненными закладками. Используются элементы управления Qt, такие как QTreeView
+ * с деревом оглавления TocTreeModel, QTextBrowser.
  */
 
 #include <QMainWindow>
 #include <QApplication>
+#include <QListView>
+#include <QTreeView>
 #include <QListWidget>
 #include <QTextBrowser>
 #include <QFile>
@@ -26,6 +28,25 @@
 #include <QPair>
 #include <QVector>
 #include <QCloseEvent>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QTextDocument>
+
+#include "asyncpageloader.h"
+#include "bookmarkstore.h"
+#include "contentpack.h"
+#include "contentwatcher.h"
+#include "diagnosticsdialog.h"
+#include "findbar.h"
+#include "imageloader.h"
+#include "pagecache.h"
+#include "pageview.h"
+#include "pageprefetcher.h"
+#include "progressiverenderer.h"
+#include "quickopendialog.h"
+#include "searchindex.h"
+#include "sessionstate.h"
+#include "tocmodel.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -46,6 +67,8 @@ class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
+    friend class HandbookBench; ///< Замеры производительности обращаются к закрытым методам напрямую.
+
 public:
     /**
      * @brief Конструктор класса MainWindow.
@@ -58,9 +81,32 @@ public:
      */
     ~MainWindow();
 
+    /**
+     * @brief Загружает текст из файла.
+     *
+     * Функция потокобезопасна и используется также фоновой загрузкой страниц и пакетным экспортом.
+     * @param filePath Путь к файлу.
+     * @return Строка с содержимым файла.
+     */
+    static QString loadTextFromFile(const QString& filePath);
+
+    /**
+     * @brief Возвращает размер и время изменения файла страницы, из которого ее читает loadTextFromFile.
+     *
+     * Для страниц пакета содержимого возвращает пустое значение: их хеши записаны в data.json пакета.
+     * Функция потокобезопасна.
+     * @param filePath Путь к странице.
+     */
+    static SearchIndex::FileStamp pageStamp(const QString& filePath);
+
 protected:
     void closeEvent(QCloseEvent *event) override;
 
+    /**
+     * @brief Отслеживает первую отрисовку восстановленной страницы, чтобы после нее закончить запуск.
+     */
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
 private slots:
     /**
      * @brief Слот для кнопки перехода на следующую страницу.
@@ -80,6 +126,55 @@ private slots:
      */
     void on_menuAbout_triggered();
 
+    /**
+     * @brief Слот для переключения светлой и темной темы.
+     * @param checked true, если выбрана темная тема.
+     */
+    void on_menuDarkTheme_toggled(bool checked);
+
+    /**
+     * @brief Слот для пункта меню "Быстрый переход".
+     * Показывает окно поиска страницы по названию; индекс названий строится при первом открытии.
+     */
+    void on_menuQuickOpen_triggered();
+
+    /**
+     * @brief Слот для пункта меню "Найти на странице".
+     * Показывает панель поиска по странице текущей вкладки.
+     */
+    void on_menuFind_triggered();
+
+    /**
+     * @brief Слот для пункта меню "Новая вкладка".
+     * Открывает текущую страницу в новой вкладке.
+     */
+    void on_menuNewTab_triggered();
+
+    /**
+     * @brief Слот для пункта меню "Закрыть вкладку".
+     * Закрывает текущую вкладку, если она не последняя.
+     */
+    void on_menuCloseTab_triggered();
+
+    /**
+     * @brief Слот для скрытого действия "Диагностика" (Ctrl+Shift+D).
+     * Показывает окно со счетчиками и гистограммами работающей программы.
+     */
+    void on_menuDiagnostics_triggered();
+
+    /**
+     * @brief Слот для кнопки закрытия вкладки.
+     * @param index Номер вкладки.
+     */
+    void on_pageTabs_tabCloseRequested(int index);
+
+    /**
+     * @brief Слот смены текущей вкладки.
+     * Выделяет в списке навигации страницу вкладки и при необходимости загружает ее документ.
+     * @param index Номер новой текущей вкладки.
+     */
+    void on_pageTabs_currentChanged(int index);
+
     /**
      * @brief Слот для отображения или скрытия списка закладок.
      * Показывает или скрывает список закладок в зависимости от текущего состояния.
@@ -99,15 +194,73 @@ private slots:
      */
     void onNavigationItemSelected(int currentRow);
 
+    /**
+     * @brief Слот для изменения текста в строке поиска.
+     * Выполняет поиск по индексу и показывает список найденных страниц вместо списка навигации.
+     * @param text Текст запроса.
+     */
+    void on_searchLineEdit_textChanged(const QString& text);
+
+    /**
+     * @brief Слот для выбора результата поиска.
+     * Открывает найденную страницу.
+     * @param item Выбранный результат.
+     */
+    void on_searchResultsList_itemClicked(QListWidgetItem* item);
+
 private:
-    QListWidget* navigationList; ///< Список навигации для выбора разделов справочника.
+    Ui::MainWindow *ui; ///< Указатель на графический интерфейс пользователя.
+
+    TocModel* tocModel; ///< Оглавление справочника из data.json.
+    BookmarkFilterModel* navigationModel; ///< Модель списка навигации: все страницы или только закладки.
+    TocTreeModel* tocTree; ///< Дерево оглавления, показываемое вне режима закладок.
 
     /**
-     * @brief Загружает текст из файла.
-     * @param filePath Путь к файлу.
-     * @return Строка с содержимым файла.
+     * @brief Показывает в списке навигации дерево оглавления или плоский список закладок.
+     *
+     * Номера строк списка навигации — это строки TocModel (в порядке обхода в глубину) для дерева
+     * и строки BookmarkFilterModel для закладок.
+     */
+    void setNavigationModel(QAbstractItemModel* model);
+
+    /**
+     * @brief Возвращает текущую строку списка навигации или -1.
+     */
+    int currentRow() const;
+
+    /**
+     * @brief Делает строку списка навигации текущей.
+     * @param row Номер строки.
+     */
+    void setCurrentRow(int row);
+
+    /**
+     * @brief Возвращает количество строк в списке навигации.
+     */
+    int navigationRowCount() const;
+
+    /**
+     * @brief Есть ли элемент после текущего: в списке закладок или в порядке чтения оглавления.
+     */
+    bool nextRowExists() const;
+
+    /**
+     * @brief Возвращает путь к странице в строке списка навигации.
+     * @param row Номер строки.
+     * @return Путь или пустая строка, если строки нет.
+     */
+    QString filePathAt(int row) const;
+
+    /**
+     * @brief Возвращает название страницы в строке списка навигации.
+     * @param row Номер строки.
+     */
+    QString titleAt(int row) const;
+
+    /**
+     * @brief Передает в модель навигации строки оглавления, находящиеся в закладках.
      */
-    QString loadTextFromFile(const QString& filePath);
+    void syncBookmarkRows();
 
     /**
      * @brief Загружает стиль из файла.
@@ -116,6 +269,136 @@ private:
      */
     QString loadStyleSheetFromFile(const QString& filePath);
 
+    /**
+     * @brief Создает готовый к показу документ страницы.
+     *
+     * Читает HTML файл, разбирает его в QTextDocument со шрифтом текстового поля и сразу выполняет
+     * верстку по текущей ширине области просмотра, чтобы повторный показ страницы обходился без разбора.
+     * Большие страницы верстаются постепенно через ProgressiveRenderer.
+     * @param filePath Путь к HTML файлу.
+     * @return Документ или пустой указатель, если файл не удалось прочитать.
+     */
+    QSharedPointer<QTextDocument> buildPageDocument(const QString& filePath);
+
+    /**
+     * @brief Показывает страницу, беря документ из кэша или создавая его.
+     * @param filePath Путь к HTML файлу.
+     * @return true, если страница показана.
+     */
+    bool showPage(const QString& filePath);
+
+    /**
+     * @brief Запрашивает показ страницы: из кэша сразу, иначе через асинхронную загрузку.
+     * @param filePath Путь к HTML файлу.
+     */
+    void requestPage(const QString& filePath);
+
+    /**
+     * @brief Показывает готовый документ в текущей вкладке и запускает подготовку соседних страниц.
+     * @param filePath Путь к странице.
+     * @param document Документ страницы.
+     */
+    void displayDocument(const QString& filePath, const QSharedPointer<QTextDocument>& document);
+
+    /**
+     * @brief Возвращает вкладку, которая сейчас показана.
+     */
+    PageView* currentView() const;
+
+    /**
+     * @brief Подписывает вкладку названием ее страницы из оглавления.
+     * @param view Вкладка.
+     */
+    void updateTabTitle(PageView* view);
+
+    /**
+     * @brief Выполняет часть запуска, не нужную для показа первой страницы.
+     *
+     * Загружает закладки и оглавление, запускает построение поискового индекса и выделяет
+     * показанную страницу в списке навигации. Если последняя страница прошлого сеанса уже показана,
+     * вызывается после ее первой отрисовки; повторный вызов ничего не делает.
+     */
+    void finishStartup();
+
+    /**
+     * @brief Открывает страницу в новой вкладке и делает ее текущей.
+     * @param filePath Путь к странице.
+     */
+    void openTab(const QString& filePath);
+
+    /**
+     * @brief Подключает сигналы вкладки к главному окну.
+     * @param view Вкладка.
+     */
+    void connectView(PageView* view);
+
+    /**
+     * @brief Переходит по ссылке, нажатой на странице вкладки.
+     *
+     * Ссылка на другую страницу выделяет ее в списке навигации, и страница загружается как при
+     * любом переходе; якорь прокручивается после показа. Внешние ссылки открываются в браузере.
+     * @param view Вкладка со ссылкой.
+     * @param url Адрес ссылки.
+     */
+    void openLink(PageView* view, const QUrl& url);
+
+    /**
+     * @brief Прокручивает вкладку к якорю, дописывая постепенно верстаемую страницу до него.
+     */
+    void showAnchor(PageView* view, const QString& anchor);
+
+    /**
+     * @brief Запускает фоновую подготовку страниц вокруг текущей строки списка.
+     *
+     * В оглавлении соседи берутся в порядке чтения (nextRow()/previousRow()), в закладках — по строкам списка.
+     * @param currentRow Текущая строка списка навигации.
+     */
+    void prefetchAround(int currentRow);
+
+    /**
+     * @brief Запускает фоновое построение поискового индекса по всем страницам списка навигации.
+     *
+     * Если построение уже идет, новое начнется после его окончания.
+     */
+    void startSearchIndexBuild();
+
+    /**
+     * @brief Запускает фоновую замену в поисковом индексе данных измененных страниц.
+     *
+     * Если построение уже идет, страницы обновятся после его окончания.
+     * @param filePaths Пути измененных страниц оглавления.
+     */
+    void updateSearchIndex(const QStringList& filePaths);
+    void watchSearchIndexTask(const QFuture<SearchIndex>& future);
+
+    /**
+     * @brief Начинает следить за каталогом содержимого в режиме разработки (HANDBOOK_CONTENT_DIR).
+     */
+    void startContentWatcher();
+
+    /**
+     * @brief Передает ContentWatcher пути всех страниц оглавления.
+     */
+    void watchContentPages();
+
+    /**
+     * @brief Обновляет измененные страницы: сбрасывает их документы и перерисовывает открытую страницу.
+     * @param filePaths Пути страниц, файлы которых изменились.
+     */
+    void reloadChangedPages(const QStringList& filePaths);
+
+    /**
+     * @brief Перечитывает оглавление после изменения data.json в каталоге содержимого.
+     */
+    void reloadCatalog();
+
+    /**
+     * @brief Выделяет в списке навигации страницу с указанным путем.
+     * Если показаны закладки и страницы среди них нет, восстанавливает полный список.
+     * @param filePath Путь к странице.
+     */
+    void selectPage(const QString& filePath);
+
     /**
      * @brief Загружает данные из файла JSON.
      * @param fileName Имя файла.
@@ -135,15 +418,30 @@ private:
      */
     void showBookmarkList();
 
+    /**
+     * @brief Переключает список навигации между всеми страницами и закладками.
+     * Меняет текст кнопки "Показать закладки" и обновляет кнопки закладки и навигации.
+     * @param show true — показать закладки, false — все страницы.
+     */
+    void setShowingBookmarks(bool show);
+
+    /**
+     * @brief Возвращает путь к файлу данных программы: закладок, состояния сеанса или поискового индекса.
+     *
+     * Файлы лежат рядом с программой или в каталоге из переменной окружения HANDBOOK_DATA_DIR.
+     * @param fileName Имя файла.
+     */
+    static QString dataFilePath(const QString& fileName);
+
     /**
      * @brief Сохраняет текущие закладки в файл.
-     * Позволяет сохранить список закладок между сеансами работы с приложением.
+     * Сворачивает журнал изменений закладок в снимок bookmarks.json.
      */
     void saveBookmarksToFile();
 
     /**
      * @brief Загружает закладки из файла.
-     * Восстанавливает список закладок, сохраненный ранее.
+     * Восстанавливает список закладок из снимка и журнала изменений.
      */
     void loadBookmarksFromFile();
 
@@ -165,9 +463,32 @@ private:
      */
     void updateOpenBookmarksButton();
 
-    QVector<QPair<QString, QString>> bookmarks; ///< Вектор для хранения закладок (название и путь к странице).
+    BookmarkStore bookmarks; ///< Закладки (название и путь к странице) с журналом изменений.
     bool showingBookmarks; ///< Флаг, указывающий, отображаются ли в данный момент закладки.
 
-    Ui::MainWindow *ui; ///< Указатель на графический интерфейс пользователя.
+    PageCache pageCache; ///< Кэш сверстанных документов и общее хранилище документов вкладок.
+    PagePrefetcher* prefetcher; ///< Фоновая подготовка соседних страниц.
+    QStringList prefetchNeighbours; ///< Страницы, подготовка которых запускалась последней.
+    ProgressiveRenderer* progressiveRenderer; ///< Постепенная верстка больших страниц.
+    AsyncPageLoader* pageLoader; ///< Асинхронная загрузка выбранной страницы.
+    ImageLoader* imageLoader; ///< Фоновое декодирование изображений страниц и кэш картинок.
+    SessionState* session; ///< Последняя страница, режим закладок и прокрутка страниц между запусками.
+    bool startupFinished = false; ///< finishStartup() уже выполнен.
+
+    QuickOpenDialog* quickOpen = nullptr; ///< Окно быстрого перехода; создается при первом открытии.
+    DiagnosticsDialog* diagnostics = nullptr; ///< Окно диагностики; создается при первом открытии.
+
+    QString pageLoadPath; ///< Страница, время загрузки которой сейчас измеряется.
+    QString linkTargetPath; ///< Страница, открытая по ссылке, до ее показа.
+    QString linkTargetAnchor; ///< Якорь ссылки на linkTargetPath.
+    qint64 pageLoadStart = 0; ///< Время запроса pageLoadPath по Metrics::now().
+
+    SearchIndex searchIndex; ///< Полнотекстовый индекс страниц справочника.
+    QFutureWatcher<SearchIndex>* searchIndexWatcher = nullptr; ///< Наблюдатель за построением индекса.
+    bool searchIndexStale = false; ///< Оглавление изменилось во время построения индекса.
+    QStringList staleIndexPages; ///< Страницы, измененные во время построения индекса.
+    bool searchIndexPatching = false; ///< Идет замена отдельных страниц, а не построение по всему оглавлению.
+
+    ContentWatcher* contentWatcher = nullptr; ///< Наблюдение за каталогом содержимого в режиме разработки.
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,242 @@
+/**
+ * @file metrics.cpp
+ * @brief Реализация счетчиков и гистограмм работающей программы.
+ */
+
+#include "metrics.h"
+
+#include <QJsonArray>
+
+#include <cmath>
+
+LatencyHistogram Metrics::pageLoad("page.load");
+LatencyHistogram Metrics::pageRead("page.read");
+LatencyHistogram Metrics::pageParse("page.parse");
+LatencyHistogram Metrics::pageLayout("page.layout");
+MetricCounter Metrics::pageBytesRead("page.bytesRead");
+MetricCounter Metrics::pageCacheHits("page.cache.hits");
+MetricCounter Metrics::pageCacheMisses("page.cache.misses");
+MetricGauge Metrics::residentDocumentBytes("page.cache.residentBytes");
+MetricGauge Metrics::residentDocuments("page.cache.documents");
+
+LatencyHistogram Metrics::bookmarksLoad("bookmarks.load");
+LatencyHistogram Metrics::bookmarksSave("bookmarks.save");
+LatencyHistogram Metrics::bookmarksJournal("bookmarks.journal");
+MetricCounter Metrics::bookmarkBytesRead("bookmarks.bytesRead");
+MetricCounter Metrics::bookmarkBytesWritten("bookmarks.bytesWritten");
+
+namespace {
+
+/// Время запуска программы для "uptimeMs".
+const qint64 startTime = Metrics::now();
+
+// Порядок метрик в снимке и в окне диагностики.
+const MetricCounter* const counters[] = {
+    &Metrics::pageBytesRead,
+    &Metrics::pageCacheHits,
+    &Metrics::pageCacheMisses,
+    &Metrics::bookmarkBytesRead,
+    &Metrics::bookmarkBytesWritten,
+};
+
+const MetricGauge* const gauges[] = {
+    &Metrics::residentDocumentBytes,
+    &Metrics::residentDocuments,
+};
+
+const LatencyHistogram* const histograms[] = {
+    &Metrics::pageLoad,
+    &Metrics::pageRead,
+    &Metrics::pageParse,
+    &Metrics::pageLayout,
+    &Metrics::bookmarksLoad,
+    &Metrics::bookmarksSave,
+    &Metrics::bookmarksJournal,
+};
+
+/// Процентили в снимке: доля и имя поля.
+const struct
+{
+    double fraction;
+    const char* key;
+} percentiles[] = {
+    {0.5, "p50Us"},
+    {0.9, "p90Us"},
+    {0.99, "p99Us"},
+    {0.999, "p999Us"},
+};
+
+} // namespace
+
+void LatencyHistogram::record(qint64 micros)
+{
+    const qint64 value = qMax<qint64>(0, micros);
+    buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    qint64 previous = max.load(std::memory_order_relaxed);
+    while (previous < value && !max.compare_exchange_weak(previous, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    // Количество считается по интервалам, чтобы процентили не выходили за пределы гистограммы.
+    Snapshot result;
+    result.buckets.resize(BucketCount);
+    for (int bucket = 0; bucket < BucketCount; ++bucket)
+    {
+        const qint64 value = buckets[bucket].load(std::memory_order_relaxed);
+        result.buckets[bucket] = value;
+        result.count += value;
+    }
+    result.sum = sum.load(std::memory_order_relaxed);
+    result.max = max.load(std::memory_order_relaxed);
+    return result;
+}
+
+/**
+ * @brief Значения меньше 2 * SubBucketCount хранятся точно, дальше каждая степень двойки
+ *        делится на SubBucketCount интервалов одинаковой ширины.
+ */
+int LatencyHistogram::bucketOf(qint64 value)
+{
+    if (value < SubBucketCount)
+    {
+        return int(value);
+    }
+
+    int exponent = 0;
+    for (quint64 rest = quint64(value); rest > 1; rest >>= 1)
+    {
+        ++exponent;
+    }
+    if (exponent >= MaxExponent)
+    {
+        return BucketCount - 1;
+    }
+
+    const int shift = exponent - SubBucketBits;
+    return (shift + 1) * SubBucketCount + int(value >> shift) - SubBucketCount;
+}
+
+qint64 LatencyHistogram::bucketLowerBound(int bucket)
+{
+    if (bucket < SubBucketCount)
+    {
+        return bucket;
+    }
+    const int shift = bucket / SubBucketCount - 1;
+    return qint64(SubBucketCount + bucket % SubBucketCount) << shift;
+}
+
+/**
+ * @brief Возвращает наибольшее значение интервала, в который попала запись с нужным номером.
+ */
+qint64 LatencyHistogram::Snapshot::percentile(double fraction) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    const qint64 target = qMax<qint64>(1, qint64(std::ceil(fraction * double(count))));
+    qint64 seen = 0;
+    for (int bucket = 0; bucket < buckets.size(); ++bucket)
+    {
+        seen += buckets[bucket];
+        if (seen >= target)
+        {
+            const qint64 upper = bucket + 1 < BucketCount ? bucketLowerBound(bucket + 1) - 1 : max;
+            return qMin(upper, max);
+        }
+    }
+    return max;
+}
+
+QJsonObject Metrics::snapshot()
+{
+    QJsonObject counterValues;
+    for (const MetricCounter* counter : counters)
+    {
+        counterValues.insert(counter->name(), counter->value());
+    }
+
+    QJsonObject gaugeValues;
+    for (const MetricGauge* gauge : gauges)
+    {
+        gaugeValues.insert(gauge->name(), gauge->value());
+    }
+
+    QJsonObject histogramValues;
+    for (const LatencyHistogram* histogram : histograms)
+    {
+        const LatencyHistogram::Snapshot data = histogram->snapshot();
+        QJsonObject value;
+        value.insert("count", data.count);
+        value.insert("meanUs", data.count > 0 ? double(data.sum) / double(data.count) : 0.0);
+        value.insert("maxUs", data.max);
+        for (const auto& percentile : percentiles)
+        {
+            value.insert(percentile.key, data.percentile(percentile.fraction));
+        }
+
+        QJsonArray buckets;
+        for (int bucket = 0; bucket < data.buckets.size(); ++bucket)
+        {
+            if (data.buckets[bucket] > 0)
+            {
+                buckets.append(QJsonArray{LatencyHistogram::bucketLowerBound(bucket), data.buckets[bucket]});
+            }
+        }
+        value.insert("buckets", buckets);
+        histogramValues.insert(histogram->name(), value);
+    }
+
+    QJsonObject result;
+    result.insert("uptimeMs", (now() - startTime) / 1000);
+    result.insert("counters", counterValues);
+    result.insert("gauges", gaugeValues);
+    result.insert("histograms", histogramValues);
+    return result;
+}
+
+QString Metrics::formatText()
+{
+    QString text;
+    text += QString("Время работы: %1 с\n\n").arg((now() - startTime) / 1000000);
+
+    for (const MetricCounter* counter : counters)
+    {
+        text += QString("%1 %2\n").arg(QString(counter->name()), -28).arg(counter->value());
+    }
+    text += '\n';
+    for (const MetricGauge* gauge : gauges)
+    {
+        text += QString("%1 %2\n").arg(QString(gauge->name()), -28).arg(gauge->value());
+    }
+    text += '\n';
+
+    // Длительности показываются в миллисекундах: так их удобнее сравнивать на глаз.
+    text += QString("%1 %2 %3 %4 %5 %6\n")
+                .arg(QString("мс"), -28)
+                .arg(QString("count"), 8)
+                .arg(QString("p50"), 9)
+                .arg(QString("p90"), 9)
+                .arg(QString("p99"), 9)
+                .arg(QString("max"), 9);
+    for (const LatencyHistogram* histogram : histograms)
+    {
+        const LatencyHistogram::Snapshot data = histogram->snapshot();
+        text += QString("%1 %2 %3 %4 %5 %6\n")
+                    .arg(QString(histogram->name()), -28)
+                    .arg(data.count, 8)
+                    .arg(data.percentile(0.5) / 1000.0, 9, 'f', 2)
+                    .arg(data.percentile(0.9) / 1000.0, 9, 'f', 2)
+                    .arg(data.percentile(0.99) / 1000.0, 9, 'f', 2)
+                    .arg(data.max / 1000.0, 9, 'f', 2);
+    }
+    return text;
+}
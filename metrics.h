@@ -0,0 +1,200 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+/**
+ * @file metrics.h
+ * @brief Определение классов Metrics, MetricCounter, MetricGauge, LatencyHistogram и MetricsTimer —
+ *        счетчиков и гистограмм работающей программы.
+ *
+ * В отличие от трассировки (см. Trace), метрики собираются всегда: запись значения — одна атомарная
+ * операция без блокировок и выделения памяти, поэтому ее можно делать и в рабочих потоках.
+ * Снимок всех метрик в JSON показывает скрытое окно диагностики (Ctrl+Shift+D) и отдает
+ * локальный сокет MetricsServer, если задана переменная окружения HANDBOOK_METRICS_SOCKET.
+ */
+
+#include <QJsonObject>
+#include <QVector>
+
+#include <atomic>
+#include <chrono>
+
+/**
+ * @class MetricCounter
+ * @brief Монотонный счетчик событий или байтов.
+ */
+class MetricCounter
+{
+public:
+    explicit constexpr MetricCounter(const char* name) : metricName(name) {}
+
+    void add(qint64 value = 1) { count.fetch_add(value, std::memory_order_relaxed); }
+    qint64 value() const { return count.load(std::memory_order_relaxed); }
+    const char* name() const { return metricName; }
+
+private:
+    const char* metricName;
+    std::atomic<qint64> count{0};
+};
+
+/**
+ * @class MetricGauge
+ * @brief Текущее значение величины, например занятой документами памяти.
+ */
+class MetricGauge
+{
+public:
+    explicit constexpr MetricGauge(const char* name) : metricName(name) {}
+
+    void set(qint64 value) { current.store(value, std::memory_order_relaxed); }
+    qint64 value() const { return current.load(std::memory_order_relaxed); }
+    const char* name() const { return metricName; }
+
+private:
+    const char* metricName;
+    std::atomic<qint64> current{0};
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Гистограмма длительностей в микросекундах с логарифмически-линейными интервалами (как в HdrHistogram).
+ *
+ * Каждая степень двойки делится на SubBucketCount равных интервалов, поэтому относительная
+ * погрешность процентилей не больше 1/SubBucketCount при постоянном размере гистограммы:
+ * от микросекунд до часов хватает BucketCount атомарных счетчиков.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int SubBucketBits = 4;
+    static constexpr int SubBucketCount = 1 << SubBucketBits;
+    static constexpr int MaxExponent = 36;    ///< Значения от 2^36 мкс (около 19 часов) попадают в последний интервал.
+    static constexpr int BucketCount = (MaxExponent - SubBucketBits + 1) * SubBucketCount;
+
+    /**
+     * @brief Снимок гистограммы. Счетчики читаются по одному, поэтому при одновременной записи
+     *        снимок может отставать от count на несколько значений.
+     */
+    struct Snapshot
+    {
+        qint64 count = 0;
+        qint64 sum = 0;
+        qint64 max = 0;
+        QVector<qint64> buckets;
+
+        /// Значение, не меньше которого только доля (1 - fraction) записей. 0 для пустой гистограммы.
+        qint64 percentile(double fraction) const;
+    };
+
+    explicit constexpr LatencyHistogram(const char* name) : metricName(name) {}
+
+    /**
+     * @brief Добавляет длительность в микросекундах. Отрицательные значения считаются нулем.
+     */
+    void record(qint64 micros);
+
+    Snapshot snapshot() const;
+    const char* name() const { return metricName; }
+
+    /// Номер интервала для значения.
+    static int bucketOf(qint64 value);
+
+    /// Наименьшее значение интервала.
+    static qint64 bucketLowerBound(int bucket);
+
+private:
+    const char* metricName;
+    std::atomic<qint64> buckets[BucketCount] = {};
+    std::atomic<qint64> count{0};
+    std::atomic<qint64> sum{0};
+    std::atomic<qint64> max{0};
+};
+
+/**
+ * @class Metrics
+ * @brief Все метрики программы. Метрики — статические объекты, поэтому запись в них не требует поиска по имени.
+ */
+class Metrics
+{
+public:
+    // Страницы.
+    static LatencyHistogram pageLoad;      ///< От запроса страницы до ее показа во вкладке.
+    static LatencyHistogram pageRead;      ///< Чтение файла страницы.
+    static LatencyHistogram pageParse;     ///< QTextDocument::setHtml.
+    static LatencyHistogram pageLayout;    ///< Верстка документа по ширине окна.
+    static MetricCounter pageBytesRead;
+    static MetricCounter pageCacheHits;
+    static MetricCounter pageCacheMisses;
+    static MetricGauge residentDocumentBytes;  ///< Оценка памяти документов в PageCache.
+    static MetricGauge residentDocuments;
+
+    // Закладки.
+    static LatencyHistogram bookmarksLoad;
+    static LatencyHistogram bookmarksSave;     ///< Запись снимка bookmarks.json.
+    static LatencyHistogram bookmarksJournal;  ///< Дозапись строки журнала.
+    static MetricCounter bookmarkBytesRead;
+    static MetricCounter bookmarkBytesWritten;
+
+    /**
+     * @brief Возвращает снимок всех метрик.
+     *
+     * Формат: {"uptimeMs", "counters": {имя: значение}, "gauges": {имя: значение},
+     * "histograms": {имя: {"count", "meanUs", "maxUs", "p50Us", "p90Us", "p99Us", "p999Us",
+     * "buckets": [[нижняя граница, количество], ...]}}}. В "buckets" только непустые интервалы:
+     * по ним гистограммы нескольких снимков можно сложить.
+     */
+    static QJsonObject snapshot();
+
+    /**
+     * @brief Возвращает снимок в виде текстовой таблицы для окна диагностики.
+     */
+    static QString formatText();
+
+    /// Монотонное время в микросекундах для измерения длительностей.
+    static qint64 now()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+/**
+ * @class MetricsTimer
+ * @brief Участок кода, длительность которого записывается в гистограмму при выходе из блока.
+ */
+class MetricsTimer
+{
+public:
+    explicit MetricsTimer(LatencyHistogram& histogram)
+        : histogram(&histogram)
+        , start(Metrics::now())
+    {
+    }
+
+    ~MetricsTimer() { end(); }
+
+    MetricsTimer(const MetricsTimer&) = delete;
+    MetricsTimer& operator=(const MetricsTimer&) = delete;
+
+    /**
+     * @brief Записывает длительность раньше конца блока. Повторные вызовы ничего не делают.
+     */
+    void end()
+    {
+        if (histogram)
+        {
+            histogram->record(Metrics::now() - start);
+            histogram = nullptr;
+        }
+    }
+
+    /**
+     * @brief Отменяет запись, например если операция не выполнялась.
+     */
+    void cancel() { histogram = nullptr; }
+
+private:
+    LatencyHistogram* histogram;
+    qint64 start;
+};
+
+#endif // METRICS_H
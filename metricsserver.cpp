@@ -0,0 +1,50 @@
+/**
+ * @file metricsserver.cpp
+ * @brief Реализация локального сокета со снимком метрик.
+ */
+
+#include "metricsserver.h"
+#include "metrics.h"
+
+#include <QDebug>
+#include <QJsonDocument>
+#include <QLocalSocket>
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QObject(parent)
+{
+    connect(&server, &QLocalServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::listen(const QString &name)
+{
+    // Снимок метрик не содержит ничего, кроме чисел, но читать его может только владелец программы.
+    server.setSocketOptions(QLocalServer::UserAccessOption);
+
+    bool listening = server.listen(name);
+    if (!listening && server.serverError() == QAbstractSocket::AddressInUseError)
+    {
+        QLocalServer::removeServer(name);
+        listening = server.listen(name);
+    }
+    if (!listening)
+    {
+        qDebug() << "Не удалось открыть сокет метрик:" << name << server.errorString();
+        return false;
+    }
+
+    qDebug() << "Метрики доступны через сокет" << server.fullServerName();
+    return true;
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (QLocalSocket* socket = server.nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        socket->write(QJsonDocument(Metrics::snapshot()).toJson(QJsonDocument::Compact));
+        socket->write("\n");
+        // Соединение закрывается, когда снимок будет отправлен целиком.
+        socket->disconnectFromServer();
+    }
+}
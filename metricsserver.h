@@ -0,0 +1,45 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+/**
+ * @file metricsserver.h
+ * @brief Определение класса MetricsServer — локального сокета со снимком метрик в JSON.
+ *
+ * Если переменная окружения HANDBOOK_METRICS_SOCKET задает имя сокета, программа слушает его
+ * через QLocalServer (Unix-сокет или именованный канал Windows). Каждому подключившемуся клиенту
+ * отправляется одна строка — снимок Metrics::snapshot() в компактном JSON, после чего соединение
+ * закрывается. Так метрики можно периодически снимать во время длительных прогонов, например:
+ *
+ *     socat - UNIX-CONNECT:/tmp/handbook.sock
+ */
+
+#include <QLocalServer>
+#include <QObject>
+
+/**
+ * @class MetricsServer
+ * @brief Отдает снимок метрик каждому подключению к локальному сокету.
+ */
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(QObject* parent = nullptr);
+
+    /**
+     * @brief Начинает слушать сокет. Сокет, оставшийся от аварийно завершенной программы, удаляется.
+     * @param name Имя сокета или путь к нему.
+     * @return true, если сокет открыт.
+     */
+    bool listen(const QString& name);
+
+    QString serverName() const { return server.fullServerName(); }
+
+private:
+    void onNewConnection();
+
+    QLocalServer server;
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,160 @@
+/**
+ * @file pagecache.cpp
+ * @brief Реализация LRU-кэша документов страниц.
+ */
+
+#include "pagecache.h"
+#include "metrics.h"
+
+PageCache::PageCache(qint64 maxBytes)
+    : maxBytesLimit(maxBytes)
+{
+}
+
+QSharedPointer<QTextDocument> PageCache::object(const QString &filePath)
+{
+    auto it = entries.find(filePath);
+    if (it == entries.end())
+    {
+        // Документ вытеснен, но, возможно, еще открыт во вкладке: тогда он возвращается в кэш.
+        const auto sharedIt = shared.constFind(filePath);
+        if (sharedIt == shared.constEnd())
+        {
+            Metrics::pageCacheMisses.add();
+            return {};
+        }
+
+        const QSharedPointer<QTextDocument> document = sharedIt->document.toStrongRef();
+        const qint64 cost = sharedIt->cost;
+        if (!document)
+        {
+            shared.erase(sharedIt);
+            Metrics::pageCacheMisses.add();
+            return {};
+        }
+
+        Metrics::pageCacheHits.add();
+        insert(filePath, document, cost);
+        return document;
+    }
+
+    Metrics::pageCacheHits.add();
+
+    // Перемещаем страницу в начало списка использования без перевыделения узла.
+    usage.splice(usage.begin(), usage, it->order);
+    return it->document;
+}
+
+bool PageCache::contains(const QString &filePath) const
+{
+    if (entries.contains(filePath))
+    {
+        return true;
+    }
+
+    const auto it = shared.constFind(filePath);
+    return it != shared.constEnd() && !it->document.isNull();
+}
+
+void PageCache::insert(const QString &filePath, const QSharedPointer<QTextDocument> &document, qint64 cost)
+{
+    remove(filePath);
+
+    if (!document)
+    {
+        return;
+    }
+
+    shared.insert(filePath, Shared{document, cost});
+    if (cost > maxBytesLimit)
+    {
+        return;
+    }
+
+    usage.push_front(filePath);
+    entries.insert(filePath, Entry{document, cost, usage.begin()});
+    usedBytes += cost;
+
+    trim();
+    publishMetrics();
+}
+
+void PageCache::remove(const QString &filePath)
+{
+    shared.remove(filePath);
+    evict(filePath);
+}
+
+/**
+ * @brief Убирает страницу из порядка вытеснения, оставляя ее доступной, пока документ используется.
+ */
+void PageCache::evict(const QString &filePath)
+{
+    auto it = entries.find(filePath);
+    if (it == entries.end())
+    {
+        return;
+    }
+
+    usedBytes -= it->cost;
+    usage.erase(it->order);
+    entries.erase(it);
+    publishMetrics();
+}
+
+void PageCache::clear()
+{
+    shared.clear();
+    entries.clear();
+    usage.clear();
+    usedBytes = 0;
+    publishMetrics();
+}
+
+void PageCache::setMaxBytes(qint64 maxBytes)
+{
+    maxBytesLimit = maxBytes;
+    trim();
+}
+
+qint64 PageCache::estimateCost(const QTextDocument *document, qsizetype htmlLength)
+{
+    if (!document)
+    {
+        return 0;
+    }
+
+    // Текст документа хранится в UTF-16, а на каждый блок приходятся форматы и строки раскладки.
+    // Точный размер Qt не сообщает, поэтому берем грубую оценку с запасом.
+    const qint64 textBytes = qint64(document->characterCount()) * qint64(sizeof(QChar));
+    const qint64 blockBytes = qint64(document->blockCount()) * 512;
+    return textBytes * 2 + blockBytes + qint64(htmlLength) * qint64(sizeof(QChar)) / 4;
+}
+
+/**
+ * @brief Вытесняет давно не использованные страницы, пока кэш не уложится в бюджет.
+ */
+void PageCache::trim()
+{
+    while (usedBytes > maxBytesLimit && !usage.empty())
+    {
+        const QString oldest = usage.back();
+        evict(oldest);
+    }
+
+    // Записи о документах, которые уже никто не использует, убираются, когда их становится заметно больше,
+    // чем страниц в кэше.
+    if (shared.size() > 2 * entries.size() + 64)
+    {
+        for (auto it = shared.begin(); it != shared.end();)
+        {
+            it = it->document.isNull() ? shared.erase(it) : std::next(it);
+        }
+    }
+}
+
+void PageCache::publishMetrics() const
+{
+    Metrics::residentDocumentBytes.set(usedBytes);
+    Metrics::residentDocuments.set(entries.size());
+}
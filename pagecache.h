@@ -0,0 +1,120 @@
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+/**
+ * @file pagecache.h
+ * @brief Определение класса PageCache — LRU-кэша готовых документов страниц.
+ *
+ * Кэш хранит уже разобранные и сверстанные объекты QTextDocument, ключом служит путь к HTML файлу
+ * (значение "filePath" из data.json). Суммарный размер документов ограничен бюджетом в байтах:
+ * при его превышении вытесняются страницы, которые дольше всего не открывались.
+ *
+ * Кэш также служит общим хранилищем документов для вкладок: вытесненный документ, который еще
+ * показан хотя бы в одной вкладке, по-прежнему находится по пути и не разбирается заново.
+ * Документы после верстки не изменяются, поэтому вкладкам не нужны собственные копии.
+ */
+
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QTextDocument>
+
+#include <list>
+
+/**
+ * @class PageCache
+ * @brief LRU-кэш документов страниц с ограничением по объему памяти.
+ *
+ * Документы хранятся через QSharedPointer, поэтому вытеснение страницы, которая сейчас отображается
+ * в QTextBrowser, не приводит к её удалению: документ освобождается, когда его перестают показывать.
+ */
+class PageCache
+{
+public:
+    /**
+     * @brief Конструктор кэша.
+     * @param maxBytes Бюджет памяти кэша в байтах.
+     */
+    explicit PageCache(qint64 maxBytes = 64 * 1024 * 1024);
+
+    /**
+     * @brief Возвращает документ из кэша и помечает его как недавно использованный.
+     *
+     * Вытесненный документ, который еще показан во вкладке, возвращается в кэш.
+     * Попадания и промахи учитываются в Metrics::pageCacheHits и Metrics::pageCacheMisses.
+     * @param filePath Путь к странице.
+     * @return Документ или пустой указатель, если страницы нет в кэше.
+     */
+    QSharedPointer<QTextDocument> object(const QString& filePath);
+
+    /**
+     * @brief Проверяет наличие страницы в кэше, не меняя порядок вытеснения.
+     * @param filePath Путь к странице.
+     * @return true, если документ есть в кэше или еще используется после вытеснения.
+     */
+    bool contains(const QString& filePath) const;
+
+    /**
+     * @brief Добавляет документ в кэш.
+     * @param filePath Путь к странице.
+     * @param document Готовый документ.
+     * @param cost Оценка занимаемой документом памяти в байтах.
+     */
+    void insert(const QString& filePath, const QSharedPointer<QTextDocument>& document, qint64 cost);
+
+    /**
+     * @brief Удаляет страницу из кэша.
+     * @param filePath Путь к странице.
+     */
+    void remove(const QString& filePath);
+
+    /**
+     * @brief Очищает кэш.
+     */
+    void clear();
+
+    /**
+     * @brief Устанавливает бюджет памяти и при необходимости вытесняет лишние страницы.
+     * @param maxBytes Новый бюджет в байтах.
+     */
+    void setMaxBytes(qint64 maxBytes);
+
+    qint64 maxBytes() const { return maxBytesLimit; }
+    qint64 totalBytes() const { return usedBytes; }
+    int count() const { return entries.size(); }
+
+    /**
+     * @brief Оценивает объем памяти, занимаемый документом.
+     * @param document Сверстанный документ.
+     * @param htmlLength Длина исходного HTML в символах.
+     * @return Оценка в байтах.
+     */
+    static qint64 estimateCost(const QTextDocument* document, qsizetype htmlLength);
+
+private:
+    struct Entry
+    {
+        QSharedPointer<QTextDocument> document;
+        qint64 cost;
+        std::list<QString>::iterator order; ///< Позиция в списке использования.
+    };
+
+    /// Документ, доступный по пути, пока на него есть ссылки.
+    struct Shared
+    {
+        QWeakPointer<QTextDocument> document;
+        qint64 cost;
+    };
+
+    void trim();
+    void evict(const QString& filePath);
+    void publishMetrics() const;
+
+    QHash<QString, Entry> entries;  ///< Документы по пути к странице.
+    QHash<QString, Shared> shared;  ///< Все добавленные документы, включая вытесненные, но еще используемые.
+    std::list<QString> usage;       ///< Порядок использования: в начале самые свежие страницы.
+    qint64 maxBytesLimit;
+    qint64 usedBytes = 0;
+};
+
+#endif // PAGECACHE_H
@@ -0,0 +1,379 @@
+/**
+ * @file pagefinder.cpp
+ * @brief Реализация поиска по странице с подсветкой совпадений.
+ */
+
+#include "pagefinder.h"
+#include "pageview.h"
+#include "trace.h"
+
+#include <QAbstractTextDocumentLayout>
+#include <QFutureWatcher>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextLayout>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+struct PageFinder::SearchResult
+{
+    int generation = 0;
+    QString projection;
+    QVector<int> matches;
+};
+
+PageFinder::PageFinder(PageView *view)
+    : QObject(view)
+    , view(view)
+{
+    pool.setMaxThreadCount(1);
+
+    searchTimer.setSingleShot(true);
+    searchTimer.setInterval(DefaultDelayMs);
+    connect(&searchTimer, &QTimer::timeout, this, &PageFinder::startSearch);
+
+    highlightTimer.setSingleShot(true);
+    highlightTimer.setInterval(0);
+    connect(&highlightTimer, &QTimer::timeout, this, &PageFinder::updateHighlights);
+
+    // Прокрутка и изменение размера окна меняют видимую часть страницы, а с ней и подсвеченные совпадения.
+    const auto scheduleHighlights = [this]() {
+        if (!matches.isEmpty())
+        {
+            highlightTimer.start();
+        }
+    };
+    connect(view->verticalScrollBar(), &QScrollBar::valueChanged, this, scheduleHighlights);
+    connect(view->verticalScrollBar(), &QScrollBar::rangeChanged, this, scheduleHighlights);
+    connect(view->horizontalScrollBar(), &QScrollBar::valueChanged, this, scheduleHighlights);
+}
+
+PageFinder::~PageFinder()
+{
+    generation.fetchAndAddOrdered(1);
+    pool.waitForDone();
+}
+
+void PageFinder::setQuery(const QString &text)
+{
+    if (text == queryText)
+    {
+        return;
+    }
+
+    queryText = text;
+    needle = foldCase(text);
+    generation.fetchAndAddOrdered(1);
+
+    if (needle.isEmpty())
+    {
+        searchTimer.stop();
+        searching = false;
+        scrollToResult = false;
+        matches.clear();
+        matchLength = 0;
+        current = -1;
+        updateHighlights();
+    }
+    else
+    {
+        // Новый запрос показывает первое совпадение ниже начала видимой части, как в браузере.
+        scrollToResult = true;
+        searching = true;
+        searchTimer.start();
+    }
+    emit resultsChanged();
+}
+
+void PageFinder::findNext()
+{
+    if (matches.isEmpty())
+    {
+        return;
+    }
+    setCurrent(current + 1 < matches.size() ? current + 1 : 0, true);
+    updateHighlights();
+    emit resultsChanged();
+}
+
+void PageFinder::findPrevious()
+{
+    if (matches.isEmpty())
+    {
+        return;
+    }
+    setCurrent(current > 0 ? current - 1 : int(matches.size()) - 1, true);
+    updateHighlights();
+    emit resultsChanged();
+}
+
+void PageFinder::clear()
+{
+    setQuery(QString());
+}
+
+void PageFinder::documentChanged()
+{
+    disconnect(contentsConnection);
+    generation.fetchAndAddOrdered(1);
+    matches.clear();
+    current = -1;
+    view->setExtraSelections({});
+
+    // Большие страницы дописываются постепенно: дописанная часть тоже должна попасть в результаты.
+    contentsConnection = connect(view->document(), &QTextDocument::contentsChanged, this, [this]() {
+        if (!needle.isEmpty())
+        {
+            searching = true;
+            searchTimer.start();
+        }
+    });
+
+    if (!needle.isEmpty())
+    {
+        searching = true;
+        searchTimer.start();
+    }
+    emit resultsChanged();
+}
+
+QString PageFinder::foldCase(const QString &text)
+{
+    QString folded(text.size(), Qt::Uninitialized);
+    const QChar* source = text.constData();
+    QChar* target = folded.data();
+    for (int i = 0; i < text.size(); ++i)
+    {
+        const ushort c = source[i].unicode();
+        if (c < 0x80)
+        {
+            // Латиница, цифры и разметка кода встречаются чаще всего и не требуют таблиц Юникода.
+            target[i] = QChar(c >= 'A' && c <= 'Z' ? ushort(c + ('a' - 'A')) : c);
+            continue;
+        }
+
+        ushort f = ushort(QChar::toCaseFolded(uint(c)));
+        if (f == 0x0451) // ё
+        {
+            f = 0x0435; // е
+        }
+        target[i] = QChar(f);
+    }
+    return folded;
+}
+
+QVector<int> PageFinder::findAll(const QString &text, const QString &needle,
+                                 const QAtomicInt *generation, int taskGeneration)
+{
+    QVector<int> result;
+    if (needle.isEmpty())
+    {
+        return result;
+    }
+
+    const QStringView haystack(text);
+    const int needleSize = int(needle.size());
+    int from = 0;
+    while (from + needleSize <= haystack.size())
+    {
+        // Кусок заходит в следующий на длину запроса без одного символа: совпадение на границе
+        // целиком лежит в первом из них.
+        const int chunkEnd = int(qMin<qsizetype>(haystack.size(), qsizetype(from) + ChunkSize + needleSize - 1));
+        const QStringView chunk = haystack.left(chunkEnd);
+        for (;;)
+        {
+            const int position = int(chunk.indexOf(needle, from));
+            if (position < 0)
+            {
+                break;
+            }
+            result.append(position);
+            from = position + needleSize;
+        }
+        from = qMax(from, chunkEnd - needleSize + 1);
+
+        // Поколение проверяется раз на кусок, а не на каждом совпадении: атомарное чтение дороже
+        // сравнения символов.
+        if (generation && generation->loadAcquire() != taskGeneration)
+        {
+            return {};
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Запускает поиск текущего запроса в рабочем потоке.
+ *
+ * Проекция документа снимается в главном потоке: документ нельзя читать из другого потока,
+ * пока его показывает вкладка. toPlainText() только копирует символы, а свертка регистра
+ * и поиск, занимающие основное время, выполняются в рабочем потоке.
+ */
+void PageFinder::startSearch()
+{
+    QTextDocument* document = view->document();
+    const int taskGeneration = generation.fetchAndAddOrdered(1) + 1;
+    const int revision = document->revision();
+    const bool projected = projectedDocument == document && projectedRevision == revision;
+    const QString text = projected ? projection : document->toPlainText();
+    const QString taskNeedle = needle;
+    QAtomicInt* currentGeneration = &generation;
+
+    searching = true;
+
+    auto* watcher = new QFutureWatcher<SearchResult>(this);
+    connect(watcher, &QFutureWatcher<SearchResult>::finished, this,
+            [this, watcher, revision, target = QPointer<QTextDocument>(document)]() {
+        const SearchResult result = watcher->result();
+        watcher->deleteLater();
+
+        // Пока шел поиск, запрос или документ изменились.
+        if (result.generation != generation.loadAcquire() || target != view->document())
+        {
+            return;
+        }
+
+        projectedDocument = target;
+        projectedRevision = revision;
+        projection = result.projection;
+
+        // При повторном поиске по дописанной странице текущим остается то же место текста.
+        const int previousPosition = current >= 0 && current < matches.size() ? matches[current] : -1;
+        matches = result.matches;
+        matchLength = int(needle.size());
+        searching = false;
+
+        if (scrollToResult || previousPosition < 0)
+        {
+            setCurrent(firstVisibleMatch(), scrollToResult);
+            scrollToResult = false;
+        }
+        else
+        {
+            const auto it = std::lower_bound(matches.cbegin(), matches.cend(), previousPosition);
+            setCurrent(it == matches.cend() ? 0 : int(it - matches.cbegin()), false);
+        }
+
+        updateHighlights();
+        emit resultsChanged();
+    });
+
+    watcher->setFuture(QtConcurrent::run(&pool, [=]() {
+        SearchResult result;
+        result.generation = taskGeneration;
+        if (taskGeneration != currentGeneration->loadAcquire())
+        {
+            return result;
+        }
+
+        TraceSpan span("find.search", "find");
+        result.projection = projected ? text : foldCase(text);
+        result.matches = findAll(result.projection, taskNeedle, currentGeneration, taskGeneration);
+        span.setDetail(QString::number(result.matches.size()) + " matches");
+        return result;
+    }));
+}
+
+void PageFinder::setCurrent(int index, bool scroll)
+{
+    current = matches.isEmpty() ? -1 : qBound(0, index, int(matches.size()) - 1);
+    if (!scroll || current < 0)
+    {
+        return;
+    }
+
+    // Страница прокручивается полосой прокрутки: курсор и выделение пользователя остаются на месте,
+    // а текущее совпадение и так выделено своим цветом.
+    QTextDocument* document = view->document();
+    const int position = qMin(matches[current], document->characterCount() - 1);
+    const QTextBlock block = document->findBlock(position);
+    const QRectF blockRect = document->documentLayout()->blockBoundingRect(block);
+    qreal top = blockRect.top();
+    qreal bottom = blockRect.bottom();
+    if (const QTextLayout* layout = block.layout())
+    {
+        const QTextLine line = layout->lineForTextPosition(position - block.position());
+        if (line.isValid())
+        {
+            top += line.y();
+            bottom = top + line.height();
+        }
+    }
+
+    // Видимое совпадение не сдвигается, а невидимое ставится в середину окна.
+    QScrollBar* scrollBar = view->verticalScrollBar();
+    const int height = view->viewport()->height();
+    if (top < scrollBar->value() || bottom > scrollBar->value() + height)
+    {
+        scrollBar->setValue(qRound((top + bottom - height) / 2));
+    }
+}
+
+/**
+ * @brief Возвращает первое совпадение не выше начала видимой части страницы, иначе первое на странице.
+ */
+int PageFinder::firstVisibleMatch() const
+{
+    if (matches.isEmpty())
+    {
+        return -1;
+    }
+
+    const int top = view->cursorForPosition(QPoint(0, 0)).position();
+    const auto it = std::lower_bound(matches.cbegin(), matches.cend(), top);
+    return it == matches.cend() ? 0 : int(it - matches.cbegin());
+}
+
+/**
+ * @brief Подсвечивает совпадения в видимой части страницы и на высоту окна выше и ниже нее.
+ *
+ * Запас нужен, чтобы при прокрутке новые строки появлялись уже подсвеченными, пока пересчет
+ * ждет следующей итерации цикла событий.
+ */
+void PageFinder::updateHighlights()
+{
+    QTextDocument* document = view->document();
+    if (matches.isEmpty() || !document)
+    {
+        view->setExtraSelections({});
+        return;
+    }
+
+    TraceSpan span("find.highlight", "find");
+
+    const QRect area = view->viewport()->rect();
+    const int first = view->cursorForPosition(QPoint(0, area.top() - area.height())).position();
+    const int last = view->cursorForPosition(QPoint(area.right(), area.bottom() + area.height())).position();
+
+    const auto begin = std::lower_bound(matches.cbegin(), matches.cend(), first - matchLength + 1);
+    auto end = std::upper_bound(begin, matches.cend(), last);
+    if (end - begin > MaxHighlights)
+    {
+        end = begin + MaxHighlights;
+    }
+
+    // Цвета одинаковы в обеих темах; текст совпадения темный, чтобы читаться и на темной теме.
+    QTextCharFormat matchFormat;
+    matchFormat.setBackground(QColor(255, 226, 122));
+    matchFormat.setForeground(QColor(32, 32, 32));
+    QTextCharFormat currentFormat = matchFormat;
+    currentFormat.setBackground(QColor(255, 150, 50));
+
+    const int limit = document->characterCount() - 1;
+    QList<QTextEdit::ExtraSelection> selections;
+    selections.reserve(int(end - begin));
+    for (auto it = begin; it != end && *it + matchLength <= limit; ++it)
+    {
+        QTextEdit::ExtraSelection selection;
+        selection.cursor = QTextCursor(document);
+        selection.cursor.setPosition(*it);
+        selection.cursor.setPosition(*it + matchLength, QTextCursor::KeepAnchor);
+        selection.format = int(it - matches.cbegin()) == current ? currentFormat : matchFormat;
+        selections.append(selection);
+    }
+
+    span.setDetail(QString::number(selections.size()));
+    view->setExtraSelections(selections);
+}
@@ -0,0 +1,156 @@
+#ifndef PAGEFINDER_H
+#define PAGEFINDER_H
+
+/**
+ * @file pagefinder.h
+ * @brief Определение класса PageFinder — поиска по странице с подсветкой всех совпадений.
+ *
+ * QTextDocument::find(), вызванный в цикле из главного потока, на длинной странице останавливает
+ * интерфейс на время поиска, а тысячи ExtraSelection замедляют каждую перерисовку. Поэтому
+ * поиск идет в рабочем потоке по текстовой проекции документа, а подсвечиваются только
+ * совпадения рядом с видимой частью страницы.
+ */
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+class PageView;
+
+/**
+ * @class PageFinder
+ * @brief Поиск текста на странице одной вкладки.
+ *
+ * Текстовая проекция — QTextDocument::toPlainText(): ее символы совпадают с позициями документа
+ * один к одному, поэтому найденные позиции сразу подходят для QTextCursor. Проекция и запрос
+ * приводятся к одному регистру (см. foldCase()), после чего подстрока ищется без учета регистра
+ * обычным QString::indexOf, который проверяет первый символ векторными инструкциями.
+ * Проекция в нижнем регистре запоминается до изменения документа, и следующие запросы
+ * к той же странице ее не пересчитывают.
+ *
+ * Каждый запрос увеличивает номер поколения; задача устаревшего поколения прекращается,
+ * а ее результат отбрасывается. Подсвечиваются не больше MaxHighlights совпадений в видимой
+ * части страницы и на высоту окна выше и ниже нее; при прокрутке подсветка пересчитывается.
+ */
+class PageFinder : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Задержка поиска после изменения запроса или документа в миллисекундах.
+    static constexpr int DefaultDelayMs = 50;
+
+    /// Наибольшее количество одновременно подсвеченных совпадений.
+    static constexpr int MaxHighlights = 2000;
+
+    /// Сколько символов проекции просматривается между проверками поколения.
+    static constexpr int ChunkSize = 64 * 1024;
+
+    /**
+     * @brief Конструктор. Следит за прокруткой и размером вкладки, чтобы обновлять подсветку.
+     * @param view Вкладка, по странице которой идет поиск. Становится родителем объекта.
+     */
+    explicit PageFinder(PageView* view);
+
+    /**
+     * @brief Деструктор. Отменяет поиск и дожидается рабочего потока.
+     */
+    ~PageFinder() override;
+
+    /**
+     * @brief Задает искомый текст. Пустой запрос убирает подсветку.
+     */
+    void setQuery(const QString& text);
+    QString query() const { return queryText; }
+
+    /// Количество совпадений последнего завершенного поиска.
+    int matchCount() const { return int(matches.size()); }
+
+    /// Номер текущего совпадения или -1.
+    int currentMatch() const { return current; }
+
+    /// Идет поиск: matchCount() относится к предыдущему запросу или документу.
+    bool isSearching() const { return searching; }
+
+    /**
+     * @brief Делает текущим следующее совпадение и прокручивает к нему страницу.
+     */
+    void findNext();
+
+    /**
+     * @brief Делает текущим предыдущее совпадение и прокручивает к нему страницу.
+     */
+    void findPrevious();
+
+    /**
+     * @brief Очищает запрос и подсветку.
+     */
+    void clear();
+
+    /**
+     * @brief Сообщает о замене документа вкладки. Текущий запрос выполняется по новой странице.
+     */
+    void documentChanged();
+
+    /**
+     * @brief Приводит текст к виду для поиска без учета регистра.
+     *
+     * Каждый символ UTF-16 заменяется его простой сверткой регистра, а «ё» — на «е», поэтому
+     * длина строки и позиции символов не меняются.
+     */
+    static QString foldCase(const QString& text);
+
+    /**
+     * @brief Ищет все непересекающиеся вхождения подстроки.
+     *
+     * Текст просматривается кусками по ChunkSize символов, и после каждого куска проверяется поколение,
+     * поэтому устаревший поиск прекращается быстро и при редких совпадениях.
+     * @param text Проекция страницы после foldCase().
+     * @param needle Запрос после foldCase().
+     * @param generation Текущее поколение запросов.
+     * @param taskGeneration Поколение задачи: если оно устарело, поиск прекращается.
+     * @return Позиции начала совпадений по возрастанию.
+     */
+    static QVector<int> findAll(const QString& text, const QString& needle,
+                                const QAtomicInt* generation = nullptr, int taskGeneration = 0);
+
+signals:
+    /**
+     * @brief Сигнал об изменении количества совпадений, текущего совпадения или начале поиска.
+     */
+    void resultsChanged();
+
+private:
+    struct SearchResult;
+
+    void startSearch();
+    void setCurrent(int index, bool scroll);
+    int firstVisibleMatch() const;
+    void updateHighlights();
+
+    PageView* view;
+    QString queryText;
+    QString needle;                    ///< Запрос после foldCase().
+    QVector<int> matches;              ///< Позиции совпадений в документе.
+    int matchLength = 0;
+    int current = -1;
+    bool searching = false;
+    bool scrollToResult = false;       ///< Результат нового запроса прокручивает страницу к совпадению.
+
+    QPointer<QTextDocument> projectedDocument; ///< Документ, для которого запомнена проекция.
+    int projectedRevision = -1;
+    QString projection;                ///< Текст документа после foldCase().
+
+    QAtomicInt generation;             ///< Поколение последнего запроса.
+    QThreadPool pool;                  ///< Один поток: нужен только результат последнего запроса.
+    QTimer searchTimer;                ///< Задержка поиска, объединяющая частые изменения.
+    QTimer highlightTimer;             ///< Пересчет подсветки после прокрутки на следующей итерации цикла событий.
+    QMetaObject::Connection contentsConnection;
+};
+
+#endif // PAGEFINDER_H
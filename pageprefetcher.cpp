@@ -0,0 +1,155 @@
+/**
+ * @file pageprefetcher.cpp
+ * @brief Реализация фоновой подготовки соседних страниц.
+ */
+
+#include "pageprefetcher.h"
+#include "imageloader.h"
+#include "metrics.h"
+#include "pagecache.h"
+#include "pythonhighlighter.h"
+#include "searchindex.h"
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QFutureWatcher>
+#include <QThread>
+#include <QtConcurrent>
+
+namespace {
+
+/// Результат фоновой задачи.
+struct PrefetchResult
+{
+    QString filePath;
+    QSharedPointer<QTextDocument> document;
+    qint64 cost = 0;
+    int generation = 0;
+};
+
+} // namespace
+
+PagePrefetcher::PagePrefetcher(PageCache *cache, PageLoader loader, QObject *parent)
+    : QObject(parent)
+    , cache(cache)
+    , loader(std::move(loader))
+{
+    // Подготовка соседей не должна отбирать у системы все ядра.
+    pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+}
+
+PagePrefetcher::~PagePrefetcher()
+{
+    cancelPending();
+    pool.waitForDone();
+}
+
+QSharedPointer<QTextDocument> PagePrefetcher::buildDocument(const QString &html, const QFont &font, qreal textWidth)
+{
+    QSharedPointer<QTextDocument> document(new PageDocument);
+    document->setUndoRedoEnabled(false);
+    document->setDefaultFont(font);
+
+    TraceSpan parseSpan("page.parse", "page");
+    MetricsTimer parseTimer(Metrics::pageParse);
+    document->setHtml(html);
+    parseTimer.end();
+    parseSpan.end();
+
+    // Подсветка до верстки: форматы блоков кода учитываются при первой же раскладке строк.
+    PythonHighlighter::highlightDocument(document.data(), SearchIndex::contentHash(html));
+
+    TraceSpan layoutSpan("page.layout", "page");
+    MetricsTimer layoutTimer(Metrics::pageLayout);
+    document->setTextWidth(textWidth);
+    document->size(); // Принудительно выполняем верстку.
+    layoutTimer.end();
+    layoutSpan.end();
+
+    QThread* mainThread = QCoreApplication::instance()->thread();
+    if (QThread::currentThread() != mainThread)
+    {
+        document->moveToThread(mainThread);
+    }
+
+    return document;
+}
+
+void PagePrefetcher::setLayoutParameters(const QFont &font, qreal textWidth)
+{
+    this->font = font;
+    this->textWidth = textWidth;
+}
+
+void PagePrefetcher::prefetch(const QStringList &filePaths)
+{
+    for (const QString& filePath : filePaths)
+    {
+        if (filePath.isEmpty() || pending.contains(filePath) || cache->contains(filePath))
+        {
+            continue;
+        }
+
+        pending.insert(filePath);
+
+        const int taskGeneration = generation.loadAcquire();
+        const PageLoader load = loader;
+        const QFont taskFont = font;
+        const qreal taskWidth = textWidth;
+        QAtomicInt* currentGeneration = &generation;
+
+        auto* watcher = new QFutureWatcher<PrefetchResult>(this);
+        connect(watcher, &QFutureWatcher<PrefetchResult>::finished, this, [this, watcher]() {
+            const PrefetchResult result = watcher->result();
+            watcher->deleteLater();
+
+            if (result.generation != generation.loadAcquire())
+            {
+                return;
+            }
+
+            pending.remove(result.filePath);
+            if (!result.document)
+            {
+                return;
+            }
+
+            // Документ уже в главном потоке: теперь он может получить свои картинки.
+            if (ImageLoader* images = ImageLoader::instance())
+            {
+                images->adopt(result.document.data());
+            }
+
+            cache->insert(result.filePath, result.document, result.cost);
+            emit pageReady(result.filePath);
+        });
+
+        watcher->setFuture(QtConcurrent::run(&pool, [=]() {
+            PrefetchResult result;
+            result.filePath = filePath;
+            result.generation = taskGeneration;
+
+            // Задача устарела, пока ждала в очереди: ничего не читаем и не верстаем.
+            if (taskGeneration != currentGeneration->loadAcquire())
+            {
+                return result;
+            }
+
+            const QString html = load(filePath);
+            if (html.isEmpty() || taskGeneration != currentGeneration->loadAcquire())
+            {
+                return result;
+            }
+
+            result.document = buildDocument(html, taskFont, taskWidth);
+            result.cost = PageCache::estimateCost(result.document.data(), html.size());
+            return result;
+        }));
+    }
+}
+
+void PagePrefetcher::cancelPending()
+{
+    generation.fetchAndAddOrdered(1);
+    pending.clear();
+}
@@ -0,0 +1,119 @@
+#ifndef PAGEPREFETCHER_H
+#define PAGEPREFETCHER_H
+
+/**
+ * @file pageprefetcher.h
+ * @brief Определение класса PagePrefetcher — фоновой подготовки соседних страниц.
+ *
+ * Пока пользователь читает страницу, документы соседних строк списка навигации читаются и верстаются
+ * в пуле потоков и складываются в PageCache. Кнопки "Следующая" и "Предыдущая" страница после этого
+ * показывают уже готовый документ.
+ */
+
+#include <QAtomicInt>
+#include <QFont>
+#include <QObject>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTextDocument>
+#include <QThreadPool>
+
+#include <functional>
+
+class PageCache;
+
+/**
+ * @class PagePrefetcher
+ * @brief Фоновая загрузка и верстка документов страниц.
+ *
+ * Каждая задача помечается номером поколения. cancelPending() увеличивает номер: задачи прежнего
+ * поколения, которые еще не начались, завершаются сразу, а уже готовые результаты отбрасываются.
+ */
+class PagePrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Функция чтения HTML страницы по пути. Вызывается из рабочих потоков.
+    using PageLoader = std::function<QString(const QString&)>;
+
+    /**
+     * @brief Конструктор.
+     * @param cache Кэш, в который складываются готовые документы.
+     * @param loader Функция чтения содержимого страницы.
+     * @param parent Родительский объект.
+     */
+    PagePrefetcher(PageCache* cache, PageLoader loader, QObject* parent = nullptr);
+
+    /**
+     * @brief Деструктор. Дожидается завершения запущенных задач.
+     */
+    ~PagePrefetcher() override;
+
+    /**
+     * @brief Создает сверстанный документ из HTML.
+     *
+     * Функция потокобезопасна. Если она вызвана не в главном потоке, документ переносится
+     * в главный поток, чтобы его можно было показать в QTextBrowser.
+     *
+     * @param html Содержимое страницы.
+     * @param font Шрифт текстового поля.
+     * @param textWidth Ширина области просмотра для верстки.
+     * @return Готовый документ.
+     */
+    static QSharedPointer<QTextDocument> buildDocument(const QString& html, const QFont& font, qreal textWidth);
+
+    /**
+     * @brief Задает параметры верстки фоновых документов.
+     * @param font Шрифт текстового поля.
+     * @param textWidth Ширина области просмотра.
+     */
+    void setLayoutParameters(const QFont& font, qreal textWidth);
+
+    /**
+     * @brief Устанавливает, сколько соседних строк в каждую сторону подготавливать заранее.
+     * @param radius Количество строк.
+     */
+    void setRadius(int radius) { prefetchRadius = qMax(0, radius); }
+    int radius() const { return prefetchRadius; }
+
+    /**
+     * @brief Ставит в очередь подготовку страниц, которых еще нет в кэше.
+     * @param filePaths Пути к страницам в порядке приоритета.
+     */
+    void prefetch(const QStringList& filePaths);
+
+    /**
+     * @brief Отменяет все запланированные задачи.
+     *
+     * Используется, когда пользователь уходит далеко от текущей страницы и подготовленные
+     * соседи больше не нужны.
+     */
+    void cancelPending();
+
+    /**
+     * @brief Проверяет, готовится ли страница в фоне.
+     * @param filePath Путь к странице.
+     */
+    bool isPending(const QString& filePath) const { return pending.contains(filePath); }
+
+signals:
+    /**
+     * @brief Сигнал о том, что документ страницы подготовлен и помещен в кэш.
+     * @param filePath Путь к странице.
+     */
+    void pageReady(const QString& filePath);
+
+private:
+    PageCache* cache;
+    PageLoader loader;
+    QThreadPool pool;             ///< Отдельный пул, чтобы фоновая подготовка не занимала глобальный.
+    QAtomicInt generation;        ///< Текущее поколение задач.
+    QSet<QString> pending;        ///< Страницы, задачи для которых уже запущены.
+    QFont font;
+    qreal textWidth = 0;
+    int prefetchRadius = 2;
+};
+
+#endif // PAGEPREFETCHER_H
@@ -0,0 +1,103 @@
+#ifndef PAGEREFERENCES_H
+#define PAGEREFERENCES_H
+
+/**
+ * @file pagereferences.h
+ * @brief Разбор ссылок и путей к изображениям на страницах справочника.
+ *
+ * Ссылка href указывает на якорь той же страницы ("#id"), на другую страницу относительно
+ * каталога текущей (":/texts/2.html#id", "2.html") или на внешний адрес, который не проверяется.
+ * Изображение src ищется так же, как его находит программа: в ресурсах, относительно корня
+ * содержимого или относительно каталога страницы.
+ *
+ * Функции нужны и проверке содержимого (--verify), и обработке страниц при сборке, поэтому
+ * определены в заголовке.
+ */
+
+#include "contentpack.h"
+
+#include <QDir>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+namespace PageReferences {
+
+/// Ссылка, разобранная на страницу и якорь.
+struct Link
+{
+    bool external = false;  ///< Внешняя ссылка (http, mailto и т.п.); остальные поля пусты.
+    bool empty = false;     ///< Пустая ссылка: пустой href или '#' без якоря.
+    QString entryName;      ///< Страница относительно корня ("texts/2.html"); пустая — та же страница.
+    QString anchor;         ///< Якорь без '#', раскодированный из процентной записи.
+};
+
+/**
+ * @brief Возвращает ссылку без схемы qrc и file, или пустую строку для внешних ссылок.
+ */
+inline QString localReference(const QString& reference)
+{
+    if (reference.startsWith(QLatin1String("qrc:")))
+    {
+        return reference.mid(3);
+    }
+    if (reference.startsWith(QLatin1String("file:")))
+    {
+        return QUrl(reference).toLocalFile();
+    }
+    if (reference.startsWith(QLatin1String("data:")) || reference.startsWith(QLatin1String("mailto:"))
+        || reference.startsWith(QLatin1String("javascript:")) || reference.contains(QLatin1String("://")))
+    {
+        return QString();
+    }
+    return reference;
+}
+
+/**
+ * @brief Разбирает значение href.
+ * @param href Значение атрибута.
+ * @param pageDir Каталог страницы со ссылкой относительно корня ("texts").
+ */
+inline Link resolveLink(const QString& href, const QString& pageDir)
+{
+    Link link;
+    const QString local = localReference(href);
+    if (local.isEmpty() && !href.isEmpty())
+    {
+        link.external = true;
+        return link;
+    }
+
+    const QString target = local.section('#', 0, 0).section('?', 0, 0);
+    link.anchor = QUrl::fromPercentEncoding(local.section('#', 1).toUtf8());
+    link.empty = local.isEmpty() || (local.contains('#') && link.anchor.isEmpty());
+    if (!target.isEmpty())
+    {
+        link.entryName = target.startsWith(QLatin1String(":/")) ? ContentPack::entryName(target)
+                                                                : QDir::cleanPath(pageDir + '/' + target);
+    }
+    return link;
+}
+
+/**
+ * @brief Возвращает пути, по которым ищется изображение каталога содержимого, в порядке проверки.
+ * @param root Корень содержимого: каталог с data.json и texts/.
+ * @param pageDir Каталог страницы относительно корня.
+ * @param path Путь из src без схемы (см. localReference()).
+ */
+inline QStringList imageCandidates(const QDir& root, const QString& pageDir, const QString& path)
+{
+    if (path.startsWith(QLatin1String(":/")))
+    {
+        return {root.filePath(path.mid(2))};
+    }
+    if (QDir::isAbsolutePath(path))
+    {
+        return {path};
+    }
+    return {root.filePath(path), root.filePath(pageDir + '/' + path)};
+}
+
+} // namespace PageReferences
+
+#endif // PAGEREFERENCES_H
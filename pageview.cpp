@@ -0,0 +1,85 @@
+/**
+ * @file pageview.cpp
+ * @brief Реализация вкладки чтения страницы.
+ */
+
+#include "pageview.h"
+#include "pagefinder.h"
+
+#include <QScrollBar>
+
+PageView::PageView(QWidget *parent)
+    : QTextBrowser(parent)
+    , pageFinder(new PageFinder(this))
+{
+    setOpenLinks(false);
+
+    QScrollBar* bar = verticalScrollBar();
+    connect(bar, &QScrollBar::rangeChanged, this, &PageView::applyPendingScroll);
+    // Прокрутка колесом, клавишами полосы или перетаскиванием отменяет отложенную прокрутку.
+    connect(bar, &QScrollBar::actionTriggered, this, [this]() { pendingScroll = -1; });
+    connect(bar, &QScrollBar::valueChanged, this, [this](int value) {
+        if (!replacing && pendingScroll < 0 && page)
+        {
+            emit scrollPositionChanged(value);
+        }
+    });
+}
+
+PageView::~PageView()
+{
+    clearDocument();
+}
+
+void PageView::showDocument(const QString &filePath, const QSharedPointer<QTextDocument> &document,
+                            int scrollPosition)
+{
+    path = filePath;
+    if (document == page && document.data() == this->document())
+    {
+        return;
+    }
+
+    replacing = true;
+    setDocument(document.data());
+    page = document;
+    replacing = false;
+    pageFinder->documentChanged();
+
+    pendingScroll = qMax(0, scrollPosition);
+    applyPendingScroll();
+}
+
+void PageView::showAnchor(const QString &anchor)
+{
+    pendingScroll = -1;
+    scrollToAnchor(anchor);
+}
+
+void PageView::clearDocument()
+{
+    // QTextBrowser создает себе пустой документ, и общий документ страницы больше не связан с вкладкой.
+    replacing = true;
+    setDocument(nullptr);
+    page.clear();
+    path.clear();
+    pendingScroll = -1;
+    replacing = false;
+    pageFinder->documentChanged();
+}
+
+void PageView::applyPendingScroll()
+{
+    if (pendingScroll < 0)
+    {
+        return;
+    }
+
+    QScrollBar* bar = verticalScrollBar();
+    const int target = pendingScroll;
+    if (bar->maximum() >= target)
+    {
+        pendingScroll = -1;
+    }
+    bar->setValue(qMin(target, bar->maximum()));
+}
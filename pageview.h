@@ -0,0 +1,95 @@
+#ifndef PAGEVIEW_H
+#define PAGEVIEW_H
+
+/**
+ * @file pageview.h
+ * @brief Определение класса PageView — вкладки чтения страницы.
+ *
+ * Каждая вкладка главного окна — отдельный PageView. Сам документ страницы вкладке не принадлежит:
+ * он берется из общего хранилища PageCache, и одна и та же страница, открытая в нескольких вкладках,
+ * разбирается и хранится в памяти один раз. У вкладки свои только положение прокрутки и выделение.
+ *
+ * Положение прокрутки можно задать при показе документа. Если документ еще не сверстан до этого места
+ * (окно еще не показано или страница верстается постепенно), прокрутка выполняется, как только
+ * документ станет достаточно длинным, либо отменяется, если пользователь прокрутит страницу сам.
+ */
+
+#include <QSharedPointer>
+#include <QTextBrowser>
+#include <QTextDocument>
+
+class PageFinder;
+
+/**
+ * @class PageView
+ * @brief Текстовое поле, которое показывает общий неизменяемый документ страницы.
+ *
+ * Вкладка держит ссылку на показанный документ, поэтому он не освобождается, пока открыт хотя бы
+ * в одной вкладке, даже если PageCache уже вытеснил его.
+ *
+ * Ссылки вкладка сама не открывает: QTextBrowser::setSource() заменил бы содержимое общего документа
+ * во всех вкладках. Нажатая ссылка только посылает anchorClicked().
+ */
+class PageView : public QTextBrowser
+{
+    Q_OBJECT
+
+public:
+    explicit PageView(QWidget* parent = nullptr);
+
+    /**
+     * @brief Деструктор. Отсоединяет документ до того, как будет освобождена ссылка на него.
+     */
+    ~PageView() override;
+
+    /**
+     * @brief Показывает документ страницы.
+     *
+     * Если вкладка уже показывает этот документ, ничего не делает: прокрутка и выделение сохраняются.
+     * @param filePath Путь к странице.
+     * @param document Документ из общего хранилища.
+     * @param scrollPosition Положение вертикальной прокрутки нового документа.
+     */
+    void showDocument(const QString& filePath, const QSharedPointer<QTextDocument>& document,
+                      int scrollPosition = 0);
+
+    /**
+     * @brief Отсоединяет документ и освобождает ссылку на него.
+     */
+    void clearDocument();
+
+    /**
+     * @brief Запоминает страницу новой вкладки до того, как ее документ будет готов.
+     */
+    void setFilePath(const QString& filePath) { path = filePath; }
+
+    QString filePath() const { return path; }
+    QSharedPointer<QTextDocument> pageDocument() const { return page; }
+
+    /**
+     * @brief Прокручивает страницу к якорю и отменяет отложенную прокрутку из состояния сеанса.
+     */
+    void showAnchor(const QString& anchor);
+
+    /// Поиск по странице вкладки. При смене документа запрос выполняется заново по новой странице.
+    PageFinder* finder() const { return pageFinder; }
+
+signals:
+    /**
+     * @brief Сигнал об изменении положения прокрутки показанной страницы.
+     *
+     * Не посылается, пока документ заменяется или заданная прокрутка еще не выполнена.
+     */
+    void scrollPositionChanged(int position);
+
+private:
+    void applyPendingScroll();
+
+    QString path;
+    QSharedPointer<QTextDocument> page;
+    PageFinder* pageFinder;
+    int pendingScroll = -1;      ///< Прокрутка, которая ждет верстки документа, или -1.
+    bool replacing = false;      ///< Документ заменяется: изменения прокрутки не от пользователя.
+};
+
+#endif // PAGEVIEW_H
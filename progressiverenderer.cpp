@@ -0,0 +1,244 @@
+/**
+ * @file progressiverenderer.cpp
+ * @brief Реализация постепенной верстки больших страниц.
+ */
+
+#include "progressiverenderer.h"
+#include "imageloader.h"
+#include "pagecache.h"
+#include "pythonhighlighter.h"
+#include "trace.h"
+
+#include <QRegularExpression>
+#include <QSet>
+#include <QTextCursor>
+
+ProgressiveRenderer::ProgressiveRenderer(QObject *parent)
+    : QObject(parent)
+{
+    timer.setInterval(0);
+    connect(&timer, &QTimer::timeout, this, &ProgressiveRenderer::appendNextChunks);
+}
+
+QSharedPointer<QTextDocument> ProgressiveRenderer::start(const QString &filePath, const QString &html,
+                                                         const QFont &font, qreal textWidth)
+{
+    cancel();
+
+    static const QRegularExpression bodyOpen("<body[^>]*>", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression styleBlock("<style[^>]*>(.*?)</style>",
+                                               QRegularExpression::CaseInsensitiveOption
+                                                   | QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression anchorName("\\b(?:name|id)\\s*=\\s*[\"']([^\"']+)[\"']",
+                                               QRegularExpression::CaseInsensitiveOption);
+
+    // Заголовок страницы (всё до <body> включительно) разбирается вместе с первой частью.
+    const QRegularExpressionMatch bodyMatch = bodyOpen.match(html);
+    const qsizetype bodyStart = bodyMatch.hasMatch() ? bodyMatch.capturedEnd() : 0;
+    qsizetype bodyEnd = html.lastIndexOf("</body>", -1, Qt::CaseInsensitive);
+    if (bodyEnd < bodyStart)
+    {
+        bodyEnd = html.size();
+    }
+    const QString head = html.left(bodyStart);
+
+    // Стили из <style> становятся стилем документа по умолчанию, иначе дописанные части их не увидят.
+    QString css;
+    QRegularExpressionMatchIterator styles = styleBlock.globalMatch(head);
+    while (styles.hasNext())
+    {
+        css += styles.next().captured(1);
+        css += '\n';
+    }
+
+    chunks = splitBody(html.mid(bodyStart, bodyEnd - bodyStart));
+    for (int i = 0; i < chunks.size(); ++i)
+    {
+        QRegularExpressionMatchIterator anchors = anchorName.globalMatch(chunks[i]);
+        while (anchors.hasNext())
+        {
+            const QString name = anchors.next().captured(1);
+            if (!anchorChunks.contains(name))
+            {
+                anchorChunks.insert(name, i);
+            }
+        }
+    }
+
+    currentPath = filePath;
+    htmlLength = html.size();
+
+    QSharedPointer<QTextDocument> result(new PageDocument);
+    result->setUndoRedoEnabled(false);
+    result->setDefaultFont(font);
+    result->setDefaultStyleSheet(css);
+    result->setTextWidth(textWidth);
+
+    TraceSpan parseSpan("page.parse", "page");
+    parseSpan.setDetail(filePath);
+    result->setHtml(head + chunks.value(0) + "</body></html>");
+    parseSpan.end();
+    PythonHighlighter::highlightBlocks(result->begin(), result->lastBlock());
+
+    document = result;
+    nextChunk = 1;
+
+    if (nextChunk < chunks.size())
+    {
+        timer.start();
+    }
+    else
+    {
+        finish();
+    }
+
+    return result;
+}
+
+void ProgressiveRenderer::cancel()
+{
+    timer.stop();
+    document.clear();
+    currentPath.clear();
+    chunks.clear();
+    anchorChunks.clear();
+    nextChunk = 0;
+    htmlLength = 0;
+}
+
+bool ProgressiveRenderer::ensureAnchorLoaded(const QString &anchor)
+{
+    if (!isActive())
+    {
+        return false;
+    }
+
+    const int index = anchorChunks.value(anchor, -1);
+    if (index < nextChunk)
+    {
+        return false;
+    }
+
+    while (nextChunk <= index)
+    {
+        appendChunk(nextChunk++);
+    }
+
+    if (nextChunk >= chunks.size())
+    {
+        finish();
+    }
+    return true;
+}
+
+/**
+ * @brief Дописывает части страницы, пока не исчерпан бюджет времени кадра.
+ */
+void ProgressiveRenderer::appendNextChunks()
+{
+    if (!isActive())
+    {
+        timer.stop();
+        return;
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    while (nextChunk < chunks.size() && elapsed.elapsed() < FrameBudgetMs)
+    {
+        appendChunk(nextChunk++);
+    }
+
+    if (nextChunk >= chunks.size())
+    {
+        finish();
+    }
+}
+
+/**
+ * @brief Дописывает одну часть в конец документа.
+ *
+ * Перед вставкой создается пустой абзац, чтобы первый блок части не слился с последним
+ * блоком уже сверстанного текста.
+ */
+void ProgressiveRenderer::appendChunk(int index)
+{
+    TraceSpan span("page.chunk", "page");
+
+    QTextCursor cursor(document.data());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertBlock();
+    const QTextBlock first = cursor.block();
+    cursor.insertHtml(chunks[index]);
+
+    // Подсвечиваются только новые блоки; состояние лексера берется из последнего блока прежних частей.
+    PythonHighlighter::highlightBlocks(first, document->lastBlock());
+}
+
+void ProgressiveRenderer::finish()
+{
+    timer.stop();
+
+    const QSharedPointer<QTextDocument> result = document;
+    const QString path = currentPath;
+    const qint64 cost = PageCache::estimateCost(result.data(), htmlLength);
+
+    document.clear();
+    currentPath.clear();
+    chunks.clear();
+    anchorChunks.clear();
+
+    emit finished(path, result, cost);
+}
+
+/**
+ * @brief Делит тело страницы на части по закрывающим тегам блоков верхнего уровня.
+ *
+ * Учитываются только блочные элементы, поэтому незакрытые строчные теги не мешают разбиению.
+ * Если разметка не позволяет найти границу, страница остается одной частью.
+ */
+QStringList ProgressiveRenderer::splitBody(const QString &body)
+{
+    static const QRegularExpression tag("<!--.*?-->|<(/?)([a-zA-Z][a-zA-Z0-9]*)\\b[^>]*?(/?)>",
+                                        QRegularExpression::DotMatchesEverythingOption);
+    static const QSet<QString> blockTags = {
+        "p", "div", "pre", "table", "ul", "ol", "dl", "blockquote",
+        "h1", "h2", "h3", "h4", "h5", "h6", "section", "article"
+    };
+
+    QStringList result;
+    qsizetype chunkStart = 0;
+    int depth = 0;
+
+    QRegularExpressionMatchIterator it = tag.globalMatch(body);
+    while (it.hasNext())
+    {
+        const QRegularExpressionMatch match = it.next();
+        const QString name = match.captured(2).toLower();
+        if (name.isEmpty() || !blockTags.contains(name))
+        {
+            continue;
+        }
+
+        if (!match.captured(1).isEmpty())
+        {
+            depth = qMax(0, depth - 1);
+            if (depth == 0 && match.capturedEnd() - chunkStart >= ChunkSize)
+            {
+                result.append(body.mid(chunkStart, match.capturedEnd() - chunkStart));
+                chunkStart = match.capturedEnd();
+            }
+        }
+        else if (match.captured(3).isEmpty())
+        {
+            ++depth;
+        }
+    }
+
+    if (chunkStart < body.size() || result.isEmpty())
+    {
+        result.append(body.mid(chunkStart));
+    }
+    return result;
+}
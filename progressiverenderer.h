@@ -0,0 +1,103 @@
+#ifndef PROGRESSIVERENDERER_H
+#define PROGRESSIVERENDERER_H
+
+/**
+ * @file progressiverenderer.h
+ * @brief Определение класса ProgressiveRenderer — постепенной верстки больших страниц.
+ *
+ * Большая страница делится на части по границам блоков верхнего уровня. Первая часть разбирается
+ * сразу и показывается пользователю, а остальные дописываются в документ из цикла событий
+ * порциями, каждая из которых укладывается в бюджет времени одного кадра.
+ */
+
+#include <QElapsedTimer>
+#include <QFont>
+#include <QHash>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTextDocument>
+#include <QTimer>
+
+/**
+ * @class ProgressiveRenderer
+ * @brief Постепенная верстка HTML страницы в QTextDocument.
+ *
+ * Одновременно верстается только одна страница: start() для новой страницы отменяет предыдущую.
+ * Если пользователь переходит по ссылке на якорь, который еще не загружен, все части до него
+ * дописываются немедленно.
+ */
+class ProgressiveRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Размер страницы в символах, начиная с которого она верстается постепенно.
+    static constexpr int Threshold = 64 * 1024;
+
+    /// Примерный размер одной части HTML в символах.
+    static constexpr int ChunkSize = 16 * 1024;
+
+    /// Бюджет времени одной порции в миллисекундах (половина кадра при 60 Гц).
+    static constexpr int FrameBudgetMs = 8;
+
+    explicit ProgressiveRenderer(QObject* parent = nullptr);
+
+    /**
+     * @brief Проверяет, стоит ли верстать страницу постепенно.
+     * @param html Содержимое страницы.
+     */
+    static bool shouldRender(const QString& html) { return html.size() >= Threshold; }
+
+    /**
+     * @brief Начинает постепенную верстку страницы.
+     * @param filePath Путь к странице.
+     * @param html Содержимое страницы.
+     * @param font Шрифт текстового поля.
+     * @param textWidth Ширина области просмотра.
+     * @return Документ, в котором уже сверстана первая часть страницы.
+     */
+    QSharedPointer<QTextDocument> start(const QString& filePath, const QString& html,
+                                        const QFont& font, qreal textWidth);
+
+    /**
+     * @brief Прекращает верстку текущей страницы. Недоделанный документ в кэш не попадает.
+     */
+    void cancel();
+
+    bool isActive() const { return !document.isNull(); }
+    QString filePath() const { return currentPath; }
+
+    /**
+     * @brief Немедленно дописывает все части страницы до той, где находится якорь.
+     * @param anchor Имя якоря (атрибут name или id).
+     * @return true, если якорь найден среди еще не загруженных частей.
+     */
+    bool ensureAnchorLoaded(const QString& anchor);
+
+signals:
+    /**
+     * @brief Сигнал о завершении верстки страницы.
+     * @param filePath Путь к странице.
+     * @param document Полностью сверстанный документ.
+     * @param cost Оценка занимаемой документом памяти для PageCache.
+     */
+    void finished(const QString& filePath, const QSharedPointer<QTextDocument>& document, qint64 cost);
+
+private:
+    void appendNextChunks();
+    void appendChunk(int index);
+    void finish();
+
+    static QStringList splitBody(const QString& body);
+
+    QTimer timer;
+    QSharedPointer<QTextDocument> document;
+    QString currentPath;
+    QStringList chunks;
+    QHash<QString, int> anchorChunks; ///< Номер части, в которой объявлен якорь.
+    int nextChunk = 0;
+    qsizetype htmlLength = 0;
+};
+
+#endif // PROGRESSIVERENDERER_H
@@ -0,0 +1,515 @@
+/**
+ * @file pythonhighlighter.cpp
+ * @brief Реализация подсветки синтаксиса примеров кода на Python.
+ */
+
+#include "pythonhighlighter.h"
+#include "trace.h"
+
+#include <QCache>
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QMutex>
+#include <QStringView>
+#include <QTextCharFormat>
+#include <QTextDocument>
+
+namespace {
+
+enum TokenKind
+{
+    Keyword,
+    Builtin,
+    Definition,
+    Decorator,
+    String,
+    Number,
+    Comment,
+    TokenKindCount
+};
+
+/// Подсветка одного блока, сохраненная в кэше.
+struct CachedBlock
+{
+    int blockNumber;
+    int state;
+    QVector<QTextLayout::FormatRange> formats;
+};
+
+using CachedPage = QVector<CachedBlock>;
+
+struct HighlightCache
+{
+    QMutex mutex;
+    QCache<quint64, CachedPage> pages{200000}; ///< Стоимость страницы — количество диапазонов подсветки.
+};
+
+HighlightCache& cache()
+{
+    static HighlightCache highlightCache;
+    return highlightCache;
+}
+
+/**
+ * @brief Цвета подобраны так, чтобы читаться и на светлом, и на темном фоне страницы.
+ */
+const QTextCharFormat& format(TokenKind kind)
+{
+    static const QVector<QTextCharFormat> formats = [] {
+        QVector<QTextCharFormat> result(TokenKindCount);
+        result[Keyword].setForeground(QColor(0x8e, 0x44, 0xdb));
+        result[Keyword].setFontWeight(QFont::Bold);
+        result[Builtin].setForeground(QColor(0x1a, 0x8c, 0xb8));
+        result[Definition].setForeground(QColor(0x2f, 0x74, 0xe0));
+        result[Definition].setFontWeight(QFont::Bold);
+        result[Decorator].setForeground(QColor(0xc0, 0x8a, 0x10));
+        result[String].setForeground(QColor(0x3a, 0x9a, 0x4a));
+        result[Number].setForeground(QColor(0xd8, 0x6a, 0x1c));
+        result[Comment].setForeground(QColor(0x8a, 0x8a, 0x8a));
+        result[Comment].setFontItalic(true);
+        return result;
+    }();
+    return formats[kind];
+}
+
+/**
+ * @brief Таблица ключевых слов и встроенных имен. Ключи ссылаются на строковые литералы,
+ * поэтому поиск идентификатора не создает временных строк.
+ */
+const QHash<QStringView, TokenKind>& words()
+{
+    static const QHash<QStringView, TokenKind> table = [] {
+        QHash<QStringView, TokenKind> result;
+        for (const char16_t* word : {u"False", u"None", u"True", u"and", u"as", u"assert", u"async", u"await",
+                                     u"break", u"class", u"continue", u"def", u"del", u"elif", u"else",
+                                     u"except", u"finally", u"for", u"from", u"global", u"if", u"import", u"in",
+                                     u"is", u"lambda", u"nonlocal", u"not", u"or", u"pass", u"raise", u"return",
+                                     u"try", u"while", u"with", u"yield"})
+        {
+            result.insert(QStringView(word), Keyword);
+        }
+        for (const char16_t* word : {u"abs", u"all", u"any", u"bool", u"bytes", u"callable", u"chr", u"cls",
+                                     u"dict", u"dir", u"divmod", u"enumerate", u"filter", u"float", u"format",
+                                     u"frozenset", u"getattr", u"hasattr", u"hash", u"id", u"input", u"int",
+                                     u"isinstance", u"issubclass", u"iter", u"len", u"list", u"map", u"max",
+                                     u"min", u"next", u"object", u"open", u"ord", u"pow", u"print", u"property",
+                                     u"range", u"repr", u"reversed", u"round", u"self", u"set", u"setattr",
+                                     u"sorted", u"staticmethod", u"classmethod", u"str", u"sum", u"super",
+                                     u"tuple", u"type", u"zip", u"Exception", u"ValueError", u"TypeError",
+                                     u"KeyError", u"IndexError", u"AttributeError", u"NameError",
+                                     u"ZeroDivisionError", u"StopIteration", u"RuntimeError", u"OSError",
+                                     u"FileNotFoundError", u"ImportError", u"NotImplementedError"})
+        {
+            result.insert(QStringView(word), Builtin);
+        }
+        return result;
+    }();
+    return table;
+}
+
+bool isLineEnd(QChar c)
+{
+    return c == QChar::LineSeparator || c == QLatin1Char('\n');
+}
+
+bool isIdentifierStart(QChar c)
+{
+    return c.isLetter() || c == QLatin1Char('_');
+}
+
+bool isIdentifierPart(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+bool isQuote(QChar c)
+{
+    return c == QLatin1Char('\'') || c == QLatin1Char('"');
+}
+
+bool isStringPrefix(QStringView word)
+{
+    if (word.size() > 2)
+    {
+        return false;
+    }
+    for (const QChar c : word)
+    {
+        if (!QStringView(u"rRbBuUfF").contains(c))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Ищет конец строки в тройных кавычках.
+ * @return Позиция сразу после закрывающих кавычек или -1, если строка не закрыта в этом блоке.
+ */
+int findTripleEnd(const QString& text, int from, QChar quote, bool raw)
+{
+    for (int i = from; i < text.size(); ++i)
+    {
+        const QChar c = text[i];
+        if (c == QLatin1Char('\\') && !raw)
+        {
+            ++i;
+        }
+        else if (c == quote && i + 2 < text.size() && text[i + 1] == quote && text[i + 2] == quote)
+        {
+            return i + 3;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Ищет конец строки в одинарных кавычках. Незакрытая строка заканчивается в конце строки кода.
+ */
+int findSingleEnd(const QString& text, int from, QChar quote, bool raw)
+{
+    int i = from;
+    while (i < text.size() && !isLineEnd(text[i]))
+    {
+        const QChar c = text[i];
+        if (c == QLatin1Char('\\') && !raw)
+        {
+            i += 2;
+            continue;
+        }
+        ++i;
+        if (c == quote)
+        {
+            break;
+        }
+    }
+    return qMin(i, int(text.size()));
+}
+
+int numberEnd(const QString& text, int i)
+{
+    const int size = text.size();
+    if (text[i] == QLatin1Char('0') && i + 1 < size && QStringView(u"xXoObB").contains(text[i + 1]))
+    {
+        i += 2;
+        while (i < size && (text[i].isLetterOrNumber() || text[i] == QLatin1Char('_')))
+        {
+            ++i;
+        }
+        return i;
+    }
+
+    auto digits = [&text, size](int pos) {
+        while (pos < size && (text[pos].isDigit() || text[pos] == QLatin1Char('_')))
+        {
+            ++pos;
+        }
+        return pos;
+    };
+
+    i = digits(i);
+    if (i < size && text[i] == QLatin1Char('.'))
+    {
+        i = digits(i + 1);
+    }
+    if (i < size && (text[i] == QLatin1Char('e') || text[i] == QLatin1Char('E')))
+    {
+        int exponent = i + 1;
+        if (exponent < size && (text[exponent] == QLatin1Char('+') || text[exponent] == QLatin1Char('-')))
+        {
+            ++exponent;
+        }
+        if (exponent < size && text[exponent].isDigit())
+        {
+            i = digits(exponent);
+        }
+    }
+    if (i < size && (text[i] == QLatin1Char('j') || text[i] == QLatin1Char('J')))
+    {
+        ++i;
+    }
+    return i;
+}
+
+/**
+ * @brief Подсвечивает блоки начиная с block. Возвращает последний обработанный блок.
+ * @param page Если не nullptr, сюда добавляется подсветка каждого блока кода для кэша.
+ */
+QTextBlock highlightRange(QTextBlock block, int lastNumber, CachedPage* page)
+{
+    QTextBlock previous = block.previous();
+    int state = previous.isValid() && PythonHighlighter::isCodeBlock(previous) ? qMax(0, previous.userState())
+                                                                              : PythonHighlighter::Normal;
+    QTextBlock processed;
+    QVector<QTextLayout::FormatRange> formats;
+
+    for (; block.isValid(); block = block.next())
+    {
+        if (!PythonHighlighter::isCodeBlock(block))
+        {
+            if (block.blockNumber() > lastNumber)
+            {
+                break;
+            }
+            state = PythonHighlighter::Normal;
+            processed = block;
+            continue;
+        }
+
+        formats.clear();
+        const int endState = PythonHighlighter::highlightLine(block.text(), state, &formats);
+        const bool unchanged = block.userState() == endState;
+
+        if (block.blockNumber() > lastNumber && unchanged)
+        {
+            break;
+        }
+
+        block.layout()->setFormats(formats);
+        block.setUserState(endState);
+        if (page && (!formats.isEmpty() || endState != PythonHighlighter::Normal))
+        {
+            page->append({block.blockNumber(), endState, formats});
+        }
+        state = endState;
+        processed = block;
+    }
+
+    return processed;
+}
+
+int rangeCount(const CachedPage& page)
+{
+    int count = 1;
+    for (const CachedBlock& block : page)
+    {
+        count += block.formats.size();
+    }
+    return count;
+}
+
+} // namespace
+
+void PythonHighlighter::highlightDocument(QTextDocument *document, quint64 contentHash)
+{
+    if (!document || document->isEmpty())
+    {
+        return;
+    }
+
+    TraceSpan span("page.highlight", "page");
+    HighlightCache& highlightCache = cache();
+
+    {
+        QMutexLocker locker(&highlightCache.mutex);
+        if (const CachedPage* page = highlightCache.pages.object(contentHash))
+        {
+            span.setDetail("cached");
+            for (const CachedBlock& cached : *page)
+            {
+                QTextBlock block = document->findBlockByNumber(cached.blockNumber);
+                if (block.isValid())
+                {
+                    block.layout()->setFormats(cached.formats);
+                    block.setUserState(cached.state);
+                }
+            }
+            return;
+        }
+    }
+
+    // В кэш попадают только блоки с подсветкой или незакрытой строкой: остальным блокам кода
+    // в новом документе подходят пустые форматы и начальное состояние.
+    auto page = new CachedPage;
+    highlightRange(document->begin(), document->lastBlock().blockNumber(), page);
+
+    QMutexLocker locker(&highlightCache.mutex);
+    highlightCache.pages.insert(contentHash, page, rangeCount(*page));
+}
+
+void PythonHighlighter::highlightBlocks(const QTextBlock &first, const QTextBlock &last)
+{
+    if (!first.isValid())
+    {
+        return;
+    }
+
+    TraceSpan span("page.highlight", "page");
+    const int lastNumber = last.isValid() ? last.blockNumber() : first.document()->lastBlock().blockNumber();
+    const QTextBlock processed = highlightRange(first, lastNumber, nullptr);
+
+    // Если документ уже сверстан, его нужно перерисовать с новыми форматами.
+    if (processed.isValid())
+    {
+        const int from = first.position();
+        const_cast<QTextDocument*>(first.document())
+            ->markContentsDirty(from, processed.position() + processed.length() - from);
+    }
+}
+
+int PythonHighlighter::highlightLine(const QString &text, int state, QVector<QTextLayout::FormatRange> *formats)
+{
+    auto add = [formats](int start, int length, TokenKind kind) {
+        if (formats && length > 0)
+        {
+            formats->append({start, length, format(kind)});
+        }
+    };
+
+    const int size = text.size();
+    int i = 0;
+
+    // Продолжение строки в тройных кавычках из предыдущего блока.
+    if (state & (SingleTriple | DoubleTriple))
+    {
+        const QChar quote = (state & SingleTriple) ? QLatin1Char('\'') : QLatin1Char('"');
+        const int end = findTripleEnd(text, 0, quote, state & RawFlag);
+        if (end < 0)
+        {
+            add(0, size, String);
+            return state;
+        }
+        add(0, end, String);
+        i = end;
+    }
+
+    bool lineStart = true;
+    bool expectDefinition = false;
+
+    while (i < size)
+    {
+        const QChar c = text[i];
+
+        if (isLineEnd(c))
+        {
+            lineStart = true;
+            expectDefinition = false;
+            ++i;
+            continue;
+        }
+        if (c.isSpace())
+        {
+            ++i;
+            continue;
+        }
+
+        if (c == QLatin1Char('#'))
+        {
+            int end = i;
+            while (end < size && !isLineEnd(text[end]))
+            {
+                ++end;
+            }
+            add(i, end - i, Comment);
+            i = end;
+            continue;
+        }
+
+        if (c == QLatin1Char('@') && lineStart)
+        {
+            int end = i + 1;
+            while (end < size && (isIdentifierPart(text[end]) || text[end] == QLatin1Char('.')))
+            {
+                ++end;
+            }
+            add(i, end - i, Decorator);
+            i = end;
+            lineStart = false;
+            continue;
+        }
+        lineStart = false;
+
+        if (c.isDigit() || (c == QLatin1Char('.') && i + 1 < size && text[i + 1].isDigit()))
+        {
+            const int end = numberEnd(text, i);
+            add(i, end - i, Number);
+            i = end;
+            continue;
+        }
+
+        // Идентификатор или префикс строки (r"", b'', f"""...).
+        int quoteAt = i;
+        bool raw = false;
+        if (isIdentifierStart(c))
+        {
+            int end = i + 1;
+            while (end < size && isIdentifierPart(text[end]))
+            {
+                ++end;
+            }
+            const QStringView word = QStringView(text).mid(i, end - i);
+
+            if (end < size && isQuote(text[end]) && isStringPrefix(word))
+            {
+                quoteAt = end;
+                raw = word.contains(QLatin1Char('r'), Qt::CaseInsensitive);
+            }
+            else
+            {
+                const auto found = words().constFind(word);
+                if (expectDefinition)
+                {
+                    add(i, end - i, Definition);
+                    expectDefinition = false;
+                }
+                else if (found != words().constEnd())
+                {
+                    add(i, end - i, found.value());
+                    expectDefinition = found.value() == Keyword
+                                       && (word == QLatin1String("def") || word == QLatin1String("class"));
+                }
+                i = end;
+                continue;
+            }
+        }
+
+        if (isQuote(text[quoteAt]))
+        {
+            const QChar quote = text[quoteAt];
+            const bool triple = quoteAt + 2 < size && text[quoteAt + 1] == quote && text[quoteAt + 2] == quote;
+            if (triple)
+            {
+                const int end = findTripleEnd(text, quoteAt + 3, quote, raw);
+                if (end < 0)
+                {
+                    add(i, size - i, String);
+                    return (quote == QLatin1Char('\'') ? SingleTriple : DoubleTriple) | (raw ? RawFlag : 0);
+                }
+                add(i, end - i, String);
+                i = end;
+            }
+            else
+            {
+                const int end = findSingleEnd(text, quoteAt + 1, quote, raw);
+                add(i, end - i, String);
+                i = end;
+            }
+            continue;
+        }
+
+        ++i;
+    }
+
+    return Normal;
+}
+
+bool PythonHighlighter::isCodeBlock(const QTextBlock &block)
+{
+    return block.blockFormat().nonBreakableLines();
+}
+
+void PythonHighlighter::setCacheLimit(int maxRanges)
+{
+    HighlightCache& highlightCache = cache();
+    QMutexLocker locker(&highlightCache.mutex);
+    highlightCache.pages.setMaxCost(maxRanges);
+}
+
+void PythonHighlighter::clearCache()
+{
+    HighlightCache& highlightCache = cache();
+    QMutexLocker locker(&highlightCache.mutex);
+    highlightCache.pages.clear();
+}
@@ -0,0 +1,89 @@
+#ifndef PYTHONHIGHLIGHTER_H
+#define PYTHONHIGHLIGHTER_H
+
+/**
+ * @file pythonhighlighter.h
+ * @brief Определение класса PythonHighlighter — подсветки синтаксиса примеров кода на Python.
+ *
+ * Подсвечиваются только блоки с неразрывными строками, то есть содержимое тегов <pre>. Цвета
+ * накладываются дополнительными форматами QTextLayout, как это делает QSyntaxHighlighter, поэтому
+ * сам текст документа не меняется, а подсветка работает и в рабочих потоках без цикла событий.
+ *
+ * Разбор ведется построчно: в пользовательском состоянии каждого блока (QTextBlock::userState)
+ * сохраняется состояние лексера в конце блока, например "внутри строки в тройных кавычках".
+ * Поэтому при дописывании частей страницы или изменении блока заново разбираются только
+ * затронутые блоки и те следующие, у которых изменилось начальное состояние.
+ */
+
+#include <QString>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QVector>
+
+class QTextDocument;
+
+/**
+ * @class PythonHighlighter
+ * @brief Построчный лексер Python и кэш результатов подсветки по хешу содержимого страницы.
+ *
+ * Все функции потокобезопасны при условии, что один документ одновременно обрабатывается
+ * только одним потоком.
+ */
+class PythonHighlighter
+{
+public:
+    /// Состояние лексера в конце строки.
+    enum State
+    {
+        Normal = 0,
+        SingleTriple = 1,   ///< Внутри строки в '''.
+        DoubleTriple = 2,   ///< Внутри строки в """.
+        RawFlag = 4         ///< Незакрытая строка в тройных кавычках — сырая (r'''...''').
+    };
+
+    /**
+     * @brief Подсвечивает весь документ страницы.
+     *
+     * Если страница с таким содержимым уже подсвечивалась, готовые форматы берутся из кэша
+     * и лексер не запускается.
+     * @param document Документ страницы.
+     * @param contentHash Хеш HTML страницы (SearchIndex::contentHash).
+     */
+    static void highlightDocument(QTextDocument* document, quint64 contentHash);
+
+    /**
+     * @brief Заново подсвечивает блоки с first по last включительно.
+     *
+     * После last разбор продолжается, пока у следующих блоков кода меняется начальное состояние
+     * (например, в измененном блоке открылась или закрылась строка в тройных кавычках).
+     * @param first Первый измененный блок.
+     * @param last Последний измененный блок.
+     */
+    static void highlightBlocks(const QTextBlock& first, const QTextBlock& last);
+
+    /**
+     * @brief Разбирает одну строку кода.
+     * @param text Текст блока. Символы QChar::LineSeparator считаются концами строк.
+     * @param state Состояние лексера в конце предыдущего блока.
+     * @param formats Если не nullptr, сюда добавляются диапазоны подсветки.
+     * @return Состояние лексера в конце блока.
+     */
+    static int highlightLine(const QString& text, int state, QVector<QTextLayout::FormatRange>* formats);
+
+    /**
+     * @brief Проверяет, является ли блок строкой примера кода.
+     */
+    static bool isCodeBlock(const QTextBlock& block);
+
+    /**
+     * @brief Задает предельное количество хранимых диапазонов подсветки во всех страницах кэша.
+     */
+    static void setCacheLimit(int maxRanges);
+
+    /**
+     * @brief Очищает кэш подсветки.
+     */
+    static void clearCache();
+};
+
+#endif // PYTHONHIGHLIGHTER_H
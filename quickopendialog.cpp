@@ -0,0 +1,140 @@
+/**
+ * @file quickopendialog.cpp
+ * @brief Реализация окна быстрого перехода к странице.
+ */
+
+#include "quickopendialog.h"
+#include "tocmodel.h"
+#include "trace.h"
+
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+/// Сколько страниц показывается в списке.
+constexpr int ResultLimit = 50;
+
+} // namespace
+
+QuickOpenDialog::QuickOpenDialog(const TocModel *toc, QWidget *parent)
+    : QDialog(parent)
+    , queryEdit(new QLineEdit(this))
+    , resultsList(new QListWidget(this))
+{
+    setWindowTitle("Быстрый переход");
+
+    TraceSpan span("quickopen.index", "quickopen");
+    // Ищутся все страницы, в том числе из глав, которые оглавление еще не раскрыло.
+    toc->forEachPage([this](const QString& title, const QString& filePath, quint64) {
+        titles.append(title);
+        filePaths.append(filePath);
+    });
+    matcher = TitleMatcher(titles);
+    span.end();
+
+    queryEdit->setPlaceholderText("Название страницы");
+    queryEdit->setClearButtonEnabled(true);
+    queryEdit->installEventFilter(this);
+    resultsList->setUniformItemSizes(true);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(6, 6, 6, 6);
+    layout->addWidget(queryEdit);
+    layout->addWidget(resultsList);
+
+    connect(queryEdit, &QLineEdit::textChanged, this, &QuickOpenDialog::updateResults);
+    connect(queryEdit, &QLineEdit::returnPressed, this, [this]() { choose(resultsList->currentItem()); });
+    connect(resultsList, &QListWidget::itemActivated, this, &QuickOpenDialog::choose);
+
+    resize(520, 360);
+}
+
+void QuickOpenDialog::popup()
+{
+    queryEdit->clear();
+    updateResults(QString());
+
+    if (QWidget* window = parentWidget() ? parentWidget()->window() : nullptr)
+    {
+        const QRect area = window->geometry();
+        resize(qMin(width(), area.width() - 40), height());
+        move(area.x() + (area.width() - width()) / 2, area.y() + 60);
+    }
+
+    show();
+    raise();
+    activateWindow();
+    queryEdit->setFocus();
+}
+
+bool QuickOpenDialog::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == queryEdit && event->type() == QEvent::KeyPress)
+    {
+        const int key = static_cast<QKeyEvent*>(event)->key();
+        if (key == Qt::Key_Up || key == Qt::Key_Down || key == Qt::Key_PageUp || key == Qt::Key_PageDown)
+        {
+            // Строка ввода остается в фокусе, а выделением в списке управляют те же клавиши.
+            QCoreApplication::sendEvent(resultsList, event);
+            return true;
+        }
+    }
+    return QDialog::eventFilter(watched, event);
+}
+
+/**
+ * @brief Заполняет список страницами, подходящими к запросу.
+ *
+ * Пустой запрос показывает начало оглавления.
+ */
+void QuickOpenDialog::updateResults(const QString &query)
+{
+    TraceSpan span("quickopen.match", "quickopen");
+
+    QVector<int> rows;
+    if (query.trimmed().isEmpty())
+    {
+        for (int row = 0; row < qMin(ResultLimit, int(titles.size())); ++row)
+        {
+            rows.append(row);
+        }
+    }
+    else
+    {
+        for (const TitleMatcher::Match& match : matcher.match(query, ResultLimit))
+        {
+            rows.append(match.row);
+        }
+    }
+    span.end();
+
+    resultsList->setUpdatesEnabled(false);
+    resultsList->clear();
+    for (const int row : rows)
+    {
+        QListWidgetItem* item = new QListWidgetItem(titles[row]);
+        item->setData(Qt::UserRole, filePaths[row]);
+        item->setToolTip(filePaths[row]);
+        resultsList->addItem(item);
+    }
+    if (resultsList->count() > 0)
+    {
+        resultsList->setCurrentRow(0);
+    }
+    resultsList->setUpdatesEnabled(true);
+}
+
+void QuickOpenDialog::choose(QListWidgetItem *item)
+{
+    if (!item)
+    {
+        return;
+    }
+
+    const QString filePath = item->data(Qt::UserRole).toString();
+    hide();
+    emit pageChosen(filePath);
+}
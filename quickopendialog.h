@@ -0,0 +1,68 @@
+#ifndef QUICKOPENDIALOG_H
+#define QUICKOPENDIALOG_H
+
+/**
+ * @file quickopendialog.h
+ * @brief Определение класса QuickOpenDialog — окна быстрого перехода к странице по Ctrl+P.
+ *
+ * Пользователь набирает часть названия, и список страниц обновляется на каждое нажатие клавиши:
+ * поиск идет по индексу триграмм TitleMatcher, построенному один раз по всем названиям оглавления.
+ */
+
+#include <QDialog>
+#include <QStringList>
+
+#include "titlematcher.h"
+
+class QLineEdit;
+class QListWidget;
+class QListWidgetItem;
+class TocModel;
+
+/**
+ * @class QuickOpenDialog
+ * @brief Строка ввода и список подходящих страниц.
+ *
+ * Стрелки и Page Up/Page Down в строке ввода перемещают выделение в списке, Enter открывает
+ * выделенную страницу, Esc закрывает окно.
+ */
+class QuickOpenDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Конструктор. Строит индекс по названиям страниц оглавления.
+     * @param toc Оглавление справочника.
+     * @param parent Родительский виджет.
+     */
+    explicit QuickOpenDialog(const TocModel* toc, QWidget* parent = nullptr);
+
+    /**
+     * @brief Показывает окно с пустым запросом над верхней частью родительского окна.
+     */
+    void popup();
+
+signals:
+    /**
+     * @brief Выбрана страница.
+     * @param filePath Путь к странице.
+     */
+    void pageChosen(const QString& filePath);
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+    void updateResults(const QString& query);
+    void choose(QListWidgetItem* item);
+
+    QStringList titles;
+    QStringList filePaths;
+    TitleMatcher matcher;
+
+    QLineEdit* queryEdit;
+    QListWidget* resultsList;
+};
+
+#endif // QUICKOPENDIALOG_H
@@ -0,0 +1,1206 @@
+/**
+ * @file searchindex.cpp
+ * @brief Реализация полнотекстового поиска по страницам справочника.
+ */
+
+#include "searchindex.h"
+#include "trace.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QSaveFile>
+#include <QSet>
+#include <QStringList>
+#include <QTextDocumentFragment>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+namespace {
+
+// Стандартные параметры BM25.
+constexpr double kBm25K1 = 1.2;
+constexpr double kBm25B = 0.75;
+
+// Сколько символов текста показывать до и после совпадения во фрагменте.
+constexpr int kSnippetBefore = 60;
+constexpr int kSnippetAfter = 120;
+
+// Строки хранятся в файле в UTF-16LE и читаются прямо из отображенной памяти.
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "Формат поискового индекса рассчитан на little-endian");
+
+constexpr char kMagic[8] = {'P', 'P', 'H', 'I', 'N', 'D', 'E', 'X'};
+
+/**
+ * @brief Дописывает число в формате varint (по 7 бит в байте, старший бит — признак продолжения).
+ */
+void appendVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+/**
+ * @brief Дописывает возрастающие числа разностями соседних (первое — от нуля).
+ */
+void appendDeltas(QByteArray& out, const int* values, int count)
+{
+    int previous = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        appendVarint(out, quint64(values[i] - previous));
+        previous = values[i];
+    }
+}
+
+/**
+ * @brief Дописывает вхождения слова на одной странице: разность номеров страниц, количество позиций
+ * и позиции разностями.
+ */
+void appendPageEntry(QByteArray& out, int pageDelta, const int* positions, int count)
+{
+    appendVarint(out, quint64(pageDelta));
+    appendVarint(out, quint64(count));
+    appendDeltas(out, positions, count);
+}
+
+/**
+ * @brief Читает число в формате varint, не выходя за границу данных.
+ * @return false, если данные оборваны.
+ */
+bool readVarint(const uchar*& p, const uchar* end, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        const uchar byte = *p++;
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr qint64 align8(qint64 value)
+{
+    return (value + 7) & ~qint64(7);
+}
+
+/**
+ * @brief Приводит символ слова к единому регистру.
+ */
+inline QChar foldChar(QChar ch)
+{
+    ch = ch.toCaseFolded();
+    if (ch == QChar(0x0451)) // ё -> е
+    {
+        return QChar(0x0435);
+    }
+    return ch;
+}
+
+} // namespace
+
+void SearchIndex::tokenize(const QString &text,
+                           const std::function<void(const QString &, int, int)> &callback)
+{
+    const qsizetype length = text.size();
+    const QChar* data = text.constData();
+
+    QString term;
+    int position = 0;
+    qsizetype i = 0;
+    while (i < length)
+    {
+        if (!data[i].isLetterOrNumber())
+        {
+            ++i;
+            continue;
+        }
+
+        const qsizetype start = i;
+        term.clear();
+        while (i < length && data[i].isLetterOrNumber())
+        {
+            term.append(foldChar(data[i]));
+            ++i;
+        }
+
+        callback(term, position++, int(start));
+    }
+}
+
+QString SearchIndex::visibleText(const QString &html)
+{
+    return QTextDocumentFragment::fromHtml(html).toPlainText();
+}
+
+struct SearchIndex::Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 pageCount;
+    quint32 termCount;
+    quint32 reserved;
+    quint64 totalLength;    ///< Суммарное количество слов на всех страницах.
+    quint64 pagesOffset;
+    quint64 termsOffset;
+    quint64 stringsOffset;
+    quint64 postingsOffset;
+};
+
+struct SearchIndex::PageRecord
+{
+    quint64 contentHash;
+    qint64 fileSize;            ///< Размер файла страницы при разборе; -1 — неизвестен.
+    qint64 fileModified;        ///< Время изменения файла страницы в миллисекундах.
+    quint64 titleOffset;        ///< Смещения строк задаются в символах UTF-16 от начала раздела строк.
+    quint64 pathOffset;
+    quint64 textOffset;
+    quint64 tokenOffsetsOffset; ///< Смещение в байтах от начала раздела списков вхождений.
+    quint32 titleLength;
+    quint32 pathLength;
+    quint32 textLength;
+    quint32 tokenCount;
+};
+
+struct SearchIndex::TermRecord
+{
+    quint64 stringOffset;
+    quint64 postingsOffset;
+    quint32 stringLength;
+    quint32 pageFrequency;
+};
+
+quint64 SearchIndex::contentHash(const QString &html)
+{
+    const QByteArray digest = QCryptographicHash::hash(html.toUtf8(), QCryptographicHash::Sha1);
+    return qFromBigEndian<quint64>(digest.constData());
+}
+
+SearchIndex::ParsedPage SearchIndex::parsePage(const QString &html)
+{
+    ParsedPage parsed;
+    parsed.text = visibleText(html);
+
+    tokenize(parsed.text, [&parsed](const QString& term, int position, int offset) {
+        parsed.tokenOffsets.append(offset);
+        parsed.termPositions[term].append(position);
+    });
+
+    return parsed;
+}
+
+SearchIndex SearchIndex::build(const QVector<Page> &pages, const PageLoader &loader)
+{
+    QVector<int> indices(pages.size());
+    std::iota(indices.begin(), indices.end(), 0);
+
+    // Чтение, извлечение текста и разбиение на слова выполняются параллельно для всех страниц.
+    QVector<quint64> hashes(pages.size());
+    quint64* hashData = hashes.data();
+    const QVector<ParsedPage> parsedPages = QtConcurrent::blockingMapped<QVector<ParsedPage>>(
+        indices, std::function<ParsedPage(const int&)>([&pages, &loader, hashData](const int& index) {
+            const QString html = loader(pages[index].filePath);
+            hashData[index] = pages[index].contentHash ? pages[index].contentHash : contentHash(html);
+            return parsePage(html);
+        }));
+
+    return fromData(serialize(pages, hashes, QVector<FileStamp>(pages.size()), parsedPages));
+}
+
+SearchIndex SearchIndex::open(const QString &indexPath)
+{
+    SearchIndex index;
+
+    QSharedPointer<QFile> file(new QFile(indexPath));
+    if (!file->open(QIODevice::ReadOnly))
+    {
+        return index;
+    }
+
+    const uchar* mapped = file->map(0, file->size());
+    if (!mapped || !index.attach(mapped, file->size()))
+    {
+        qDebug() << "Файл поискового индекса поврежден или имеет другую версию:" << indexPath;
+        return SearchIndex();
+    }
+
+    index.mappedFile = file;
+    return index;
+}
+
+SearchIndex SearchIndex::openOrUpdate(const QString &indexPath, const QVector<Page> &pages, const PageLoader &loader,
+                                      const StampReader &stampReader)
+{
+    TraceSpan span("searchIndex.openOrUpdate", "search");
+    const int pageCount = pages.size();
+    QVector<int> indices(pageCount);
+    std::iota(indices.begin(), indices.end(), 0);
+
+    SearchIndex old = open(indexPath);
+    QHash<QString, int> oldPages;
+    oldPages.reserve(old.pageCount());
+    for (int j = 0; j < old.pageCount(); ++j)
+    {
+        oldPages.insert(old.pageFilePath(j), j);
+    }
+
+    // Хеши, не заданные в data.json, вычисляются по содержимому страниц параллельно. Страница,
+    // размер и время изменения файла которой совпадают с сохраненными, не читается.
+    QVector<FileStamp> stamps(pageCount);
+    FileStamp* stampData = stamps.data();
+    const QVector<quint64> hashes = QtConcurrent::blockingMapped<QVector<quint64>>(
+        indices, std::function<quint64(const int&)>([&](const int& index) {
+            const Page& page = pages[index];
+            if (stampReader)
+            {
+                stampData[index] = stampReader(page.filePath);
+            }
+            if (page.contentHash)
+            {
+                return page.contentHash;
+            }
+
+            const int j = oldPages.value(page.filePath, -1);
+            if (j >= 0 && stampData[index].isValid() && old.pageStamp(j) == stampData[index])
+            {
+                return old.pageRecord(j)->contentHash;
+            }
+            return contentHash(loader(page.filePath));
+        }));
+
+    if (old.pageCount() == pageCount && pageCount > 0)
+    {
+        bool unchanged = true;
+        for (int i = 0; i < pageCount && unchanged; ++i)
+        {
+            unchanged = old.pageRecord(i)->contentHash == hashes[i]
+                        && old.pageStamp(i) == stamps[i]
+                        && old.pageFilePath(i) == pages[i].filePath
+                        && old.pageTitle(i) == pages[i].title;
+        }
+
+        if (unchanged)
+        {
+            return old;
+        }
+    }
+
+    // Страницы с совпадающим хешем переносятся из старого индекса, остальные разбираются заново.
+    QVector<int> reusedOld;
+    QVector<int> reusedNew;
+    QVector<int> changed;
+    for (int i = 0; i < pageCount; ++i)
+    {
+        const int j = oldPages.value(pages[i].filePath, -1);
+        if (j >= 0 && old.pageRecord(j)->contentHash == hashes[i])
+        {
+            reusedOld.append(j);
+            reusedNew.append(i);
+        }
+        else
+        {
+            changed.append(i);
+        }
+    }
+
+    QVector<ParsedPage> parsedPages(pageCount);
+    const QVector<ParsedPage> extracted = old.extractPages(reusedOld);
+    for (int k = 0; k < reusedNew.size(); ++k)
+    {
+        parsedPages[reusedNew[k]] = extracted[k];
+    }
+
+    // Старый файл освобождается до перезаписи: на Windows отображенный файл нельзя заменить.
+    old = SearchIndex();
+
+    const QVector<ParsedPage> fresh = QtConcurrent::blockingMapped<QVector<ParsedPage>>(
+        changed, std::function<ParsedPage(const int&)>([&pages, &loader](const int& index) {
+            return parsePage(loader(pages[index].filePath));
+        }));
+    for (int k = 0; k < changed.size(); ++k)
+    {
+        parsedPages[changed[k]] = fresh[k];
+    }
+
+    qDebug() << "Поисковый индекс обновлен, заново разобрано страниц:" << changed.size() << "из" << pageCount;
+
+    return save(indexPath, serialize(pages, hashes, stamps, parsedPages));
+}
+
+SearchIndex SearchIndex::updatePages(SearchIndex base, const QString &indexPath, const QVector<Page> &pages,
+                                     const PageLoader &loader, const StampReader &stampReader)
+{
+    TraceSpan span("searchIndex.updatePages", "search");
+    span.setDetail(QString::number(pages.size()));
+    if (base.isEmpty())
+    {
+        return SearchIndex();
+    }
+
+    QHash<QString, int> basePages;
+    basePages.reserve(base.pageCount());
+    for (int j = 0; j < base.pageCount(); ++j)
+    {
+        basePages.insert(base.pageFilePath(j), j);
+    }
+
+    QVector<int> pageIndices;
+    pageIndices.reserve(pages.size());
+    for (const Page& page : pages)
+    {
+        const int j = basePages.value(page.filePath, -1);
+        if (j < 0)
+        {
+            return SearchIndex();
+        }
+        pageIndices.append(j);
+    }
+
+    QVector<int> indices(pages.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    QVector<quint64> hashes(pages.size());
+    QVector<FileStamp> stamps(pages.size());
+    quint64* hashData = hashes.data();
+    FileStamp* stampData = stamps.data();
+    const QVector<ParsedPage> parsedPages = QtConcurrent::blockingMapped<QVector<ParsedPage>>(
+        indices, std::function<ParsedPage(const int&)>([&](const int& index) {
+            const Page& page = pages[index];
+            if (stampReader)
+            {
+                stampData[index] = stampReader(page.filePath);
+            }
+            const QString html = loader(page.filePath);
+            hashData[index] = page.contentHash ? page.contentHash : contentHash(html);
+            return parsePage(html);
+        }));
+
+    const QByteArray bytes = base.patch(pageIndices, hashes, stamps, parsedPages);
+
+    // Прежний индекс освобождается до перезаписи: на Windows отображенный файл нельзя заменить.
+    base = SearchIndex();
+    if (bytes.isEmpty())
+    {
+        return SearchIndex();
+    }
+
+    qDebug() << "Поисковый индекс обновлен, заново разобрано страниц:" << pages.size();
+    return save(indexPath, bytes);
+}
+
+/**
+ * @brief Атомарно записывает файл индекса и отображает его в память.
+ *
+ * Если файл записать не удалось, индекс остается в памяти.
+ */
+SearchIndex SearchIndex::save(const QString &indexPath, const QByteArray &bytes)
+{
+    QSaveFile file(indexPath);
+    if (file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size() && file.commit())
+    {
+        SearchIndex mapped = open(indexPath);
+        if (!mapped.isEmpty())
+        {
+            return mapped;
+        }
+    }
+    else
+    {
+        qDebug() << "Не удалось сохранить поисковый индекс:" << file.errorString();
+    }
+
+    return fromData(bytes);
+}
+
+QByteArray SearchIndex::serialize(const QVector<Page> &pages, const QVector<quint64> &hashes,
+                                  const QVector<FileStamp> &stamps, const QVector<ParsedPage> &parsedPages)
+{
+    // Сбор списков вхождений по словам. Страницы обходятся по порядку, поэтому номера страниц
+    // в каждом списке уже отсортированы.
+    QHash<QString, QVector<QPair<int, const QVector<int>*>>> termPages;
+    for (int page = 0; page < parsedPages.size(); ++page)
+    {
+        const auto& termPositions = parsedPages[page].termPositions;
+        for (auto it = termPositions.cbegin(); it != termPositions.cend(); ++it)
+        {
+            termPages[it.key()].append(qMakePair(page, &it.value()));
+        }
+    }
+
+    QStringList terms = termPages.keys();
+    std::sort(terms.begin(), terms.end());
+
+    QString strings;
+    QByteArray postingsBlob;
+    quint64 totalLength = 0;
+
+    QVector<PageRecord> pageRecords(pages.size());
+    for (int page = 0; page < pages.size(); ++page)
+    {
+        const ParsedPage& parsed = parsedPages[page];
+        PageRecord& record = pageRecords[page];
+
+        record.contentHash = hashes[page];
+        record.fileSize = stamps[page].size;
+        record.fileModified = stamps[page].modified;
+        record.titleOffset = strings.size();
+        record.titleLength = pages[page].title.size();
+        strings.append(pages[page].title);
+        record.pathOffset = strings.size();
+        record.pathLength = pages[page].filePath.size();
+        strings.append(pages[page].filePath);
+        record.textOffset = strings.size();
+        record.textLength = parsed.text.size();
+        strings.append(parsed.text);
+
+        record.tokenOffsetsOffset = postingsBlob.size();
+        record.tokenCount = parsed.tokenOffsets.size();
+        appendDeltas(postingsBlob, parsed.tokenOffsets.constData(), parsed.tokenOffsets.size());
+
+        totalLength += record.tokenCount;
+    }
+
+    QVector<TermRecord> termRecords(terms.size());
+    for (int term = 0; term < terms.size(); ++term)
+    {
+        const auto& entries = termPages[terms[term]];
+        TermRecord& record = termRecords[term];
+
+        record.stringOffset = strings.size();
+        record.stringLength = terms[term].size();
+        strings.append(terms[term]);
+
+        record.postingsOffset = postingsBlob.size();
+        record.pageFrequency = entries.size();
+
+        int previousPage = 0;
+        for (const auto& entry : entries)
+        {
+            const QVector<int>& positions = *entry.second;
+            appendPageEntry(postingsBlob, entry.first - previousPage, positions.constData(), positions.size());
+            previousPage = entry.first;
+        }
+    }
+
+    return assemble(pageRecords, termRecords, strings, totalLength, postingsBlob);
+}
+
+/**
+ * @brief Собирает файл индекса из готовых разделов: заголовок, страницы, словарь, строки и списки вхождений.
+ */
+QByteArray SearchIndex::assemble(const QVector<PageRecord> &pageRecords, const QVector<TermRecord> &termRecords,
+                                 const QString &strings, quint64 totalLength, const QByteArray &postingsBlob)
+{
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = FormatVersion;
+    header.pageCount = pageRecords.size();
+    header.termCount = termRecords.size();
+    header.totalLength = totalLength;
+    header.pagesOffset = sizeof(Header);
+    header.termsOffset = header.pagesOffset + quint64(pageRecords.size()) * sizeof(PageRecord);
+    header.stringsOffset = header.termsOffset + quint64(termRecords.size()) * sizeof(TermRecord);
+    header.postingsOffset = align8(header.stringsOffset + qint64(strings.size()) * qint64(sizeof(QChar)));
+
+    QByteArray out;
+    out.reserve(header.postingsOffset + postingsBlob.size());
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(reinterpret_cast<const char*>(pageRecords.constData()), pageRecords.size() * sizeof(PageRecord));
+    out.append(reinterpret_cast<const char*>(termRecords.constData()), termRecords.size() * sizeof(TermRecord));
+    out.append(reinterpret_cast<const char*>(strings.utf16()), strings.size() * sizeof(QChar));
+    out.append(QByteArray(qsizetype(header.postingsOffset) - out.size(), '\0'));
+    out.append(postingsBlob);
+
+    return out;
+}
+
+SearchIndex SearchIndex::fromData(const QByteArray &data)
+{
+    SearchIndex index;
+    index.buffer = data;
+    if (!index.attach(reinterpret_cast<const uchar*>(index.buffer.constData()), index.buffer.size()))
+    {
+        return SearchIndex();
+    }
+    return index;
+}
+
+/**
+ * @brief Проверяет заголовок и границы разделов и настраивает указатели на данные индекса.
+ */
+bool SearchIndex::attach(const uchar *data, qint64 size)
+{
+    static_assert(sizeof(Header) == 64, "Неожиданный размер заголовка индекса");
+    static_assert(sizeof(PageRecord) == 72, "Неожиданный размер записи страницы");
+    static_assert(sizeof(TermRecord) == 24, "Неожиданный размер записи слова");
+
+    if (size < qint64(sizeof(Header)))
+    {
+        return false;
+    }
+
+    const Header* candidate = reinterpret_cast<const Header*>(data);
+    if (memcmp(candidate->magic, kMagic, sizeof(kMagic)) != 0 || candidate->version != FormatVersion)
+    {
+        return false;
+    }
+
+    const quint64 total = quint64(size);
+    if (candidate->pagesOffset + quint64(candidate->pageCount) * sizeof(PageRecord) > candidate->termsOffset
+        || candidate->termsOffset + quint64(candidate->termCount) * sizeof(TermRecord) > candidate->stringsOffset
+        || candidate->stringsOffset > candidate->postingsOffset
+        || candidate->postingsOffset > total
+        || candidate->stringsOffset % 8 != 0)
+    {
+        return false;
+    }
+
+    this->data = data;
+    this->size = size;
+    header = candidate;
+    strings = reinterpret_cast<const QChar*>(data + header->stringsOffset);
+    postingsData = data + header->postingsOffset;
+    averagePageLength = header->pageCount ? double(header->totalLength) / header->pageCount : 0;
+    return true;
+}
+
+int SearchIndex::pageCount() const
+{
+    return header ? int(header->pageCount) : 0;
+}
+
+const SearchIndex::PageRecord *SearchIndex::pageRecord(int page) const
+{
+    return reinterpret_cast<const PageRecord*>(data + header->pagesOffset) + page;
+}
+
+const SearchIndex::TermRecord *SearchIndex::termRecord(int term) const
+{
+    return reinterpret_cast<const TermRecord*>(data + header->termsOffset) + term;
+}
+
+QStringView SearchIndex::stringAt(quint64 offset, quint32 length) const
+{
+    const quint64 available = (header->postingsOffset - header->stringsOffset) / sizeof(QChar);
+    if (offset > available || length > available - offset)
+    {
+        return QStringView();
+    }
+    return QStringView(strings + offset, qsizetype(length));
+}
+
+QStringView SearchIndex::termAt(int term) const
+{
+    const TermRecord* record = termRecord(term);
+    return stringAt(record->stringOffset, record->stringLength);
+}
+
+QHash<QString, quint64> SearchIndex::contentHashes() const
+{
+    QHash<QString, quint64> hashes;
+    hashes.reserve(pageCount());
+    for (int page = 0; page < pageCount(); ++page)
+    {
+        hashes.insert(pageFilePath(page), pageRecord(page)->contentHash);
+    }
+    return hashes;
+}
+
+QString SearchIndex::pageTitle(int page) const
+{
+    const PageRecord* record = pageRecord(page);
+    return stringAt(record->titleOffset, record->titleLength).toString();
+}
+
+QString SearchIndex::pageFilePath(int page) const
+{
+    const PageRecord* record = pageRecord(page);
+    return stringAt(record->pathOffset, record->pathLength).toString();
+}
+
+SearchIndex::FileStamp SearchIndex::pageStamp(int page) const
+{
+    const PageRecord* record = pageRecord(page);
+    return {record->fileSize, record->fileModified};
+}
+
+QVector<int> SearchIndex::pageTokenOffsets(int page) const
+{
+    const PageRecord* record = pageRecord(page);
+    const uchar* end = data + size;
+    const uchar* p = postingsData + qMin<quint64>(record->tokenOffsetsOffset, quint64(end - postingsData));
+
+    QVector<int> offsets;
+    offsets.reserve(record->tokenCount);
+    quint64 delta = 0;
+    int offset = 0;
+    for (quint32 i = 0; i < record->tokenCount && readVarint(p, end, delta); ++i)
+    {
+        offset += int(delta);
+        offsets.append(offset);
+    }
+    return offsets;
+}
+
+/**
+ * @brief Ищет слово в отсортированном словаре двоичным поиском.
+ * @return Номер слова или -1.
+ */
+int SearchIndex::findTerm(const QString &term) const
+{
+    int low = 0;
+    int high = int(header->termCount);
+    const QStringView needle(term);
+    while (low < high)
+    {
+        const int middle = low + (high - low) / 2;
+        if (termAt(middle) < needle)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return (low < int(header->termCount) && termAt(low) == needle) ? low : -1;
+}
+
+/**
+ * @brief Раскодирует список вхождений слова из отображенных данных.
+ */
+SearchIndex::Postings SearchIndex::decodePostings(int term) const
+{
+    const TermRecord* record = termRecord(term);
+    const uchar* end = data + size;
+    const uchar* p = postingsData + qMin<quint64>(record->postingsOffset, quint64(end - postingsData));
+
+    Postings list;
+    list.pages.reserve(record->pageFrequency);
+    list.positionStarts.reserve(record->pageFrequency + 1);
+    list.positionStarts.append(0);
+
+    quint64 value = 0;
+    int page = 0;
+    for (quint32 i = 0; i < record->pageFrequency; ++i)
+    {
+        if (!readVarint(p, end, value))
+        {
+            break;
+        }
+        page += int(value);
+
+        quint64 count = 0;
+        if (!readVarint(p, end, count))
+        {
+            break;
+        }
+
+        int position = 0;
+        for (quint64 k = 0; k < count && readVarint(p, end, value); ++k)
+        {
+            position += int(value);
+            list.positions.append(position);
+        }
+
+        list.pages.append(page);
+        list.positionStarts.append(list.positions.size());
+    }
+
+    return list;
+}
+
+/**
+ * @brief Восстанавливает разобранные страницы из индекса, чтобы не разбирать их HTML заново.
+ * @param pageIndices Номера страниц в этом индексе.
+ * @return Разобранные страницы в том же порядке.
+ */
+QVector<SearchIndex::ParsedPage> SearchIndex::extractPages(const QVector<int> &pageIndices) const
+{
+    QVector<ParsedPage> result(pageIndices.size());
+    if (pageIndices.isEmpty())
+    {
+        return result;
+    }
+
+    QHash<int, int> slotByPage;
+    for (int k = 0; k < pageIndices.size(); ++k)
+    {
+        const int page = pageIndices[k];
+        const PageRecord* record = pageRecord(page);
+        slotByPage.insert(page, k);
+        result[k].text = stringAt(record->textOffset, record->textLength).toString();
+        result[k].tokenOffsets = pageTokenOffsets(page);
+    }
+
+    for (int term = 0; term < int(header->termCount); ++term)
+    {
+        const Postings list = decodePostings(term);
+        QString termText;
+        for (int i = 0; i < list.pages.size(); ++i)
+        {
+            const int slot = slotByPage.value(list.pages[i], -1);
+            if (slot < 0)
+            {
+                continue;
+            }
+            if (termText.isNull())
+            {
+                termText = termAt(term).toString();
+            }
+            result[slot].termPositions.insert(
+                termText, list.positions.mid(list.positionStarts[i], list.positionStarts[i + 1] - list.positionStarts[i]));
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Собирает файл индекса, в котором данные страниц pageIndices заменены новыми.
+ *
+ * Данные страниц и списки вхождений слов лежат в файле подряд в порядке номеров (так их пишут
+ * serialize() и эта функция), поэтому конец записи — начало следующей, и неизмененные записи
+ * копируются байт в байт. Заново кодируются только слова прежнего и нового текста измененных страниц.
+ *
+ * @return Данные файла или пустой массив, если границы записей в индексе не сходятся.
+ */
+QByteArray SearchIndex::patch(const QVector<int> &pageIndices, const QVector<quint64> &hashes,
+                              const QVector<FileStamp> &stamps, const QVector<ParsedPage> &parsedPages) const
+{
+    const int pages = pageCount();
+    const int terms = int(header->termCount);
+    const quint64 blobSize = quint64(size) - header->postingsOffset;
+
+    // Слова, списки которых меняются: прежние слова измененных страниц и слова их нового текста.
+    QHash<int, int> slotByPage;
+    QSet<QString> affected;
+    for (int k = 0; k < pageIndices.size(); ++k)
+    {
+        const PageRecord* record = pageRecord(pageIndices[k]);
+        slotByPage.insert(pageIndices[k], k);
+        tokenize(stringAt(record->textOffset, record->textLength).toString(),
+                 [&affected](const QString& term, int, int) { affected.insert(term); });
+
+        const auto& termPositions = parsedPages[k].termPositions;
+        for (auto it = termPositions.cbegin(); it != termPositions.cend(); ++it)
+        {
+            affected.insert(it.key());
+        }
+    }
+
+    QVector<bool> rewritten(terms, false);
+    QStringList added;
+    for (const QString& term : std::as_const(affected))
+    {
+        const int found = findTerm(term);
+        if (found >= 0)
+        {
+            rewritten[found] = true;
+        }
+        else
+        {
+            added.append(term);
+        }
+    }
+    std::sort(added.begin(), added.end());
+
+    const auto copyBytes = [this, blobSize](QByteArray& out, quint64 begin, quint64 end) {
+        if (begin > end || end > blobSize)
+        {
+            return false;
+        }
+        out.append(reinterpret_cast<const char*>(postingsData + begin), int(end - begin));
+        return true;
+    };
+
+    QString strings;
+    QByteArray postingsBlob;
+    quint64 totalLength = header->totalLength;
+
+    QVector<PageRecord> pageRecords(pages);
+    for (int page = 0; page < pages; ++page)
+    {
+        const PageRecord* old = pageRecord(page);
+        PageRecord& record = pageRecords[page];
+        record = *old;
+
+        const QStringView title = stringAt(old->titleOffset, old->titleLength);
+        record.titleOffset = strings.size();
+        strings.append(title.data(), int(title.size()));
+        const QStringView path = stringAt(old->pathOffset, old->pathLength);
+        record.pathOffset = strings.size();
+        strings.append(path.data(), int(path.size()));
+        record.textOffset = strings.size();
+        record.tokenOffsetsOffset = postingsBlob.size();
+
+        const int k = slotByPage.value(page, -1);
+        if (k < 0)
+        {
+            const QStringView text = stringAt(old->textOffset, old->textLength);
+            strings.append(text.data(), int(text.size()));
+
+            const quint64 end = page + 1 < pages ? pageRecord(page + 1)->tokenOffsetsOffset
+                                                 : (terms > 0 ? termRecord(0)->postingsOffset : blobSize);
+            if (!copyBytes(postingsBlob, old->tokenOffsetsOffset, end))
+            {
+                return QByteArray();
+            }
+            continue;
+        }
+
+        const ParsedPage& parsed = parsedPages[k];
+        record.contentHash = hashes[k];
+        record.fileSize = stamps[k].size;
+        record.fileModified = stamps[k].modified;
+        record.textLength = parsed.text.size();
+        strings.append(parsed.text);
+        record.tokenCount = parsed.tokenOffsets.size();
+        appendDeltas(postingsBlob, parsed.tokenOffsets.constData(), parsed.tokenOffsets.size());
+        totalLength = totalLength - old->tokenCount + record.tokenCount;
+    }
+
+    // Вхождения слова на одной странице: позиции лежат в раскодированном списке или в разобранной странице.
+    struct Entry
+    {
+        int page;
+        const int* positions;
+        int count;
+    };
+
+    QVector<TermRecord> termRecords;
+    termRecords.reserve(terms + added.size());
+
+    // Записывает слово с прежними вхождениями без измененных страниц и вхождениями из их нового текста.
+    const auto appendTerm = [&](const QString& text, const Postings* list) {
+        QVector<Entry> entries;
+        if (list)
+        {
+            entries.reserve(list->pages.size());
+            for (int i = 0; i < list->pages.size(); ++i)
+            {
+                if (!slotByPage.contains(list->pages[i]))
+                {
+                    entries.append({list->pages[i], list->positions.constData() + list->positionStarts[i],
+                                    list->positionStarts[i + 1] - list->positionStarts[i]});
+                }
+            }
+        }
+        for (int k = 0; k < parsedPages.size(); ++k)
+        {
+            const auto positions = parsedPages[k].termPositions.constFind(text);
+            if (positions != parsedPages[k].termPositions.cend())
+            {
+                entries.append({pageIndices[k], positions->constData(), int(positions->size())});
+            }
+        }
+
+        // Слово осталось только в прежнем тексте измененных страниц и из словаря уходит.
+        if (entries.isEmpty())
+        {
+            return;
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.page < b.page; });
+
+        TermRecord record;
+        record.stringOffset = strings.size();
+        record.stringLength = text.size();
+        record.postingsOffset = postingsBlob.size();
+        record.pageFrequency = entries.size();
+        strings.append(text);
+
+        int previousPage = 0;
+        for (const Entry& entry : std::as_const(entries))
+        {
+            appendPageEntry(postingsBlob, entry.page - previousPage, entry.positions, entry.count);
+            previousPage = entry.page;
+        }
+        termRecords.append(record);
+    };
+
+    int nextAdded = 0;
+    for (int term = 0; term <= terms; ++term)
+    {
+        // Новые слова встают в словарь перед первым прежним словом, которое больше них.
+        while (nextAdded < added.size() && (term == terms || QStringView(added[nextAdded]) < termAt(term)))
+        {
+            appendTerm(added[nextAdded++], nullptr);
+        }
+        if (term == terms)
+        {
+            break;
+        }
+
+        if (rewritten[term])
+        {
+            const Postings list = decodePostings(term);
+            appendTerm(termAt(term).toString(), &list);
+            continue;
+        }
+
+        const TermRecord* old = termRecord(term);
+        const QStringView text = termAt(term);
+        TermRecord record = *old;
+        record.stringOffset = strings.size();
+        record.postingsOffset = postingsBlob.size();
+        strings.append(text.data(), int(text.size()));
+
+        const quint64 end = term + 1 < terms ? termRecord(term + 1)->postingsOffset : blobSize;
+        if (!copyBytes(postingsBlob, old->postingsOffset, end))
+        {
+            return QByteArray();
+        }
+        termRecords.append(record);
+    }
+
+    return assemble(pageRecords, termRecords, strings, totalLength, postingsBlob);
+}
+
+QVector<SearchIndex::Hit> SearchIndex::search(const QString &query, int limit) const
+{
+    QVector<Hit> hits;
+    if (isEmpty() || limit <= 0)
+    {
+        return hits;
+    }
+
+    // Разбор запроса: текст в двойных кавычках — фраза, остальное — отдельные слова.
+    QVector<int> queryTerms;
+    QVector<QVector<int>> phraseTerms;
+    bool unknownPhraseTerm = false;
+
+    const QStringList parts = query.split(QLatin1Char('"'));
+    for (int i = 0; i < parts.size(); ++i)
+    {
+        const bool isPhrase = (i % 2) == 1;
+        QVector<int> phrase;
+
+        tokenize(parts[i], [&](const QString& term, int, int) {
+            const int termId = findTerm(term);
+            if (termId < 0)
+            {
+                unknownPhraseTerm = unknownPhraseTerm || isPhrase;
+                return;
+            }
+            if (!queryTerms.contains(termId))
+            {
+                queryTerms.append(termId);
+            }
+            if (isPhrase)
+            {
+                phrase.append(termId);
+            }
+        });
+
+        if (phrase.size() > 1)
+        {
+            phraseTerms.append(phrase);
+        }
+    }
+
+    if (queryTerms.isEmpty() || unknownPhraseTerm)
+    {
+        return hits;
+    }
+
+    // Раскодируем списки только тех слов, что есть в запросе.
+    QVector<Postings> lists;
+    lists.reserve(queryTerms.size());
+    for (int termId : queryTerms)
+    {
+        lists.append(decodePostings(termId));
+    }
+
+    // Накопление оценок BM25 по всем словам запроса.
+    const int pageCount = this->pageCount();
+    QVector<double> scores(pageCount, 0.0);
+    QVector<int> candidates;
+
+    for (const Postings& list : lists)
+    {
+        const int documentFrequency = list.pages.size();
+        const double idf = std::log(1.0 + (pageCount - documentFrequency + 0.5) / (documentFrequency + 0.5));
+
+        for (int i = 0; i < documentFrequency; ++i)
+        {
+            const int page = list.pages[i];
+            if (page < 0 || page >= pageCount)
+            {
+                continue;
+            }
+
+            const double tf = list.positionStarts[i + 1] - list.positionStarts[i];
+            const double norm = kBm25K1 * (1.0 - kBm25B + kBm25B * pageRecord(page)->tokenCount / averagePageLength);
+
+            if (scores[page] == 0.0)
+            {
+                candidates.append(page);
+            }
+            scores[page] += idf * tf * (kBm25K1 + 1.0) / (tf + norm);
+        }
+    }
+
+    // Фразы обязаны встретиться целиком.
+    if (!phraseTerms.isEmpty())
+    {
+        QVector<QVector<const Postings*>> phrases;
+        for (const QVector<int>& phrase : phraseTerms)
+        {
+            QVector<const Postings*> phraseLists;
+            for (int termId : phrase)
+            {
+                phraseLists.append(&lists[queryTerms.indexOf(termId)]);
+            }
+            phrases.append(phraseLists);
+        }
+
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](int page) {
+            for (const auto& phrase : phrases)
+            {
+                if (!matchesPhrase(phrase, page))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }), candidates.end());
+    }
+
+    const auto byScore = [&scores](int a, int b) {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    };
+    const int count = qMin(limit, int(candidates.size()));
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), byScore);
+
+    hits.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        const int page = candidates[i];
+
+        // Фрагмент строится вокруг самого раннего вхождения любого из слов запроса.
+        int firstPosition = -1;
+        for (const Postings& list : lists)
+        {
+            auto it = std::lower_bound(list.pages.cbegin(), list.pages.cend(), page);
+            if (it == list.pages.cend() || *it != page)
+            {
+                continue;
+            }
+            const int position = list.positions[list.positionStarts[int(it - list.pages.cbegin())]];
+            if (firstPosition < 0 || position < firstPosition)
+            {
+                firstPosition = position;
+            }
+        }
+
+        Hit hit;
+        hit.page = page;
+        hit.title = pageTitle(page);
+        hit.filePath = pageFilePath(page);
+        hit.score = scores[page];
+        hit.snippet = makeSnippet(page, firstPosition);
+        hits.append(hit);
+    }
+
+    return hits;
+}
+
+/**
+ * @brief Проверяет, встречается ли фраза на странице.
+ *
+ * Для каждого вхождения первого слова проверяется, что остальные слова стоят сразу за ним.
+ */
+bool SearchIndex::matchesPhrase(const QVector<const Postings*> &phrase, int page) const
+{
+    // Срезы позиций каждого слова фразы на данной странице.
+    QVector<QPair<const int*, const int*>> slices;
+    slices.reserve(phrase.size());
+    for (const Postings* list : phrase)
+    {
+        auto it = std::lower_bound(list->pages.cbegin(), list->pages.cend(), page);
+        if (it == list->pages.cend() || *it != page)
+        {
+            return false;
+        }
+        const int index = int(it - list->pages.cbegin());
+        const int* begin = list->positions.constData() + list->positionStarts[index];
+        const int* end = list->positions.constData() + list->positionStarts[index + 1];
+        slices.append(qMakePair(begin, end));
+    }
+
+    for (const int* start = slices[0].first; start != slices[0].second; ++start)
+    {
+        bool matched = true;
+        for (int k = 1; k < slices.size() && matched; ++k)
+        {
+            matched = std::binary_search(slices[k].first, slices[k].second, *start + k);
+        }
+        if (matched)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Вырезает фрагмент текста страницы вокруг слова с указанным номером.
+ */
+QString SearchIndex::makeSnippet(int page, int position) const
+{
+    const PageRecord* record = pageRecord(page);
+    const QStringView text = stringAt(record->textOffset, record->textLength);
+
+    int center = 0;
+    if (position >= 0 && quint32(position) < record->tokenCount)
+    {
+        // Смещения слов закодированы разностями, поэтому раскодируем их только до нужного слова.
+        const uchar* end = data + size;
+        const uchar* p = postingsData + qMin<quint64>(record->tokenOffsetsOffset, quint64(end - postingsData));
+        quint64 delta = 0;
+        for (int i = 0; i <= position && readVarint(p, end, delta); ++i)
+        {
+            center += int(delta);
+        }
+        center = qMin(center, int(text.size()));
+    }
+
+    int begin = qMax(0, center - kSnippetBefore);
+    int end = qMin(int(text.size()), center + kSnippetAfter);
+
+    // Не разрезаем слова по краям фрагмента.
+    while (begin > 0 && begin < center && !text[begin - 1].isSpace())
+    {
+        ++begin;
+    }
+    while (end < text.size() && end > center && !text[end].isSpace())
+    {
+        --end;
+    }
+
+    QString snippet = text.mid(begin, end - begin).toString().simplified();
+    if (begin > 0)
+    {
+        snippet.prepend(QStringLiteral("… "));
+    }
+    if (end < text.size())
+    {
+        snippet.append(QStringLiteral(" …"));
+    }
+    return snippet;
+}
@@ -0,0 +1,247 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+/**
+ * @file searchindex.h
+ * @brief Определение класса SearchIndex — полнотекстового поиска по страницам справочника.
+ *
+ * Индекс строится по видимому тексту всех HTML страниц из data.json. Для каждого слова хранятся
+ * позиционные списки вхождений, что позволяет искать фразы в кавычках, а результаты ранжируются
+ * по формуле BM25.
+ *
+ * Индекс хранится в двоичном файле search.index рядом с bookmarks.json. Файл отображается в память
+ * через QFile::map, и запросы выполняются прямо по отображенным данным без десериализации.
+ */
+
+#include <QByteArray>
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+#include <functional>
+
+class QFile;
+
+/**
+ * @class SearchIndex
+ * @brief Обратный индекс с позиционными списками и ранжированием BM25.
+ *
+ * Слова приводятся к единому регистру (QChar::toCaseFolded), буква "ё" приравнивается к "е",
+ * поэтому поиск одинаково работает для латиницы и кириллицы.
+ *
+ * Формат файла (версия 2, little-endian):
+ * - заголовок: сигнатура, версия, количество страниц и слов, смещения разделов;
+ * - таблица страниц: хеш содержимого, размер и время изменения файла, название, путь,
+ *   видимый текст и смещения слов в нем;
+ * - словарь: записи фиксированного размера, отсортированные по слову, для двоичного поиска;
+ * - строки: названия, пути, тексты и слова в UTF-16;
+ * - списки вхождений: номера страниц и позиции слов, закодированные разностями в varint.
+ */
+class SearchIndex
+{
+public:
+    /// Страница справочника, попадающая в индекс.
+    struct Page
+    {
+        QString title;
+        QString filePath;
+        quint64 contentHash = 0; ///< Хеш содержимого из data.json; 0 — вычислить по содержимому.
+    };
+
+    /// Результат поиска.
+    struct Hit
+    {
+        int page = -1;     ///< Номер страницы в индексе.
+        QString title;
+        QString filePath;
+        double score = 0;  ///< Оценка BM25.
+        QString snippet;   ///< Фрагмент текста вокруг первого совпадения.
+    };
+
+    /// Размер и время изменения файла страницы.
+    struct FileStamp
+    {
+        qint64 size = -1;     ///< -1 — файл неизвестен, и страницу придется прочитать.
+        qint64 modified = -1; ///< Время изменения в миллисекундах от начала эпохи.
+
+        bool isValid() const { return size >= 0; }
+        bool operator==(const FileStamp& other) const { return size == other.size && modified == other.modified; }
+        bool operator!=(const FileStamp& other) const { return !(*this == other); }
+    };
+
+    /// Функция чтения HTML страницы по пути. Вызывается из рабочих потоков.
+    using PageLoader = std::function<QString(const QString&)>;
+
+    /// Функция получения размера и времени изменения файла страницы. Вызывается из рабочих потоков.
+    using StampReader = std::function<FileStamp(const QString&)>;
+
+    /// Текущая версия формата файла индекса.
+    static constexpr quint32 FormatVersion = 2;
+
+    /**
+     * @brief Строит индекс в памяти, разбирая страницы параллельно на всех ядрах.
+     * @param pages Страницы справочника.
+     * @param loader Функция чтения содержимого страницы.
+     * @return Готовый индекс.
+     */
+    static SearchIndex build(const QVector<Page>& pages, const PageLoader& loader);
+
+    /**
+     * @brief Открывает файл индекса, отображая его в память.
+     * @param indexPath Путь к файлу индекса.
+     * @return Индекс или пустой индекс, если файла нет или его формат не подходит.
+     */
+    static SearchIndex open(const QString& indexPath);
+
+    /**
+     * @brief Открывает сохраненный индекс и обновляет его при изменении страниц.
+     *
+     * Хеши содержимого страниц сравниваются с сохраненными. Если все совпадают, используется
+     * отображенный в память файл. Иначе заново разбираются только измененные и новые страницы,
+     * данные остальных переносятся из старого индекса, и файл перезаписывается атомарно.
+     *
+     * Страница без хеша в data.json читается и хешируется, только если размер или время изменения
+     * ее файла отличаются от сохраненных в индексе; иначе берется сохраненный хеш.
+     *
+     * @param indexPath Путь к файлу индекса.
+     * @param pages Страницы справочника.
+     * @param loader Функция чтения содержимого страницы.
+     * @param stampReader Функция получения размера и времени изменения файла страницы; без нее
+     *                    страницы без хеша читаются всегда.
+     * @return Готовый индекс.
+     */
+    static SearchIndex openOrUpdate(const QString& indexPath, const QVector<Page>& pages, const PageLoader& loader,
+                                    const StampReader& stampReader = StampReader());
+
+    /**
+     * @brief Заменяет в индексе данные нескольких страниц и перезаписывает файл.
+     *
+     * Остальные страницы не разбираются и не извлекаются: их тексты, смещения слов и списки вхождений
+     * слов, которых нет на измененных страницах ни до, ни после правки, копируются из прежнего индекса
+     * байт в байт. Заново кодируются только списки слов измененных страниц.
+     *
+     * Прежний индекс освобождается до записи файла: на Windows отображенный в память файл нельзя
+     * заменить, поэтому других копий base у вызывающего остаться не должно.
+     *
+     * @param base Текущий индекс.
+     * @param indexPath Путь к файлу индекса.
+     * @param pages Измененные страницы; все они должны быть в base.
+     * @param loader Функция чтения содержимого страницы.
+     * @param stampReader Функция получения размера и времени изменения файла страницы.
+     * @return Обновленный индекс или пустой индекс, если какой-то страницы в base нет.
+     */
+    static SearchIndex updatePages(SearchIndex base, const QString& indexPath, const QVector<Page>& pages,
+                                   const PageLoader& loader, const StampReader& stampReader = StampReader());
+
+    /**
+     * @brief Выполняет поиск.
+     *
+     * Слова запроса объединяются по "или", фразы в двойных кавычках обязаны встретиться
+     * в странице целиком и в указанном порядке.
+     *
+     * @param query Строка запроса.
+     * @param limit Максимальное количество результатов.
+     * @return Результаты в порядке убывания оценки.
+     */
+    QVector<Hit> search(const QString& query, int limit = 50) const;
+
+    bool isEmpty() const { return pageCount() == 0; }
+    int pageCount() const;
+
+    /**
+     * @brief Возвращает хеши содержимого проиндексированных страниц по путям.
+     *
+     * Позволяет не читать страницы заново, когда оглавление не содержит хешей (режим разработки).
+     */
+    QHash<QString, quint64> contentHashes() const;
+
+    /**
+     * @brief Разбивает текст на слова.
+     *
+     * Словом считается непрерывная последовательность букв и цифр. Для каждого слова вызывается
+     * callback с приведенным к единому регистру словом, его порядковым номером и смещением в тексте.
+     *
+     * @param text Текст.
+     * @param callback Обработчик слова.
+     */
+    static void tokenize(const QString& text,
+                         const std::function<void(const QString& term, int position, int offset)>& callback);
+
+    /**
+     * @brief Извлекает видимый текст из HTML.
+     * @param html HTML страницы.
+     * @return Текст без разметки.
+     */
+    static QString visibleText(const QString& html);
+
+    /**
+     * @brief Вычисляет хеш содержимого страницы.
+     *
+     * Это первые 8 байт SHA-1 от текста страницы в UTF-8, записанные шестнадцатеричным числом
+     * в поле "hash" в data.json.
+     *
+     * @param html Содержимое страницы.
+     */
+    static quint64 contentHash(const QString& html);
+
+private:
+    /// Раскодированный список вхождений одного слова.
+    struct Postings
+    {
+        QVector<int> pages;          ///< Номера страниц по возрастанию.
+        QVector<int> positionStarts; ///< Начало позиций страницы в positions (размер pages + 1).
+        QVector<int> positions;      ///< Номера слов в тексте страниц.
+    };
+
+    /// Разобранная страница до записи в индекс.
+    struct ParsedPage
+    {
+        QString text;
+        QVector<int> tokenOffsets;
+        QHash<QString, QVector<int>> termPositions;
+    };
+
+    struct Header;
+    struct PageRecord;
+    struct TermRecord;
+
+    static ParsedPage parsePage(const QString& html);
+    static QByteArray serialize(const QVector<Page>& pages, const QVector<quint64>& hashes,
+                                const QVector<FileStamp>& stamps, const QVector<ParsedPage>& parsedPages);
+    static QByteArray assemble(const QVector<PageRecord>& pageRecords, const QVector<TermRecord>& termRecords,
+                               const QString& strings, quint64 totalLength, const QByteArray& postingsBlob);
+    static SearchIndex save(const QString& indexPath, const QByteArray& bytes);
+    static SearchIndex fromData(const QByteArray& data);
+    bool attach(const uchar* data, qint64 size);
+
+    QVector<ParsedPage> extractPages(const QVector<int>& pageIndices) const;
+    QByteArray patch(const QVector<int>& pageIndices, const QVector<quint64>& hashes,
+                     const QVector<FileStamp>& stamps, const QVector<ParsedPage>& parsedPages) const;
+
+    const PageRecord* pageRecord(int page) const;
+    const TermRecord* termRecord(int term) const;
+    QStringView stringAt(quint64 offset, quint32 length) const;
+    QStringView termAt(int term) const;
+    QString pageTitle(int page) const;
+    QString pageFilePath(int page) const;
+    FileStamp pageStamp(int page) const;
+    QVector<int> pageTokenOffsets(int page) const;
+
+    int findTerm(const QString& term) const;
+    Postings decodePostings(int term) const;
+    bool matchesPhrase(const QVector<const Postings*>& phrase, int page) const;
+    QString makeSnippet(int page, int position) const;
+
+    QSharedPointer<QFile> mappedFile; ///< Открытый файл индекса, пока его данные отображены в память.
+    QByteArray buffer;                ///< Данные индекса, если он построен только в памяти.
+    const uchar* data = nullptr;
+    qint64 size = 0;
+    const Header* header = nullptr;
+    const QChar* strings = nullptr;
+    const uchar* postingsData = nullptr;
+    double averagePageLength = 0;
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,311 @@
+/**
+ * @file sessionstate.cpp
+ * @brief Реализация состояния чтения, сохраняемого между запусками.
+ */
+
+#include "sessionstate.h"
+#include "trace.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+#include <cstring>
+
+namespace {
+
+// Числа и строки записываются в файл как есть.
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "Формат файла состояния рассчитан на little-endian");
+
+constexpr char kMagic[8] = {'P', 'P', 'H', 'S', 'T', 'A', 'T', 'E'};
+
+/// Признак в Header::flags: был показан список закладок.
+constexpr quint32 kBookmarksShown = 0x1;
+
+} // namespace
+
+struct SessionState::Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 flags;
+    quint32 pathLength;     ///< Длина пути последней страницы в символах UTF-16.
+    quint32 slotCount;
+    quint64 stamp;          ///< Номер последнего изменения положения прокрутки.
+    quint64 reserved[4];
+};
+
+struct SessionState::Slot
+{
+    quint64 pathHash;       ///< Хеш пути страницы; 0 — свободная запись.
+    qint32 position;
+    quint32 stamp;          ///< Младшие биты Header::stamp на момент обновления.
+};
+
+namespace {
+
+constexpr qint64 kPathOffset = 64;
+constexpr qint64 kSlotsOffset = kPathOffset + qint64(SessionState::PathCapacity) * 2;
+constexpr qint64 kSlotSize = 16;
+constexpr qint64 kFileSize = kSlotsOffset + qint64(SessionState::SlotCount) * kSlotSize;
+
+} // namespace
+
+SessionState::SessionState(QObject *parent)
+    : QObject(parent)
+{
+    static_assert(sizeof(Header) == kPathOffset, "Неожиданный размер заголовка файла состояния");
+    static_assert(sizeof(Slot) == kSlotSize, "Неожиданный размер записи положения прокрутки");
+
+    saveTimer.setSingleShot(true);
+    saveTimer.setInterval(DefaultSaveDelayMs);
+    connect(&saveTimer, &QTimer::timeout, this, &SessionState::flush);
+
+    reset();
+}
+
+SessionState::~SessionState()
+{
+    flush();
+}
+
+bool SessionState::load(const QString &filePath)
+{
+    TraceSpan span("session.load", "startup");
+
+    statePath = filePath;
+    saveTimer.stop();
+    dirtyRanges.clear();
+
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadOnly))
+    {
+        const QByteArray data = file.read(kFileSize + 1);
+        const Header* candidate = reinterpret_cast<const Header*>(data.constData());
+        if (data.size() == kFileSize && memcmp(candidate->magic, kMagic, sizeof(kMagic)) == 0
+            && candidate->version == FormatVersion && candidate->slotCount == quint32(SlotCount)
+            && candidate->pathLength <= quint32(PathCapacity))
+        {
+            image = data;
+            rewrite = false;
+            return true;
+        }
+        qDebug() << "Файл состояния поврежден или другой версии, состояние сброшено:" << filePath;
+    }
+
+    reset();
+    return false;
+}
+
+QString SessionState::currentPage() const
+{
+    return QString(reinterpret_cast<const QChar*>(image.constData() + kPathOffset), int(header()->pathLength));
+}
+
+bool SessionState::bookmarksShown() const
+{
+    return header()->flags & kBookmarksShown;
+}
+
+int SessionState::scrollPosition(const QString &filePath) const
+{
+    const quint64 hash = pathHash(filePath);
+    const int index = findSlot(hash);
+    const Slot* slot = slotAt(index);
+    return slot->pathHash == hash ? slot->position : 0;
+}
+
+void SessionState::setCurrentPage(const QString &filePath)
+{
+    // Путь длиннее поля не запоминается: лучше начать с первой страницы, чем открыть чужую.
+    const QString path = filePath.size() <= PathCapacity ? filePath : QString();
+    if (path == currentPage())
+    {
+        return;
+    }
+
+    QChar* field = reinterpret_cast<QChar*>(image.data() + kPathOffset);
+    memcpy(field, path.constData(), size_t(path.size()) * sizeof(QChar));
+    header()->pathLength = quint32(path.size());
+    markDirty(0, kPathOffset);
+    markDirty(kPathOffset, qint64(path.size()) * 2);
+}
+
+void SessionState::setBookmarksShown(bool shown)
+{
+    if (bookmarksShown() == shown)
+    {
+        return;
+    }
+
+    header()->flags = shown ? (header()->flags | kBookmarksShown) : (header()->flags & ~kBookmarksShown);
+    markDirty(0, kPathOffset);
+}
+
+void SessionState::setScrollPosition(const QString &filePath, int position)
+{
+    if (filePath.isEmpty())
+    {
+        return;
+    }
+
+    const quint64 hash = pathHash(filePath);
+    const int index = findSlot(hash);
+    Slot* slot = slotAt(index);
+    if (slot->pathHash == hash && slot->position == position)
+    {
+        return;
+    }
+
+    Header* state = header();
+    ++state->stamp;
+    slot->pathHash = hash;
+    slot->position = position;
+    slot->stamp = quint32(state->stamp);
+
+    // Счетчик записей лежит в заголовке, поэтому он записывается вместе с записью таблицы.
+    markDirty(0, kPathOffset);
+    markDirty(kSlotsOffset + qint64(index) * kSlotSize, kSlotSize);
+}
+
+/**
+ * @brief Записывает измененные участки поверх файла или весь файл, если его еще нет.
+ *
+ * Файл постоянного размера перезаписывается на месте: заголовок, путь и измененные записи таблицы.
+ * Оборванная запись может испортить только путь последней страницы или одно положение прокрутки;
+ * если же файла нет или он другого размера, он записывается целиком через QSaveFile.
+ */
+bool SessionState::flush()
+{
+    saveTimer.stop();
+    if (statePath.isEmpty() || (dirtyRanges.isEmpty() && !rewrite))
+    {
+        return true;
+    }
+
+    TraceSpan span("session.save", "session");
+
+    if (!rewrite)
+    {
+        QFile file(statePath);
+        bool written = file.open(QIODevice::ReadWrite) && file.size() == kFileSize;
+        qint64 bytes = 0;
+        for (auto it = dirtyRanges.cbegin(); written && it != dirtyRanges.cend(); ++it)
+        {
+            written = file.seek(it.key()) && file.write(image.constData() + it.key(), it.value()) == it.value();
+            bytes += it.value();
+        }
+        if (written)
+        {
+            span.setDetail(QString::number(bytes) + " B");
+            dirtyRanges.clear();
+            return true;
+        }
+        rewrite = true;
+    }
+
+    QSaveFile file(statePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(image) != image.size() || !file.commit())
+    {
+        qDebug() << "Не удалось сохранить состояние сеанса:" << file.errorString();
+        return false;
+    }
+
+    span.setDetail(QString::number(image.size()) + " B");
+    rewrite = false;
+    dirtyRanges.clear();
+    return true;
+}
+
+SessionState::Header *SessionState::header()
+{
+    return reinterpret_cast<Header*>(image.data());
+}
+
+const SessionState::Header *SessionState::header() const
+{
+    return reinterpret_cast<const Header*>(image.constData());
+}
+
+SessionState::Slot *SessionState::slotAt(int index)
+{
+    return reinterpret_cast<Slot*>(image.data() + kSlotsOffset) + index;
+}
+
+const SessionState::Slot *SessionState::slotAt(int index) const
+{
+    return reinterpret_cast<const Slot*>(image.constData() + kSlotsOffset) + index;
+}
+
+/**
+ * @brief Ищет запись страницы среди ProbeLimit записей, начиная с позиции хеша.
+ * @return Запись страницы, иначе первая свободная, иначе та, что обновлялась раньше других.
+ */
+int SessionState::findSlot(quint64 pathHash) const
+{
+    const quint32 now = quint32(header()->stamp);
+    int freeSlot = -1;
+    int oldestSlot = -1;
+    quint32 oldestAge = 0;
+    for (int probe = 0; probe < ProbeLimit; ++probe)
+    {
+        const int index = int((pathHash + quint64(probe)) % SlotCount);
+        const Slot* slot = slotAt(index);
+        if (slot->pathHash == pathHash)
+        {
+            return index;
+        }
+        if (slot->pathHash == 0)
+        {
+            if (freeSlot < 0)
+            {
+                freeSlot = index;
+            }
+            continue;
+        }
+
+        // Возраст считается по модулю 2^32, поэтому переполнение счетчика не путает порядок.
+        const quint32 age = now - slot->stamp;
+        if (oldestSlot < 0 || age > oldestAge)
+        {
+            oldestSlot = index;
+            oldestAge = age;
+        }
+    }
+    return freeSlot >= 0 ? freeSlot : oldestSlot;
+}
+
+void SessionState::reset()
+{
+    image = QByteArray(int(kFileSize), '\0');
+    Header* state = header();
+    memcpy(state->magic, kMagic, sizeof(kMagic));
+    state->version = FormatVersion;
+    state->slotCount = quint32(SlotCount);
+    rewrite = true;
+    dirtyRanges.clear();
+}
+
+void SessionState::markDirty(qint64 offset, qint64 length)
+{
+    if (length > 0)
+    {
+        qint64& dirtyLength = dirtyRanges[offset];
+        dirtyLength = qMax(dirtyLength, length);
+    }
+    saveTimer.start();
+}
+
+/**
+ * @brief Хеш FNV-1a пути страницы. Значение 0 зарезервировано для свободной записи.
+ */
+quint64 SessionState::pathHash(const QString &filePath)
+{
+    quint64 hash = 14695981039346656037ull;
+    for (const QChar c : filePath)
+    {
+        hash ^= c.unicode();
+        hash *= 1099511628211ull;
+    }
+    return hash ? hash : 1;
+}
@@ -0,0 +1,107 @@
+#ifndef SESSIONSTATE_H
+#define SESSIONSTATE_H
+
+/**
+ * @file sessionstate.h
+ * @brief Определение класса SessionState — состояния чтения, сохраняемого между запусками.
+ *
+ * Состояние хранится в двоичном файле session.state рядом с bookmarks.json: последняя открытая
+ * страница, режим списка закладок и положение прокрутки страниц. Файл имеет постоянный размер
+ * и фиксированную раскладку, поэтому при запуске читается одним вызовом read() без разбора,
+ * а изменения записываются поверх только тех участков, которые изменились.
+ */
+
+#include <QByteArray>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+/**
+ * @class SessionState
+ * @brief Последняя страница, режим закладок и положения прокрутки с отложенной записью.
+ *
+ * Изменения копятся в памяти и записываются через saveDelay() после последнего из них, поэтому
+ * прокрутка страницы не превращается в поток записей на диск.
+ *
+ * Формат файла (версия 1, little-endian):
+ * - заголовок (64 байта): сигнатура, версия, флаги, длина пути последней страницы, счетчик записей;
+ * - путь последней страницы: PathCapacity символов UTF-16;
+ * - таблица положений прокрутки: SlotCount записей {хеш пути, положение, номер записи}.
+ *   Запись ищется линейным пробированием от хеша пути; если место кончилось, вытесняется
+ *   запись, обновленная раньше других.
+ */
+class SessionState : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint32 FormatVersion = 1;
+    static constexpr int PathCapacity = 512;  ///< Наибольшая длина пути последней страницы в символах.
+    static constexpr int SlotCount = 1024;    ///< Количество запоминаемых положений прокрутки.
+    static constexpr int ProbeLimit = 8;      ///< Сколько соседних записей просматривается при поиске.
+    static constexpr int DefaultSaveDelayMs = 500;
+
+    explicit SessionState(QObject* parent = nullptr);
+
+    /**
+     * @brief Деструктор. Записывает несохраненные изменения.
+     */
+    ~SessionState() override;
+
+    /**
+     * @brief Читает файл состояния. Отсутствующий или поврежденный файл дает пустое состояние.
+     * @param filePath Путь к session.state.
+     * @return true, если состояние прочитано из файла.
+     */
+    bool load(const QString& filePath);
+
+    /// Последняя страница текущей вкладки или пустая строка.
+    QString currentPage() const;
+
+    /// Был ли показан список закладок.
+    bool bookmarksShown() const;
+
+    /**
+     * @brief Возвращает сохраненное положение прокрутки страницы или 0.
+     */
+    int scrollPosition(const QString& filePath) const;
+
+    void setCurrentPage(const QString& filePath);
+    void setBookmarksShown(bool shown);
+    void setScrollPosition(const QString& filePath, int position);
+
+    /**
+     * @brief Задает задержку записи после последнего изменения. 0 — записывать при каждом изменении.
+     */
+    void setSaveDelay(int msec) { saveTimer.setInterval(qMax(0, msec)); }
+    int saveDelay() const { return saveTimer.interval(); }
+
+    /**
+     * @brief Сразу записывает накопленные изменения.
+     * @return true, если запись прошла успешно или записывать было нечего.
+     */
+    bool flush();
+
+private:
+    struct Header;
+    struct Slot;
+
+    Header* header();
+    const Header* header() const;
+    Slot* slotAt(int index);
+    const Slot* slotAt(int index) const;
+    int findSlot(quint64 pathHash) const;
+    void reset();
+    void markDirty(qint64 offset, qint64 length);
+
+    static quint64 pathHash(const QString& filePath);
+
+    QByteArray image;         ///< Содержимое файла целиком, в той же раскладке, что и на диске.
+    QString statePath;
+    QMap<qint64, qint64> dirtyRanges; ///< Еще не записанные участки image: смещение и длина.
+    bool rewrite = false;     ///< Файла нет или он поврежден: записать целиком через QSaveFile.
+    QTimer saveTimer;
+};
+
+#endif // SESSIONSTATE_H
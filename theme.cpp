@@ -0,0 +1,64 @@
+/**
+ * @file theme.cpp
+ * @brief Реализация установки темы и переключения состояний виджетов.
+ */
+
+#include "theme.h"
+
+#include <QStyle>
+#include <QWidget>
+
+namespace {
+
+/**
+ * @brief Заново применяет правила таблицы стилей к виджету после изменения его свойств.
+ */
+void repolish(QWidget* widget)
+{
+    QStyle* style = widget->style();
+    style->unpolish(widget);
+    style->polish(widget);
+    widget->update();
+}
+
+} // namespace
+
+void Theme::install(QWidget *window, const QString &styleSheet, const QString &name)
+{
+    // Свойство устанавливается до таблицы стилей, чтобы виджеты сразу получили нужный вариант.
+    window->setProperty("theme", name);
+    window->setStyleSheet(styleSheet);
+}
+
+void Theme::setTheme(QWidget *window, const QString &name)
+{
+    if (theme(window) == name)
+    {
+        return;
+    }
+
+    window->setProperty("theme", name);
+
+    repolish(window);
+    const QList<QWidget*> children = window->findChildren<QWidget*>();
+    for (QWidget* child : children)
+    {
+        repolish(child);
+    }
+}
+
+QString Theme::theme(const QWidget *window)
+{
+    return window->property("theme").toString();
+}
+
+void Theme::setState(QWidget *widget, const char *state)
+{
+    if (widget->property("state").toString() == QLatin1String(state))
+    {
+        return;
+    }
+
+    widget->setProperty("state", QString::fromLatin1(state));
+    repolish(widget);
+}
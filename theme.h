@@ -0,0 +1,62 @@
+#ifndef THEME_H
+#define THEME_H
+
+/**
+ * @file theme.h
+ * @brief Определение класса Theme — оформления окна через одну таблицу стилей и свойства виджетов.
+ *
+ * Таблица стилей theme.qss разбирается Qt один раз, когда устанавливается на главное окно.
+ * Дальше оформление меняется только свойствами: свойство theme окна выбирает светлый или темный
+ * вариант, а свойство state кнопки — ее состояние. Строки стилей во время работы не создаются.
+ */
+
+#include <QString>
+
+class QWidget;
+
+/**
+ * @class Theme
+ * @brief Установка темы и переключение состояний виджетов.
+ */
+class Theme
+{
+public:
+    /// Имя светлой темы (используется по умолчанию).
+    static constexpr const char* Light = "light";
+
+    /// Имя темной темы.
+    static constexpr const char* Dark = "dark";
+
+    /**
+     * @brief Устанавливает таблицу стилей темы на окно.
+     * @param window Главное окно.
+     * @param styleSheet Содержимое файла темы theme.qss.
+     * @param name Имя варианта темы.
+     */
+    static void install(QWidget* window, const QString& styleSheet, const QString& name);
+
+    /**
+     * @brief Переключает вариант темы без пересборки таблицы стилей.
+     *
+     * Заново применяются уже разобранные правила ко всем виджетам окна.
+     * @param window Главное окно.
+     * @param name Имя варианта темы.
+     */
+    static void setTheme(QWidget* window, const QString& name);
+
+    /**
+     * @brief Возвращает имя текущего варианта темы окна.
+     */
+    static QString theme(const QWidget* window);
+
+    /**
+     * @brief Устанавливает состояние виджета (свойство state).
+     *
+     * Если состояние не изменилось, ничего не делает; иначе заново применяет стиль только к этому виджету.
+     * @param widget Виджет.
+     * @param state Имя состояния, например "normal" или "disabled".
+     */
+    static void setState(QWidget* widget, const char* state);
+};
+
+#endif // THEME_H
@@ -0,0 +1,343 @@
+/**
+ * @file titlematcher.cpp
+ * @brief Реализация нечеткого поиска по названиям страниц.
+ */
+
+#include "titlematcher.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+/// Признак триграммы начала слова: вместо третьего символа — 0. По ней ищется запрос из одной буквы.
+constexpr ushort WordStartMarker = 0;
+
+quint64 trigramKey(QChar a, QChar b, ushort c)
+{
+    return (quint64(a.unicode()) << 32) | (quint64(b.unicode()) << 16) | c;
+}
+
+/**
+ * @brief Добавляет ключи триграмм слова.
+ *
+ * Слово дополняется пробелами по краям, поэтому первые и последние буквы тоже попадают
+ * в триграммы. У последнего слова запроса, которое еще набирается, правый пробел не ставится:
+ * тогда запрос "синт" совпадает с началом слова "синтаксис".
+ * @param word Нормализованное слово.
+ * @param padEnd Дополнять ли слово пробелом справа.
+ * @param wordStart Добавлять ли ключ начала слова (при построении индекса).
+ * @param keys Ключи.
+ */
+void appendWordKeys(QStringView word, bool padEnd, bool wordStart, QVector<quint64>& keys)
+{
+    if (word.isEmpty())
+    {
+        return;
+    }
+
+    const QChar space(' ');
+    if (wordStart || (!padEnd && word.size() == 1))
+    {
+        keys.append(trigramKey(space, word.at(0), WordStartMarker));
+    }
+
+    const int padded = int(word.size()) + (padEnd ? 2 : 1);
+    for (int i = 0; i + 3 <= padded; ++i)
+    {
+        auto at = [&](int index) { return index == 0 || index > word.size() ? space : word.at(index - 1); };
+        keys.append(trigramKey(at(i), at(i + 1), at(i + 2).unicode()));
+    }
+}
+
+/**
+ * @brief Возвращает различные ключи триграмм нормализованного текста.
+ * @param text Нормализованный текст.
+ * @param isQuery Текст — запрос: последнее слово не дополняется справа, ключи начала слов не нужны.
+ */
+QVector<quint64> trigramKeys(QStringView text, bool isQuery)
+{
+    QVector<quint64> keys;
+    qsizetype start = 0;
+    while (start < text.size())
+    {
+        qsizetype end = text.indexOf(QChar(' '), start);
+        if (end < 0)
+        {
+            end = text.size();
+        }
+        const bool last = end == text.size();
+        appendWordKeys(text.mid(start, end - start), !(isQuery && last), !isQuery, keys);
+        start = end + 1;
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+/// Пары клавиш раскладок QWERTY и ЙЦУКЕН в одинаковом порядке.
+const QString& latinKeys()
+{
+    static const QString keys = QStringLiteral("`qwertyuiop[]asdfghjkl;'zxcvbnm,.~QWERTYUIOP{}ASDFGHJKL:\"ZXCVBNM<>");
+    return keys;
+}
+
+const QString& cyrillicKeys()
+{
+    static const QString keys = QStringLiteral("ёйцукенгшщзхъфывапролджэячсмитьбюЁЙЦУКЕНГШЩЗХЪФЫВАПРОЛДЖЭЯЧСМИТЬБЮ");
+    return keys;
+}
+
+} // namespace
+
+TitleMatcher::TitleMatcher(const QStringList &titleList)
+{
+    titleStarts.reserve(titleList.size() + 1);
+
+    QVector<std::pair<quint64, int>> pairs;
+    for (int row = 0; row < titleList.size(); ++row)
+    {
+        titleStarts.append(int(titles.size()));
+        const QString normalized = normalize(titleList[row]);
+        titles += normalized;
+
+        for (const quint64 key : trigramKeys(normalized, false))
+        {
+            pairs.append({key, row});
+        }
+    }
+    titleStarts.append(int(titles.size()));
+
+    // Списки названий по триграммам хранятся подряд в одном массиве, как в сжатой разреженной матрице.
+    std::sort(pairs.begin(), pairs.end());
+    postings.reserve(pairs.size());
+    for (int i = 0; i < pairs.size(); ++i)
+    {
+        if (i == 0 || pairs[i].first != pairs[i - 1].first)
+        {
+            trigramSlots.insert(pairs[i].first, postingStarts.size());
+            postingStarts.append(postings.size());
+        }
+        postings.append(pairs[i].second);
+    }
+    postingStarts.append(postings.size());
+
+    sharedCounts.fill(0, count());
+}
+
+QVector<TitleMatcher::Match> TitleMatcher::match(const QString &query, int limit)
+{
+    QVector<float> best;
+    QVector<int> rows;
+    auto add = [&](const QString& variant, double weight) {
+        collect(normalize(variant), weight, best, rows);
+    };
+
+    add(query, 1.0);
+
+    // Запрос, набранный не в той раскладке, оценивается чуть ниже исходного.
+    const QString cyrillic = switchLayout(query, true);
+    if (cyrillic != query)
+    {
+        add(cyrillic, 0.95);
+    }
+    const QString latin = switchLayout(query, false);
+    if (latin != query)
+    {
+        add(latin, 0.95);
+    }
+
+    QVector<Match> matches;
+    matches.reserve(rows.size());
+    for (const int row : rows)
+    {
+        matches.append({row, best[row]});
+    }
+
+    auto better = [](const Match& a, const Match& b) {
+        return a.score != b.score ? a.score > b.score : a.row < b.row;
+    };
+    if (matches.size() > limit)
+    {
+        std::partial_sort(matches.begin(), matches.begin() + limit, matches.end(), better);
+        matches.resize(limit);
+    }
+    else
+    {
+        std::sort(matches.begin(), matches.end(), better);
+    }
+    return matches;
+}
+
+/**
+ * @brief Отбирает названия по общим триграммам и оценивает их.
+ * @param normalizedQuery Нормализованный запрос.
+ * @param weight Множитель оценки (ниже для перевода между раскладками).
+ * @param best Лучшая оценка каждого названия, создается по первому найденному.
+ * @param rows Названия с ненулевой оценкой.
+ */
+void TitleMatcher::collect(const QString &normalizedQuery, double weight, QVector<float> &best, QVector<int> &rows)
+{
+    const QVector<quint64> keys = trigramKeys(normalizedQuery, true);
+    if (keys.isEmpty())
+    {
+        return;
+    }
+
+    touchedRows.clear();
+    for (const quint64 key : keys)
+    {
+        const auto slot = trigramSlots.constFind(key);
+        if (slot == trigramSlots.constEnd())
+        {
+            continue;
+        }
+        for (int i = postingStarts[*slot]; i < postingStarts[*slot + 1]; ++i)
+        {
+            const int row = postings[i];
+            if (sharedCounts[row]++ == 0)
+            {
+                touchedRows.append(row);
+            }
+        }
+    }
+
+    // Одна опечатка портит до трех триграмм слова: на каждые пять букв запроса допускается одна.
+    QString compactQuery = normalizedQuery;
+    compactQuery.remove(QChar(' '));
+    const int queryTrigrams = keys.size();
+    const int typos = int(compactQuery.size()) / 5;
+    const int minShared = qMax(qMax(1, (queryTrigrams + 2) / 3), queryTrigrams - 3 * typos);
+
+    if (best.isEmpty())
+    {
+        best.fill(0, count());
+    }
+    for (const int row : touchedRows)
+    {
+        const int shared = sharedCounts[row];
+        sharedCounts[row] = 0;
+        if (shared < minShared)
+        {
+            continue;
+        }
+
+        const double value = score(titleAt(row), normalizedQuery, compactQuery, shared, queryTrigrams) * weight;
+        if (value <= 0)
+        {
+            continue;
+        }
+        if (best[row] == 0)
+        {
+            rows.append(row);
+        }
+        best[row] = qMax(best[row], float(value));
+    }
+}
+
+/**
+ * @brief Оценивает совпадение названия с запросом.
+ *
+ * Лучше всего — запрос подстрокой в названии, особенно в начале названия или слова; затем —
+ * все буквы запроса по порядку (подпоследовательность), выше при совпадении начал слов и идущих
+ * подряд букв; хуже всего — только доля общих триграмм, то есть запрос с опечатками.
+ */
+double TitleMatcher::score(QStringView title, const QString &query, const QString &compactQuery,
+                           int sharedTrigrams, int queryTrigrams) const
+{
+    // Короткие названия при прочих равных выше: в них совпадение занимает большую часть.
+    const double lengthPenalty = qMin(0.2, title.size() * 0.001);
+
+    const qsizetype position = title.indexOf(query);
+    if (position >= 0)
+    {
+        double value = 3.0;
+        if (position == 0)
+        {
+            value += 1.0;
+        }
+        else if (title.at(position - 1) == QChar(' '))
+        {
+            value += 0.5;
+        }
+        return value - lengthPenalty;
+    }
+
+    double bonus = 0;
+    qsizetype next = 0;
+    qsizetype previous = -2;
+    bool subsequence = true;
+    for (const QChar c : compactQuery)
+    {
+        const qsizetype found = title.indexOf(c, next);
+        if (found < 0)
+        {
+            subsequence = false;
+            break;
+        }
+        bonus += 1.0;
+        if (found == 0 || title.at(found - 1) == QChar(' '))
+        {
+            bonus += 1.0;
+        }
+        if (found == previous + 1)
+        {
+            bonus += 1.0;
+        }
+        previous = found;
+        next = found + 1;
+    }
+    if (subsequence && !compactQuery.isEmpty())
+    {
+        return 1.0 + bonus / (3.0 * compactQuery.size()) - lengthPenalty;
+    }
+
+    const double shared = double(sharedTrigrams) / queryTrigrams;
+    return shared >= 0.3 ? shared * 0.9 - lengthPenalty : 0;
+}
+
+QStringView TitleMatcher::titleAt(int row) const
+{
+    return QStringView(titles).mid(titleStarts[row], titleStarts[row + 1] - titleStarts[row]);
+}
+
+QString TitleMatcher::normalize(QStringView text)
+{
+    QString result;
+    result.reserve(text.size());
+    for (const QChar c : text)
+    {
+        if (c.isLetterOrNumber())
+        {
+            const QChar folded = c.toCaseFolded();
+            result += folded == QChar(0x0451) ? QChar(0x0435) : folded; // ё -> е
+        }
+        else if (!result.isEmpty() && !result.endsWith(QChar(' ')))
+        {
+            result += QChar(' ');
+        }
+    }
+    if (result.endsWith(QChar(' ')))
+    {
+        result.chop(1);
+    }
+    return result;
+}
+
+QString TitleMatcher::switchLayout(const QString &text, bool toCyrillic)
+{
+    const QString& from = toCyrillic ? latinKeys() : cyrillicKeys();
+    const QString& to = toCyrillic ? cyrillicKeys() : latinKeys();
+
+    QString result = text;
+    for (QChar& c : result)
+    {
+        const qsizetype index = from.indexOf(c);
+        if (index >= 0)
+        {
+            c = to.at(index);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,92 @@
+#ifndef TITLEMATCHER_H
+#define TITLEMATCHER_H
+
+/**
+ * @file titlematcher.h
+ * @brief Определение класса TitleMatcher — нечеткого поиска по названиям страниц.
+ *
+ * Названия приводятся к единому регистру (QChar::toCaseFolded, "ё" — как "е"), знаки препинания
+ * заменяются пробелами. По словам названий строится индекс триграмм: запрос сначала отбирает
+ * названия, у которых достаточно общих с ним триграмм, и только они оцениваются точнее —
+ * по вхождению подстроки и подпоследовательности символов запроса.
+ *
+ * Запрос, набранный не в той раскладке ("cbyntrc" вместо "синтакс"), тоже находит страницу:
+ * вместе с исходным запросом ищется его перевод между раскладками ЙЦУКЕН и QWERTY.
+ */
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+/**
+ * @class TitleMatcher
+ * @brief Индекс триграмм по названиям страниц и оценка совпадения с запросом.
+ *
+ * Индекс неизменяем после построения, но match() пишет во внутренние рабочие массивы и поэтому
+ * не константен: один объект нельзя опрашивать из нескольких потоков одновременно (в программе
+ * его опрашивает только главный поток).
+ */
+class TitleMatcher
+{
+public:
+    /// Найденное название.
+    struct Match
+    {
+        int row = -1;       ///< Номер названия в списке, переданном при построении.
+        double score = 0;   ///< Оценка совпадения, больше — лучше.
+    };
+
+    TitleMatcher() = default;
+
+    /**
+     * @brief Строит индекс.
+     * @param titles Названия страниц в порядке оглавления.
+     */
+    explicit TitleMatcher(const QStringList& titles);
+
+    /**
+     * @brief Ищет названия, похожие на запрос.
+     *
+     * Не потокобезопасен: использует рабочие массивы объекта.
+     * @param query Набранный текст.
+     * @param limit Максимальное количество результатов.
+     * @return Результаты в порядке убывания оценки, при равной оценке — в порядке оглавления.
+     */
+    QVector<Match> match(const QString& query, int limit = 50);
+
+    int count() const { return titleStarts.isEmpty() ? 0 : titleStarts.size() - 1; }
+
+    /**
+     * @brief Приводит текст к виду, в котором хранятся названия: единый регистр, "ё" как "е",
+     * вместо знаков препинания и повторяющихся пробелов — один пробел.
+     */
+    static QString normalize(QStringView text);
+
+    /**
+     * @brief Переводит текст, набранный в раскладке QWERTY, в ЙЦУКЕН и наоборот.
+     * @param text Текст запроса.
+     * @param toCyrillic true — латинские клавиши в русские буквы, false — русские буквы в латинские клавиши.
+     * @return Переведенный текст; символы, которых нет на основных клавишах, не меняются.
+     */
+    static QString switchLayout(const QString& text, bool toCyrillic);
+
+private:
+    void collect(const QString& normalizedQuery, double weight, QVector<float>& best, QVector<int>& rows);
+    double score(QStringView title, const QString& query, const QString& compactQuery,
+                 int sharedTrigrams, int queryTrigrams) const;
+    QStringView titleAt(int row) const;
+
+    QString titles;                 ///< Нормализованные названия подряд.
+    QVector<int> titleStarts;       ///< Начало каждого названия в titles (размер count() + 1).
+
+    QHash<quint64, int> trigramSlots; ///< Триграмма -> номер ее списка в postingStarts.
+    QVector<int> postingStarts;       ///< Начало списка названий каждой триграммы в postings.
+    QVector<int> postings;            ///< Номера названий, отсортированные внутри каждого списка.
+
+    QVector<quint16> sharedCounts;  ///< Рабочий массив: число общих с запросом триграмм.
+    QVector<int> touchedRows;       ///< Рабочий массив: названия с ненулевым sharedCounts.
+};
+
+#endif // TITLEMATCHER_H
@@ -0,0 +1,71 @@
+#ifndef TOCJSON_H
+#define TOCJSON_H
+
+/**
+ * @file tocjson.h
+ * @brief Обход вложенного оглавления data.json.
+ *
+ * Запись data.json может содержать вложенные разделы в массиве "children":
+ *     [
+ *         {"title": "Глава", "filePath": ":/texts/1.html", "children": [
+ *             {"title": "Раздел", "filePath": ":/texts/1.1.html", "children": [...]}
+ *         ]}
+ *     ]
+ * Плоский массив без "children" — частный случай такого оглавления.
+ *
+ * Функции только читают JSON и нужны и программе, и утилитам сборки, поэтому определены в заголовке.
+ */
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QVector>
+
+namespace TocJson {
+
+/// Запись оглавления в порядке обхода в глубину.
+struct Entry
+{
+    QJsonObject object;
+    int parent;      ///< Номер родительской записи или -1 для записей верхнего уровня.
+    int subtreeEnd;  ///< Номер первой записи после всех вложенных разделов этой записи.
+};
+
+/**
+ * @brief Дописывает записи и их вложенные разделы в порядке обхода в глубину.
+ * @param entries Массив записей одного уровня.
+ * @param parent Номер родительской записи или -1.
+ * @param result Результат.
+ */
+inline void appendEntries(const QJsonArray& entries, int parent, QVector<Entry>& result)
+{
+    for (const QJsonValue& value : entries)
+    {
+        const int row = result.size();
+        const QJsonObject object = value.toObject();
+        result.append({object, parent, row + 1});
+
+        const QJsonValue children = object.value(QLatin1String("children"));
+        if (children.isArray())
+        {
+            appendEntries(children.toArray(), row, result);
+        }
+        result[row].subtreeEnd = result.size();
+    }
+}
+
+/**
+ * @brief Возвращает все записи оглавления в порядке обхода в глубину: глава, ее разделы, следующая глава.
+ *
+ * Это порядок чтения справочника: в нем же переходят кнопки "Следующая" и "Предыдущая".
+ */
+inline QVector<Entry> flatten(const QJsonArray& entries)
+{
+    QVector<Entry> result;
+    result.reserve(entries.size());
+    appendEntries(entries, -1, result);
+    return result;
+}
+
+} // namespace TocJson
+
+#endif // TOCJSON_H
@@ -0,0 +1,1077 @@
+/**
+ * @file tocmodel.cpp
+ * @brief Реализация моделей оглавления справочника.
+ */
+
+#include "tocmodel.h"
+
+#include <QJsonObject>
+
+#include <algorithm>
+#include <utility>
+
+TocModel::TocModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int TocModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+    {
+        return 0;
+    }
+    return table ? tableCount : titleOffsets.size();
+}
+
+QVariant TocModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount())
+    {
+        return QVariant();
+    }
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        return title(index.row());
+    case FilePathRole:
+        return filePath(index.row());
+    case ContentHashRole:
+        return contentHash(index.row());
+    default:
+        return QVariant();
+    }
+}
+
+/// Незагруженная страница, найденная по пути: загруженная строка и номера разделов на пути к странице.
+struct TocModel::PathMatch
+{
+    int row;
+    QVector<int> chain;
+};
+
+void TocModel::loadFromJson(const QJsonArray &entries)
+{
+    beginResetModel();
+
+    table = nullptr;
+    tablePathOrder = nullptr;
+    tableCount = 0;
+    tableLoaded.clear();
+
+    buffer.clear();
+    titleOffsets.clear();
+    titleLengths.clear();
+    pathOffsets.clear();
+    pathLengths.clear();
+    hashes.clear();
+    parents.clear();
+    childCounts.clear();
+    firstChildren.clear();
+    pendingChildren.clear();
+    pendingCount = 0;
+    absentPaths.clear();
+
+    // Разбирается только верхний уровень: разделы глав остаются в JSON до раскрытия.
+    appendRows(entries, -1);
+    topLevelCount = entries.size();
+    buildPathIndex();
+
+    endResetModel();
+}
+
+void TocModel::loadFromTable(const TocEntry *entries, const int *pathOrder, int count)
+{
+    beginResetModel();
+
+    buffer.clear();
+    titleOffsets.clear();
+    titleLengths.clear();
+    pathOffsets.clear();
+    pathLengths.clear();
+    hashes.clear();
+    parents.clear();
+    childCounts.clear();
+    firstChildren.clear();
+    pendingChildren.clear();
+    topLevelCount = 0;
+    pendingCount = 0;
+    pathSlots.clear();
+    absentPaths.clear();
+
+    table = entries;
+    tablePathOrder = pathOrder;
+    tableCount = count;
+    tableLoaded.fill(false, count);
+
+    endResetModel();
+}
+
+/**
+ * @brief Дописывает записи одного уровня в конец модели.
+ *
+ * Разделы записей не разбираются: сохраняется только их массив и количество.
+ * @param entries Записи уровня.
+ * @param parent Строка родителя или -1.
+ */
+void TocModel::appendRows(const QJsonArray &entries, int parent)
+{
+    const int count = titleOffsets.size() + entries.size();
+    titleOffsets.reserve(count);
+    titleLengths.reserve(count);
+    pathOffsets.reserve(count);
+    pathLengths.reserve(count);
+    hashes.reserve(count);
+    parents.reserve(count);
+    childCounts.reserve(count);
+    firstChildren.reserve(count);
+    pendingChildren.reserve(count);
+
+    for (const QJsonValue& value : entries)
+    {
+        const QJsonObject obj = value.toObject();
+        const QString title = obj["title"].toString();
+        const QString filePath = obj["filePath"].toString();
+
+        titleOffsets.append(buffer.size());
+        titleLengths.append(title.size());
+        buffer.append(title);
+
+        pathOffsets.append(buffer.size());
+        pathLengths.append(filePath.size());
+        buffer.append(filePath);
+
+        hashes.append(obj["hash"].toString().toULongLong(nullptr, 16));
+        parents.append(parent);
+
+        const QJsonArray children = obj["children"].toArray();
+        childCounts.append(children.size());
+        firstChildren.append(-1);
+        pendingChildren.append(children);
+        if (!children.isEmpty())
+        {
+            ++pendingCount;
+        }
+    }
+}
+
+QStringView TocModel::pathView(int row) const
+{
+    return QStringView(buffer).mid(pathOffsets[row], pathLengths[row]);
+}
+
+/**
+ * @brief Заполняет таблицу поиска по пути с линейным пробированием.
+ *
+ * Таблица заполнена не больше чем наполовину, поэтому цепочки пробирования короткие. Если путь
+ * встречается в оглавлении несколько раз, находится его строка, загруженная последней.
+ */
+void TocModel::buildPathIndex()
+{
+    int capacity = 16;
+    while (capacity < pathOffsets.size() * 2)
+    {
+        capacity *= 2;
+    }
+    pathSlots.fill(0, capacity);
+
+    for (int row = 0; row < pathOffsets.size(); ++row)
+    {
+        indexPath(row);
+    }
+}
+
+/**
+ * @brief Добавляет строку в таблицу поиска по пути. Таблица должна быть заполнена меньше чем наполовину.
+ */
+void TocModel::indexPath(int row)
+{
+    const QStringView path = pathView(row);
+    const uint mask = uint(pathSlots.size() - 1);
+    uint slot = uint(qHash(path)) & mask;
+    while (pathSlots[slot] && pathView(pathSlots[slot] - 1) != path)
+    {
+        slot = (slot + 1) & mask;
+    }
+    pathSlots[slot] = row + 1;
+}
+
+/**
+ * @brief Ищет загруженную строку по пути: в таблице поиска для оглавления из JSON или двоичным поиском по таблице.
+ */
+int TocModel::findRow(QStringView filePath) const
+{
+    if (!table)
+    {
+        if (pathSlots.isEmpty())
+        {
+            return -1;
+        }
+
+        const uint mask = uint(pathSlots.size() - 1);
+        for (uint slot = uint(qHash(filePath)) & mask; pathSlots[slot]; slot = (slot + 1) & mask)
+        {
+            const int row = pathSlots[slot] - 1;
+            if (pathView(row) == filePath)
+            {
+                return row;
+            }
+        }
+        return -1;
+    }
+
+    int low = 0;
+    int high = tableCount;
+    while (low < high)
+    {
+        const int middle = low + (high - low) / 2;
+        const TocEntry& entry = table[tablePathOrder[middle]];
+        const int order = QStringView(entry.filePath, entry.filePathLength).compare(filePath);
+        if (order == 0)
+        {
+            return tablePathOrder[middle];
+        }
+        if (order < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return -1;
+}
+
+int TocModel::rowOfFilePath(const QString &filePath)
+{
+    return rowsOfFilePaths(QStringList{filePath}).value(0, -1);
+}
+
+/**
+ * @brief Ищет строки страниц; страницы из нераскрытых глав загружаются вместе с уровнями их предков.
+ *
+ * Незагруженные разделы просматриваются одним проходом для всех ненайденных путей. Пути, которых
+ * нет и там, запоминаются до следующей загрузки оглавления, и повторный поиск их не просматривает.
+ */
+QVector<int> TocModel::rowsOfFilePaths(const QStringList &filePaths)
+{
+    QVector<int> rows(filePaths.size(), -1);
+    QSet<QString> wanted;
+    for (int i = 0; i < filePaths.size(); ++i)
+    {
+        rows[i] = findRow(filePaths[i]);
+        if (rows[i] < 0 && pendingCount > 0 && !absentPaths.contains(filePaths[i]))
+        {
+            wanted.insert(filePaths[i]);
+        }
+    }
+    if (wanted.isEmpty())
+    {
+        return rows;
+    }
+
+    // Сначала находятся пути к страницам, а уровни загружаются потом: загрузка дописывает строки,
+    // по которым идет проход.
+    QVector<PathMatch> found;
+    QVector<int> chain;
+    for (int row = 0; row < pendingChildren.size() && !wanted.isEmpty(); ++row)
+    {
+        if (firstChildren[row] < 0 && !pendingChildren[row].isEmpty())
+        {
+            findPendingPaths(row, pendingChildren[row], chain, wanted, found);
+        }
+    }
+    absentPaths.unite(wanted);
+
+    for (const PathMatch& match : std::as_const(found))
+    {
+        int row = match.row;
+        for (const int position : match.chain)
+        {
+            fetchChildren(row);
+            row = firstChildren[row] + position;
+        }
+    }
+
+    for (int i = 0; i < filePaths.size(); ++i)
+    {
+        if (rows[i] < 0)
+        {
+            rows[i] = findRow(filePaths[i]);
+        }
+    }
+    return rows;
+}
+
+/**
+ * @brief Ищет пути из wanted среди незагруженных разделов строки.
+ *
+ * Найденный путь удаляется из wanted, а в found записывается, как дойти до страницы от строки.
+ * @param row Загруженная строка с незагруженными разделами.
+ * @param entries Разделы одного уровня.
+ * @param chain Номера разделов от строки до этого уровня.
+ */
+void TocModel::findPendingPaths(int row, const QJsonArray &entries, QVector<int> &chain, QSet<QString> &wanted,
+                                QVector<PathMatch> &found) const
+{
+    for (int i = 0; i < entries.size() && !wanted.isEmpty(); ++i)
+    {
+        const QJsonObject obj = entries[i].toObject();
+        chain.append(i);
+
+        if (wanted.remove(obj["filePath"].toString()))
+        {
+            found.append({row, chain});
+        }
+
+        const QJsonArray children = obj["children"].toArray();
+        if (!children.isEmpty())
+        {
+            findPendingPaths(row, children, chain, wanted, found);
+        }
+        chain.removeLast();
+    }
+}
+
+void TocModel::forEachPage(const PageVisitor &visitor) const
+{
+    if (table)
+    {
+        for (int row = 0; row < tableCount; ++row)
+        {
+            visitor(title(row), filePath(row), table[row].hash);
+        }
+        return;
+    }
+
+    for (int row = 0; row < topLevelCount; ++row)
+    {
+        visitRow(row, visitor);
+    }
+}
+
+void TocModel::visitRow(int row, const PageVisitor &visitor) const
+{
+    visitor(title(row), filePath(row), hashes[row]);
+
+    if (firstChildren[row] < 0)
+    {
+        visitPending(pendingChildren[row], visitor);
+        return;
+    }
+    for (int child = firstChildren[row]; child >= 0; child = nextSiblingRow(child))
+    {
+        visitRow(child, visitor);
+    }
+}
+
+void TocModel::visitPending(const QJsonArray &entries, const PageVisitor &visitor) const
+{
+    for (const QJsonValue& value : entries)
+    {
+        const QJsonObject obj = value.toObject();
+        visitor(obj["title"].toString(), obj["filePath"].toString(),
+                obj["hash"].toString().toULongLong(nullptr, 16));
+        visitPending(obj["children"].toArray(), visitor);
+    }
+}
+
+QString TocModel::title(int row) const
+{
+    if (table)
+    {
+        if (row < 0 || row >= tableCount)
+        {
+            return QString();
+        }
+        return QString::fromRawData(reinterpret_cast<const QChar*>(table[row].title), table[row].titleLength);
+    }
+
+    if (row < 0 || row >= titleOffsets.size())
+    {
+        return QString();
+    }
+    return buffer.mid(titleOffsets[row], titleLengths[row]);
+}
+
+QString TocModel::filePath(int row) const
+{
+    if (table)
+    {
+        if (row < 0 || row >= tableCount)
+        {
+            return QString();
+        }
+        return QString::fromRawData(reinterpret_cast<const QChar*>(table[row].filePath),
+                                    table[row].filePathLength);
+    }
+
+    if (row < 0 || row >= pathOffsets.size())
+    {
+        return QString();
+    }
+    return buffer.mid(pathOffsets[row], pathLengths[row]);
+}
+
+quint64 TocModel::contentHash(int row) const
+{
+    if (table)
+    {
+        return (row >= 0 && row < tableCount) ? table[row].hash : 0;
+    }
+    return (row >= 0 && row < hashes.size()) ? hashes[row] : 0;
+}
+
+void TocModel::setContentHash(int row, quint64 hash)
+{
+    if (!table && row >= 0 && row < hashes.size() && hashes[row] != hash)
+    {
+        hashes[row] = hash;
+        emit dataChanged(index(row), index(row), {ContentHashRole});
+    }
+}
+
+/**
+ * @brief Подставляет хеши загруженным строкам без хеша и сообщает об изменении одним сигналом.
+ */
+void TocModel::fillContentHashes(const QHash<QString, quint64> &known)
+{
+    if (table || known.isEmpty())
+    {
+        return;
+    }
+
+    int first = -1;
+    int last = -1;
+    for (int row = 0; row < hashes.size(); ++row)
+    {
+        if (hashes[row] == 0)
+        {
+            hashes[row] = known.value(filePath(row));
+            if (hashes[row] != 0)
+            {
+                first = first < 0 ? row : first;
+                last = row;
+            }
+        }
+    }
+    if (first >= 0)
+    {
+        emit dataChanged(index(first), index(last), {ContentHashRole});
+    }
+}
+
+int TocModel::parentRow(int row) const
+{
+    if (table)
+    {
+        return (row >= 0 && row < tableCount) ? table[row].parent : -1;
+    }
+    return (row >= 0 && row < parents.size()) ? parents[row] : -1;
+}
+
+bool TocModel::hasChildRows(int row) const
+{
+    if (row < 0 || row >= rowCount())
+    {
+        return false;
+    }
+    return table ? table[row].subtreeEnd > row + 1 : childCounts[row] > 0;
+}
+
+bool TocModel::canFetchChildren(int row) const
+{
+    if (!hasChildRows(row))
+    {
+        return false;
+    }
+    return table ? !tableLoaded.testBit(row) : firstChildren[row] < 0;
+}
+
+void TocModel::fetchChildren(int row)
+{
+    if (!canFetchChildren(row))
+    {
+        return;
+    }
+
+    if (table)
+    {
+        // Строки таблицы уже есть; раскрытие уровня только отмечается, начиная с уровней предков.
+        fetchChildren(table[row].parent);
+        emit childRowsAboutToBeLoaded(row, childRowCount(row));
+        tableLoaded.setBit(row);
+        emit childRowsLoaded(row);
+        return;
+    }
+
+    const QJsonArray entries = pendingChildren[row];
+    const int first = titleOffsets.size();
+    emit childRowsAboutToBeLoaded(row, entries.size());
+    beginInsertRows(QModelIndex(), first, first + entries.size() - 1);
+
+    pendingChildren[row] = QJsonArray();
+    firstChildren[row] = first;
+    --pendingCount;
+    appendRows(entries, row);
+    if (titleOffsets.size() * 2 > pathSlots.size())
+    {
+        buildPathIndex();
+    }
+    else
+    {
+        for (int child = first; child < titleOffsets.size(); ++child)
+        {
+            indexPath(child);
+        }
+    }
+
+    endInsertRows();
+    emit childRowsLoaded(row);
+}
+
+/**
+ * @brief Возвращает количество прямых разделов записи.
+ */
+int TocModel::childRowCount(int row) const
+{
+    if (!table)
+    {
+        return row < 0 ? topLevelCount : childCounts[row];
+    }
+
+    const int end = row < 0 ? tableCount : table[row].subtreeEnd;
+    int count = 0;
+    for (int child = row + 1; child < end; child = table[child].subtreeEnd)
+    {
+        ++count;
+    }
+    return count;
+}
+
+int TocModel::firstChildRow(int row) const
+{
+    if (row < 0)
+    {
+        return rowCount() > 0 ? 0 : -1;
+    }
+    if (!hasChildRows(row))
+    {
+        return -1;
+    }
+    if (table)
+    {
+        return tableLoaded.testBit(row) ? row + 1 : -1;
+    }
+    return firstChildren[row];
+}
+
+/**
+ * @brief Разделы записи из JSON лежат подряд, поэтому следующая запись уровня — следующая строка в его блоке.
+ */
+int TocModel::nextSiblingRow(int row) const
+{
+    if (row < 0 || row >= rowCount())
+    {
+        return -1;
+    }
+
+    const int parent = parentRow(row);
+    if (table)
+    {
+        const int end = parent < 0 ? tableCount : table[parent].subtreeEnd;
+        const int next = table[row].subtreeEnd;
+        return next < end ? next : -1;
+    }
+
+    const int first = parent < 0 ? 0 : firstChildren[parent];
+    const int count = parent < 0 ? topLevelCount : childCounts[parent];
+    return row + 1 < first + count ? row + 1 : -1;
+}
+
+/**
+ * @brief Следующая запись в порядке чтения: первый раздел, иначе следующая запись уровня этой записи
+ * или ближайшего предка.
+ */
+int TocModel::nextRow(int row)
+{
+    if (row < 0)
+    {
+        return firstChildRow(-1);
+    }
+    if (table)
+    {
+        return row + 1 < tableCount ? row + 1 : -1;
+    }
+    if (row >= titleOffsets.size())
+    {
+        return -1;
+    }
+
+    if (childCounts[row] > 0)
+    {
+        fetchChildren(row);
+        return firstChildren[row];
+    }
+    for (int ancestor = row; ancestor >= 0; ancestor = parents[ancestor])
+    {
+        const int next = nextSiblingRow(ancestor);
+        if (next >= 0)
+        {
+            return next;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Предыдущая запись в порядке чтения: последний раздел на самой глубине у предыдущей записи
+ * уровня, а для первой записи уровня — ее родитель.
+ */
+int TocModel::previousRow(int row)
+{
+    if (row <= 0 || row >= rowCount())
+    {
+        return -1;
+    }
+    if (table)
+    {
+        return row - 1;
+    }
+
+    const int parent = parents[row];
+    if (row == (parent < 0 ? 0 : firstChildren[parent]))
+    {
+        return parent;
+    }
+
+    int previous = row - 1;
+    while (childCounts[previous] > 0)
+    {
+        fetchChildren(previous);
+        previous = firstChildren[previous] + childCounts[previous] - 1;
+    }
+    return previous;
+}
+
+bool TocModel::hasNextRow(int row) const
+{
+    if (row < 0)
+    {
+        return rowCount() > 0;
+    }
+    if (table)
+    {
+        return row + 1 < tableCount;
+    }
+    if (row >= titleOffsets.size())
+    {
+        return false;
+    }
+
+    if (childCounts[row] > 0)
+    {
+        return true;
+    }
+    for (int ancestor = row; ancestor >= 0; ancestor = parents[ancestor])
+    {
+        if (nextSiblingRow(ancestor) >= 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+TocTreeModel::TocTreeModel(TocModel *toc, QObject *parent)
+    : QAbstractItemModel(parent)
+    , toc(toc)
+{
+    // Оглавление загружается заново целиком, поэтому и дерево сбрасывается целиком.
+    connect(toc, &QAbstractItemModel::modelAboutToBeReset, this, [this]() { beginResetModel(); });
+    connect(toc, &QAbstractItemModel::modelReset, this, [this]() {
+        children.clear();
+        buildLevel(-1);
+        endResetModel();
+    });
+
+    // Уровень появляется в дереве, кто бы его ни загрузил: раскрытие узла, переход по порядку чтения
+    // или поиск страницы по пути.
+    connect(toc, &TocModel::childRowsAboutToBeLoaded, this, [this](int row, int count) {
+        beginInsertRows(nodeIndex(row), 0, count - 1);
+    });
+    connect(toc, &TocModel::childRowsLoaded, this, [this](int row) {
+        buildLevel(row);
+        endInsertRows();
+    });
+
+    connect(toc, &QAbstractItemModel::dataChanged, this,
+            [this](const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles) {
+        if (topLeft.row() == bottomRight.row())
+        {
+            const QModelIndex changed = nodeIndex(topLeft.row());
+            if (changed.isValid())
+            {
+                emit dataChanged(changed, changed, roles);
+            }
+            return;
+        }
+
+        // Строки диапазона разбросаны по уровням дерева: о каждом уровне сообщается одним диапазоном.
+        for (auto level = children.cbegin(); level != children.cend(); ++level)
+        {
+            const auto first = std::lower_bound(level->cbegin(), level->cend(), topLeft.row());
+            const auto last = std::upper_bound(first, level->cend(), bottomRight.row());
+            if (first != last)
+            {
+                emit dataChanged(createIndex(int(first - level->cbegin()), 0, quintptr(*first)),
+                                 createIndex(int(last - level->cbegin()) - 1, 0, quintptr(*(last - 1))), roles);
+            }
+        }
+    });
+
+    buildLevel(-1);
+}
+
+QModelIndex TocTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (column != 0 || row < 0)
+    {
+        return QModelIndex();
+    }
+
+    const auto level = children.constFind(tocRow(parent));
+    if (level == children.constEnd() || row >= level->size())
+    {
+        return QModelIndex();
+    }
+    return createIndex(row, column, quintptr(level->at(row)));
+}
+
+QModelIndex TocTreeModel::parent(const QModelIndex &child) const
+{
+    return nodeIndex(toc->parentRow(tocRow(child)));
+}
+
+int TocTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0)
+    {
+        return 0;
+    }
+    const auto level = children.constFind(tocRow(parent));
+    return level == children.constEnd() ? 0 : level->size();
+}
+
+int TocTreeModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+bool TocTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+    {
+        return toc->rowCount() > 0;
+    }
+    return toc->hasChildRows(tocRow(parent));
+}
+
+QVariant TocTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+    {
+        return QVariant();
+    }
+    return toc->data(toc->index(tocRow(index)), role);
+}
+
+bool TocTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    return parent.isValid() && toc->canFetchChildren(tocRow(parent));
+}
+
+void TocTreeModel::fetchMore(const QModelIndex &parent)
+{
+    // Строки вставляются в ответ на сигналы TocModel о загрузке уровня.
+    if (parent.isValid())
+    {
+        toc->fetchChildren(tocRow(parent));
+    }
+}
+
+int TocTreeModel::tocRow(const QModelIndex &index)
+{
+    return index.isValid() ? int(index.internalId()) : -1;
+}
+
+QModelIndex TocTreeModel::indexOfRow(int tocRow)
+{
+    if (tocRow < 0 || tocRow >= toc->rowCount())
+    {
+        return QModelIndex();
+    }
+
+    // Загруженная строка JSON уже лежит в загруженном уровне; в статической таблице уровни предков
+    // раскрываются здесь сверху вниз.
+    toc->fetchChildren(toc->parentRow(tocRow));
+    return nodeIndex(tocRow);
+}
+
+int TocTreeModel::materializedCount() const
+{
+    int count = 0;
+    for (const QVector<int>& level : children)
+    {
+        count += level.size();
+    }
+    return count;
+}
+
+/**
+ * @brief Создает уровень дерева из загруженных разделов записи.
+ * @param parentRow Строка родителя или -1 для верхнего уровня.
+ */
+void TocTreeModel::buildLevel(int parentRow)
+{
+    QVector<int>& level = children[parentRow];
+    level.clear();
+    for (int row = toc->firstChildRow(parentRow); row >= 0; row = toc->nextSiblingRow(row))
+    {
+        level.append(row);
+    }
+}
+
+/**
+ * @brief Возвращает номер строки среди разделов ее родителя.
+ *
+ * Строки уровня идут по возрастанию (в JSON разделы загружаются одним блоком, в таблице лежат
+ * в порядке обхода в глубину), поэтому ищутся двоичным поиском.
+ */
+int TocTreeModel::positionOf(int tocRow) const
+{
+    const auto level = children.constFind(toc->parentRow(tocRow));
+    if (level == children.constEnd())
+    {
+        return -1;
+    }
+    const auto it = std::lower_bound(level->cbegin(), level->cend(), tocRow);
+    return (it != level->cend() && *it == tocRow) ? int(it - level->cbegin()) : -1;
+}
+
+/**
+ * @brief Возвращает узел строки TocModel, если ее уровень создан, иначе пустой индекс.
+ */
+QModelIndex TocTreeModel::nodeIndex(int tocRow) const
+{
+    const int position = tocRow >= 0 ? positionOf(tocRow) : -1;
+    return position >= 0 ? createIndex(position, 0, quintptr(tocRow)) : QModelIndex();
+}
+
+BookmarkFilterModel::BookmarkFilterModel(QObject *parent)
+    : QAbstractProxyModel(parent)
+{
+}
+
+void BookmarkFilterModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    beginResetModel();
+
+    if (this->sourceModel())
+    {
+        disconnect(this->sourceModel(), nullptr, this, nullptr);
+    }
+
+    QAbstractProxyModel::setSourceModel(sourceModel);
+
+    if (sourceModel)
+    {
+        connect(sourceModel, &QAbstractItemModel::modelAboutToBeReset, this, [this]() { beginResetModel(); });
+        connect(sourceModel, &QAbstractItemModel::modelReset, this, [this]() {
+            rebuildProxyRows();
+            endResetModel();
+        });
+        // Оглавление только дописывает загруженные разделы в конец, и номера прежних строк не меняются.
+        connect(sourceModel, &QAbstractItemModel::rowsAboutToBeInserted, this,
+                [this](const QModelIndex&, int first, int last) {
+            if (!bookmarksOnly)
+            {
+                beginInsertRows(QModelIndex(), first, last);
+            }
+        });
+        connect(sourceModel, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) {
+            proxyRows.insert(first, last - first + 1, -1);
+            if (!bookmarksOnly)
+            {
+                endInsertRows();
+            }
+        });
+        connect(sourceModel, &QAbstractItemModel::dataChanged, this,
+                [this](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+            if (!bookmarksOnly)
+            {
+                emit dataChanged(mapFromSource(topLeft), mapFromSource(bottomRight));
+                return;
+            }
+
+            // Изменившиеся строки оглавления разбросаны среди закладок; обычно меняется одна строка.
+            for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+            {
+                const QModelIndex changed = mapFromSource(topLeft.sibling(row, 0));
+                if (changed.isValid())
+                {
+                    emit dataChanged(changed, changed);
+                }
+            }
+        });
+    }
+
+    rebuildProxyRows();
+    endResetModel();
+}
+
+QModelIndex BookmarkFilterModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || column != 0 || row < 0 || row >= rowCount())
+    {
+        return QModelIndex();
+    }
+    return createIndex(row, column);
+}
+
+QModelIndex BookmarkFilterModel::parent(const QModelIndex &) const
+{
+    return QModelIndex();
+}
+
+int BookmarkFilterModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !sourceModel())
+    {
+        return 0;
+    }
+    return bookmarksOnly ? bookmarkRows.size() : sourceModel()->rowCount();
+}
+
+int BookmarkFilterModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 1;
+}
+
+QModelIndex BookmarkFilterModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!proxyIndex.isValid() || !sourceModel())
+    {
+        return QModelIndex();
+    }
+
+    const int sourceRow = bookmarksOnly ? bookmarkRows.value(proxyIndex.row(), -1) : proxyIndex.row();
+    return sourceModel()->index(sourceRow, proxyIndex.column());
+}
+
+QModelIndex BookmarkFilterModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid())
+    {
+        return QModelIndex();
+    }
+
+    const int row = bookmarksOnly ? proxyRows.value(sourceIndex.row(), -1) : sourceIndex.row();
+    return index(row, sourceIndex.column());
+}
+
+void BookmarkFilterModel::setShowBookmarksOnly(bool bookmarksOnly)
+{
+    if (this->bookmarksOnly == bookmarksOnly)
+    {
+        return;
+    }
+
+    beginResetModel();
+    this->bookmarksOnly = bookmarksOnly;
+    endResetModel();
+}
+
+void BookmarkFilterModel::setBookmarkRows(const QVector<int> &rows)
+{
+    if (bookmarksOnly)
+    {
+        beginResetModel();
+    }
+
+    bookmarkRows = rows;
+    rebuildProxyRows();
+
+    if (bookmarksOnly)
+    {
+        endResetModel();
+    }
+}
+
+void BookmarkFilterModel::appendBookmarkRow(int sourceRow)
+{
+    if (sourceRow < 0 || sourceRow >= proxyRows.size())
+    {
+        return;
+    }
+
+    if (bookmarksOnly)
+    {
+        beginInsertRows(QModelIndex(), bookmarkRows.size(), bookmarkRows.size());
+    }
+
+    bookmarkRows.append(sourceRow);
+    proxyRows[sourceRow] = bookmarkRows.size() - 1;
+
+    if (bookmarksOnly)
+    {
+        endInsertRows();
+    }
+}
+
+void BookmarkFilterModel::removeBookmarkRow(int sourceRow)
+{
+    const int row = proxyRows.value(sourceRow, -1);
+    if (row < 0)
+    {
+        return;
+    }
+
+    if (bookmarksOnly)
+    {
+        beginRemoveRows(QModelIndex(), row, row);
+    }
+
+    bookmarkRows.removeAt(row);
+    proxyRows[sourceRow] = -1;
+    rebuildProxyRows(row);
+
+    if (bookmarksOnly)
+    {
+        endRemoveRows();
+    }
+}
+
+/**
+ * @brief Пересчитывает номера закладок для строк исходной модели.
+ * @param from Первая закладка, номер которой мог измениться; с 0 таблица строится заново.
+ */
+void BookmarkFilterModel::rebuildProxyRows(int from)
+{
+    if (from == 0)
+    {
+        proxyRows.fill(-1, sourceModel() ? sourceModel()->rowCount() : 0);
+    }
+
+    for (int row = from; row < bookmarkRows.size(); ++row)
+    {
+        const int sourceRow = bookmarkRows[row];
+        if (sourceRow >= 0 && sourceRow < proxyRows.size())
+        {
+            proxyRows[sourceRow] = row;
+        }
+    }
+}
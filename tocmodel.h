@@ -0,0 +1,348 @@
+#ifndef TOCMODEL_H
+#define TOCMODEL_H
+
+/**
+ * @file tocmodel.h
+ * @brief Определение моделей оглавления справочника: TocModel и BookmarkFilterModel.
+ *
+ * TocModel хранит оглавление из data.json в виде "структуры массивов": названия и пути загруженных страниц
+ * лежат в одном буфере UTF-16, а модель держит только смещения и длины. Строка по пути ищется
+ * в таблице с открытой адресацией, ячейки которой — номера строк, а ключи читаются из того же буфера.
+ * Это позволяет показывать каталоги на сотни тысяч страниц без отдельного объекта на каждую строку.
+ *
+ * Оглавление, собранное в программу, берется из таблицы TocEntry, которую при сборке генерирует
+ * handbook_tocgen из data.json (toc_generated.h). Такая таблица не разбирается и не копируется:
+ * модель читает строки прямо из статических литералов.
+ *
+ * Оглавление может быть вложенным (главы, разделы, подразделы — см. tocjson.h). При загрузке из JSON
+ * разбирается только верхний уровень, а у каждой строки остается неразобранный массив ее разделов.
+ * Разделы записи становятся строками (дописываются в конец модели одним блоком), когда их раскрывает
+ * дерево, когда через них проходят кнопки "Следующая" и "Предыдущая" или когда нужна строка страницы
+ * внутри нераскрытой главы. Поэтому номера строк — порядок загрузки, а не порядок чтения; порядок
+ * чтения (обход в глубину) дают nextRow() и previousRow().
+ *
+ * В статической таблице все записи уже лежат в порядке обхода в глубину с номером родителя и концом
+ * поддерева, и модель только отмечает, какие уровни раскрыты.
+ *
+ * BookmarkFilterModel — прокси-модель над строками оглавления. В режиме закладок она показывает
+ * только строки из списка номеров, поэтому переключение на закладки и их изменение не требуют
+ * пересоздания списка. Обратное отображение (строка оглавления -> строка закладок) хранится
+ * массивом, и mapFromSource() не ищет строку в списке.
+ */
+
+#include <QAbstractListModel>
+#include <QAbstractProxyModel>
+#include <QBitArray>
+#include <QHash>
+#include <QJsonArray>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+#include <functional>
+
+/**
+ * @struct TocEntry
+ * @brief Запись оглавления в сгенерированной при сборке таблице.
+ */
+struct TocEntry
+{
+    const char16_t* title;
+    int titleLength;
+    const char16_t* filePath;
+    int filePathLength;
+    quint64 hash;           ///< Хеш содержимого страницы, вычисленный при сборке.
+    int parent;             ///< Номер родительской записи или -1.
+    int subtreeEnd;         ///< Номер первой записи после вложенных разделов.
+};
+
+/**
+ * @class TocModel
+ * @brief Модель оглавления справочника: загруженные записи списком.
+ */
+class TocModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    /// Дополнительные роли данных модели.
+    enum Roles
+    {
+        FilePathRole = Qt::UserRole,        ///< Путь к HTML файлу страницы.
+        ContentHashRole = Qt::UserRole + 1  ///< Хеш содержимого страницы из data.json (или 0).
+    };
+
+    explicit TocModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    /**
+     * @brief Заполняет модель из массива JSON.
+     *
+     * Каждый элемент массива содержит значения "title", "filePath", необязательное "hash"
+     * и необязательный массив вложенных разделов "children". Строками становятся только записи
+     * верхнего уровня; разделы разбираются в fetchChildren().
+     * @param entries Массив записей data.json.
+     */
+    void loadFromJson(const QJsonArray& entries);
+
+    /**
+     * @brief Заполняет модель из статической таблицы без копирования строк.
+     * @param entries Записи оглавления в порядке обхода в глубину; должны жить дольше модели.
+     * @param pathOrder Номера записей, упорядоченные по пути, для поиска строки по пути.
+     * @param count Количество записей.
+     */
+    void loadFromTable(const TocEntry* entries, const int* pathOrder, int count);
+
+    QString title(int row) const;
+    QString filePath(int row) const;
+    quint64 contentHash(int row) const;
+
+    /**
+     * @brief Запоминает новый хеш содержимого страницы, например после ее правки в режиме разработки.
+     *
+     * Оглавление из статической таблицы не меняется.
+     */
+    void setContentHash(int row, quint64 hash);
+
+    /**
+     * @brief Запоминает хеши содержимого загруженных страниц, у которых хеша еще нет.
+     * @param known Хеши по путям, например из поискового индекса.
+     */
+    void fillContentHashes(const QHash<QString, quint64>& known);
+
+    /**
+     * @brief Возвращает строку родительской записи или -1 для записи верхнего уровня.
+     */
+    int parentRow(int row) const;
+
+    /**
+     * @brief Есть ли у записи вложенные разделы, загруженные или нет.
+     */
+    bool hasChildRows(int row) const;
+
+    /**
+     * @brief Есть ли у записи разделы, которые еще не загружены.
+     */
+    bool canFetchChildren(int row) const;
+
+    /**
+     * @brief Загружает прямые разделы записи (и, для статической таблицы, уровни ее предков).
+     *
+     * Вокруг загрузки испускаются childRowsAboutToBeLoaded() и childRowsLoaded().
+     */
+    void fetchChildren(int row);
+
+    /**
+     * @brief Возвращает строку первого раздела записи или -1, если разделов нет или они не загружены.
+     * @param row Строка записи или -1 для верхнего уровня.
+     */
+    int firstChildRow(int row) const;
+
+    /**
+     * @brief Возвращает строку следующей записи того же уровня или -1.
+     */
+    int nextSiblingRow(int row) const;
+
+    /**
+     * @brief Возвращает строку, следующую за row в порядке чтения, загружая разделы row при необходимости.
+     * @param row Строка или -1, чтобы получить первую строку.
+     * @return Номер строки или -1 после последней записи.
+     */
+    int nextRow(int row);
+
+    /**
+     * @brief Возвращает строку, предшествующую row в порядке чтения, загружая разделы при необходимости.
+     * @return Номер строки или -1 для первой записи.
+     */
+    int previousRow(int row);
+
+    /**
+     * @brief Есть ли запись после row в порядке чтения. Ничего не загружает.
+     */
+    bool hasNextRow(int row) const;
+
+    /**
+     * @brief Возвращает строку страницы по её пути.
+     *
+     * Если страница лежит в нераскрытой главе, загружаются разделы ее предков.
+     * @param filePath Путь к странице.
+     * @return Номер строки или -1.
+     */
+    int rowOfFilePath(const QString& filePath);
+
+    /**
+     * @brief Возвращает строки нескольких страниц за один проход по незагруженным разделам.
+     * @return Номера строк в порядке путей; -1 для страниц, которых нет в оглавлении.
+     */
+    QVector<int> rowsOfFilePaths(const QStringList& filePaths);
+
+    /// Обработчик записи оглавления: название, путь и хеш содержимого (0, если неизвестен).
+    using PageVisitor = std::function<void(const QString& title, const QString& filePath, quint64 hash)>;
+
+    /**
+     * @brief Обходит все записи оглавления в порядке чтения, не загружая их в модель.
+     *
+     * Нужен поисковому индексу, быстрому переходу и наблюдению за файлами, которым нужны все страницы.
+     * Незагруженные разделы читаются прямо из JSON.
+     */
+    void forEachPage(const PageVisitor& visitor) const;
+
+signals:
+    /**
+     * @brief Сигнал перед загрузкой разделов записи.
+     * @param row Строка записи.
+     * @param count Количество ее прямых разделов.
+     */
+    void childRowsAboutToBeLoaded(int row, int count);
+
+    /**
+     * @brief Сигнал после загрузки разделов записи: firstChildRow() уже возвращает первый из них.
+     */
+    void childRowsLoaded(int row);
+
+private:
+    struct PathMatch;
+
+    QStringView pathView(int row) const;
+    void buildPathIndex();
+    void indexPath(int row);
+    int findRow(QStringView filePath) const;
+    int childRowCount(int row) const;
+    void appendRows(const QJsonArray& entries, int parent);
+    void findPendingPaths(int row, const QJsonArray& entries, QVector<int>& chain, QSet<QString>& wanted,
+                          QVector<PathMatch>& found) const;
+    void visitPending(const QJsonArray& entries, const PageVisitor& visitor) const;
+    void visitRow(int row, const PageVisitor& visitor) const;
+
+    const TocEntry* table = nullptr;        ///< Статическая таблица, если модель заполнена из нее.
+    const int* tablePathOrder = nullptr;
+    int tableCount = 0;
+    QBitArray tableLoaded;                  ///< Записи таблицы, уровни разделов которых раскрыты.
+
+    QString buffer;              ///< Названия и пути загруженных страниц подряд.
+    QVector<int> titleOffsets;
+    QVector<int> titleLengths;
+    QVector<int> pathOffsets;
+    QVector<int> pathLengths;
+    QVector<quint64> hashes;
+    QVector<int> parents;
+    QVector<int> childCounts;        ///< Количество прямых разделов записи.
+    QVector<int> firstChildren;      ///< Строка первого раздела или -1, пока разделы не загружены.
+    QVector<QJsonArray> pendingChildren; ///< Неразобранные разделы записи; пусто после загрузки.
+    int topLevelCount = 0;
+    int pendingCount = 0;            ///< Количество строк с незагруженными разделами.
+    QVector<int> pathSlots;          ///< Таблица поиска по пути: номер строки + 1 или 0 для пустой ячейки.
+    QSet<QString> absentPaths;       ///< Пути, которых нет и в незагруженных разделах.
+};
+
+/**
+ * @class TocTreeModel
+ * @brief Дерево оглавления над TocModel с ленивым созданием уровней.
+ *
+ * При загрузке создается только верхний уровень. Вложенные разделы записи появляются через
+ * canFetchMore()/fetchMore(), когда QTreeView раскрывает ее, или когда TocModel загружает их
+ * сама (переходы по порядку чтения, поиск страницы по пути). Узел дерева — это номер строки
+ * TocModel, а у каждого раскрытого уровня хранится только список номеров его строк.
+ * Изменения данных строк TocModel передаются соответствующим узлам.
+ */
+class TocTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit TocTreeModel(TocModel* toc, QObject* parent = nullptr);
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+    /**
+     * @brief Возвращает строку TocModel, которую показывает узел, или -1.
+     */
+    static int tocRow(const QModelIndex& index);
+
+    /**
+     * @brief Возвращает узел строки TocModel, раскрывая в модели уровни ее предков.
+     * @param tocRow Строка TocModel.
+     */
+    QModelIndex indexOfRow(int tocRow);
+
+    /**
+     * @brief Возвращает количество созданных узлов (для диагностики и замеров).
+     */
+    int materializedCount() const;
+
+private:
+    void buildLevel(int parentRow);
+    int positionOf(int tocRow) const;
+    QModelIndex nodeIndex(int tocRow) const;
+
+    TocModel* toc;
+    QHash<int, QVector<int>> children; ///< Строки TocModel раскрытых уровней; ключ -1 — верхний уровень.
+};
+
+/**
+ * @class BookmarkFilterModel
+ * @brief Прокси-модель, показывающая либо все страницы, либо только закладки.
+ *
+ * Строки закладок хранятся как номера строк исходной модели в порядке добавления, а для каждой
+ * строки исходной модели — ее номер среди закладок или -1. Добавление и удаление закладки
+ * сообщают представлению об одной строке.
+ */
+class BookmarkFilterModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit BookmarkFilterModel(QObject* parent = nullptr);
+
+    void setSourceModel(QAbstractItemModel* sourceModel) override;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex& proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex& sourceIndex) const override;
+
+    /**
+     * @brief Включает или выключает режим закладок.
+     * @param bookmarksOnly true — показывать только закладки.
+     */
+    void setShowBookmarksOnly(bool bookmarksOnly);
+    bool showBookmarksOnly() const { return bookmarksOnly; }
+
+    /**
+     * @brief Задает строки исходной модели, находящиеся в закладках.
+     * @param rows Номера строк в порядке добавления закладок.
+     */
+    void setBookmarkRows(const QVector<int>& rows);
+
+    /**
+     * @brief Добавляет строку исходной модели в конец списка закладок.
+     */
+    void appendBookmarkRow(int sourceRow);
+
+    /**
+     * @brief Удаляет строку исходной модели из списка закладок.
+     */
+    void removeBookmarkRow(int sourceRow);
+
+private:
+    void rebuildProxyRows(int from = 0);
+
+    QVector<int> bookmarkRows;   ///< Строки исходной модели в порядке добавления закладок.
+    QVector<int> proxyRows;      ///< Номер среди закладок для каждой строки исходной модели или -1.
+    bool bookmarksOnly = false;
+};
+
+#endif // TOCMODEL_H
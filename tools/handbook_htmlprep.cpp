@@ -0,0 +1,819 @@
+/**
+ * @file handbook_htmlprep.cpp
+ * @brief Предварительная обработка страниц справочника при сборке.
+ *
+ * Использование:
+ *     handbook_htmlprep --data data.json --root <каталог исходников> --out <каталог результата>
+ *                       [--css общие_стили.css] [--strict]
+ *
+ * Для каждой страницы из data.json (страницы обрабатываются параллельно):
+ * - удаляются комментарии, лишние пробелы вне <pre> и элементов со стилем white-space: pre*, и элементы, которые QTextBrowser не показывает
+ *   (script, iframe, svg, meta, link и т.п.);
+ * - блоки HTML5 (section, article, nav...) заменяются на div, атрибуты вне поддерживаемого Qt
+ *   подмножества удаляются;
+ * - в <style> остаются только правила, селекторы которых встречаются на странице, и только свойства CSS,
+ *   которые понимает движок QTextDocument; правила из --css добавляются к странице так же;
+ * - проверяются ссылки на якоря и другие страницы и пути к изображениям.
+ *
+ * Результат записывается в <out>/texts/... вместе с texts.qrc, а отчет о размере и времени разбора
+ * страниц до и после обработки — в <out>/htmlprep_report.csv. С параметром --strict неверные ссылки
+ * считаются ошибкой сборки.
+ */
+
+#include "../contentpack.h"
+#include "../pagereferences.h"
+#include "../tocjson.h"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <QTextDocument>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+namespace {
+
+/// Страница до и после обработки и найденные в ней ссылки.
+struct Page
+{
+    QString filePath;       ///< Путь из data.json.
+    QString entryName;      ///< Путь относительно корня ("texts/1.welcome.html").
+    QString source;
+    QString result;
+    QStringList anchors;    ///< Значения атрибутов name и id.
+    QStringList links;      ///< Значения href.
+    QStringList images;     ///< Значения src у img.
+    bool readOk = false;
+};
+
+/// Элементы, которые удаляются вместе с содержимым.
+const QSet<QString>& droppedElements()
+{
+    static const QSet<QString> elements = {
+        "script", "noscript", "iframe", "object", "embed", "svg", "video", "audio", "canvas",
+        "template", "form", "button", "input", "select", "textarea"
+    };
+    return elements;
+}
+
+/// Одиночные теги, которые удаляются.
+const QSet<QString>& droppedTags()
+{
+    static const QSet<QString> tags = {"meta", "link", "base", "wbr"};
+    return tags;
+}
+
+/// Блоки HTML5, которые Qt не знает и которые заменяются на div.
+const QSet<QString>& renamedToDiv()
+{
+    static const QSet<QString> tags = {
+        "section", "article", "header", "footer", "main", "nav", "aside", "figure", "figcaption",
+        "details", "summary"
+    };
+    return tags;
+}
+
+/// Блочные элементы, пробелы рядом с которыми не влияют на верстку.
+const QSet<QString>& blockElements()
+{
+    static const QSet<QString> tags = {
+        "html", "head", "body", "title", "style", "p", "div", "pre", "table", "thead", "tbody", "tfoot",
+        "tr", "td", "th", "ul", "ol", "li", "dl", "dt", "dd", "blockquote", "br", "hr",
+        "h1", "h2", "h3", "h4", "h5", "h6", "center"
+    };
+    return tags;
+}
+
+/// Элементы без закрывающего тега, которые остаются на странице.
+const QSet<QString>& emptyElements()
+{
+    static const QSet<QString> tags = {"br", "hr", "img", "col", "area", "param", "source", "track"};
+    return tags;
+}
+
+/// Атрибуты, которые поддерживает движок QTextDocument.
+const QSet<QString>& supportedAttributes()
+{
+    static const QSet<QString> attributes = {
+        "href", "name", "id", "class", "style", "src", "width", "height", "alt", "title", "align", "valign",
+        "bgcolor", "color", "face", "size", "colspan", "rowspan", "border", "cellpadding", "cellspacing",
+        "start", "type", "dir", "value", "nowrap", "background"
+    };
+    return attributes;
+}
+
+/// Свойства CSS, которые поддерживает движок QTextDocument.
+bool isSupportedProperty(const QString& property)
+{
+    static const QSet<QString> properties = {
+        "background", "background-color", "background-image", "color", "font", "font-family", "font-size",
+        "font-style", "font-weight", "font-variant", "text-decoration", "text-indent", "text-align",
+        "text-transform", "white-space", "word-spacing", "letter-spacing", "line-height", "vertical-align",
+        "margin", "margin-top", "margin-bottom", "margin-left", "margin-right",
+        "padding", "padding-top", "padding-bottom", "padding-left", "padding-right",
+        "border", "border-width", "border-style", "border-color", "border-collapse",
+        "border-top", "border-bottom", "border-left", "border-right",
+        "width", "height", "float", "list-style", "list-style-type",
+        "page-break-before", "page-break-after"
+    };
+    return property.startsWith("-qt-") || properties.contains(property);
+}
+
+/**
+ * @brief Оставляет в атрибутах тега только поддерживаемые и собирает ссылки страницы.
+ */
+QString filterAttributes(const QString& tagName, const QString& attributes, Page& page,
+                         QSet<QString>& usedClasses, QSet<QString>& usedIds)
+{
+    static const QRegularExpression attribute("([a-zA-Z_:][-a-zA-Z0-9_:.]*)(?:\\s*=\\s*(\"[^\"]*\"|'[^']*'|[^\\s\"'>]+))?");
+
+    QString result;
+    QRegularExpressionMatchIterator it = attribute.globalMatch(attributes);
+    while (it.hasNext())
+    {
+        const QRegularExpressionMatch match = it.next();
+        const QString name = match.captured(1).toLower();
+        if (!supportedAttributes().contains(name))
+        {
+            continue;
+        }
+
+        QString value = match.captured(2);
+        const QString unquoted = (value.startsWith('"') || value.startsWith('\'')) ? value.mid(1, value.size() - 2) : value;
+
+        if (name == "name" || name == "id")
+        {
+            page.anchors.append(unquoted);
+            usedIds.insert(unquoted);
+        }
+        else if (name == "class")
+        {
+            for (const QString& cls : unquoted.split(' ', Qt::SkipEmptyParts))
+            {
+                usedClasses.insert(cls);
+            }
+        }
+        else if (name == "href" && tagName == "a")
+        {
+            page.links.append(unquoted);
+        }
+        else if (name == "src" && tagName == "img")
+        {
+            page.images.append(unquoted);
+        }
+
+        result += ' ';
+        result += name;
+        if (!value.isEmpty())
+        {
+            result += '=';
+            result += value.startsWith('"') || value.startsWith('\'') ? value : '"' + value + '"';
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Проверяет, встречается ли на странице элемент, к которому относится селектор.
+ *
+ * Проверяется последняя часть селектора (тег, классы и id). Селекторы с псевдоклассами
+ * QTextDocument не поддерживает, поэтому они считаются неприменимыми.
+ */
+bool selectorApplies(const QString& selector, const QSet<QString>& usedTags,
+                     const QSet<QString>& usedClasses, const QSet<QString>& usedIds)
+{
+    static const QRegularExpression parts("([.#]?)([-_a-zA-Z0-9*]+)");
+
+    const QString simplified = selector.simplified();
+    if (simplified.isEmpty() || simplified.contains(':'))
+    {
+        return false;
+    }
+
+    const QString last = simplified.section(QRegularExpression("[\\s>+~]+"), -1);
+    QRegularExpressionMatchIterator it = parts.globalMatch(last);
+    while (it.hasNext())
+    {
+        const QRegularExpressionMatch match = it.next();
+        const QString kind = match.captured(1);
+        const QString name = match.captured(2);
+        if (kind == "." && !usedClasses.contains(name))
+        {
+            return false;
+        }
+        if (kind == "#" && !usedIds.contains(name))
+        {
+            return false;
+        }
+        if (kind.isEmpty() && name != "*" && !usedTags.contains(name.toLower()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Оставляет применимые к странице правила и поддерживаемые свойства.
+ */
+QString filterCss(const QString& css, const QSet<QString>& usedTags,
+                  const QSet<QString>& usedClasses, const QSet<QString>& usedIds)
+{
+    static const QRegularExpression comment("/\\*.*?\\*/", QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression rule("([^{}@]+)\\{([^{}]*)\\}");
+
+    QString text = css;
+    text.remove(comment);
+
+    QString result;
+    QRegularExpressionMatchIterator it = rule.globalMatch(text);
+    while (it.hasNext())
+    {
+        const QRegularExpressionMatch match = it.next();
+
+        QStringList selectors;
+        for (const QString& selector : match.captured(1).split(','))
+        {
+            if (selectorApplies(selector, usedTags, usedClasses, usedIds))
+            {
+                selectors.append(selector.simplified());
+            }
+        }
+        if (selectors.isEmpty())
+        {
+            continue;
+        }
+
+        QStringList declarations;
+        for (const QString& declaration : match.captured(2).split(';'))
+        {
+            const int colon = declaration.indexOf(':');
+            if (colon <= 0)
+            {
+                continue;
+            }
+            const QString property = declaration.left(colon).trimmed().toLower();
+            if (isSupportedProperty(property))
+            {
+                declarations.append(property + ':' + declaration.mid(colon + 1).simplified());
+            }
+        }
+        if (!declarations.isEmpty())
+        {
+            result += selectors.join(',') + '{' + declarations.join(';') + '}';
+        }
+    }
+    return result;
+}
+
+/// Задает ли список объявлений CSS сохранение пробелов (white-space: pre, pre-wrap или pre-line).
+bool setsPreWhitespace(const QString& declarations)
+{
+    static const QRegularExpression preWhitespace("(^|[;\\s])white-space\\s*:\\s*pre",
+                                                  QRegularExpression::CaseInsensitiveOption);
+    return declarations.contains(preWhitespace);
+}
+
+/**
+ * @brief Возвращает селекторы правил, которые задают white-space: pre*.
+ *
+ * Правила, которые позже возвращают white-space: normal, не учитываются: лишний сохраненный пробел
+ * безопаснее, чем склеенный код в примере.
+ */
+QStringList preWhitespaceSelectors(const QString& css)
+{
+    static const QRegularExpression comment("/\\*.*?\\*/", QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression rule("([^{}@]+)\\{([^{}]*)\\}");
+
+    QString text = css;
+    text.remove(comment);
+
+    QStringList selectors;
+    QRegularExpressionMatchIterator it = rule.globalMatch(text);
+    while (it.hasNext())
+    {
+        const QRegularExpressionMatch match = it.next();
+        if (!setsPreWhitespace(match.captured(2)))
+        {
+            continue;
+        }
+        for (const QString& selector : match.captured(1).split(','))
+        {
+            const QString simplified = selector.simplified();
+            if (!simplified.isEmpty() && !simplified.contains(':'))
+            {
+                selectors.append(simplified);
+            }
+        }
+    }
+    return selectors;
+}
+
+/**
+ * @brief Сохраняет ли элемент пробелы в тексте, как <pre>.
+ *
+ * Учитываются атрибут style и правила preSelectors, у которых последняя часть селектора
+ * (тег, классы и id) подходит к элементу; предки, как и в selectorApplies(), не проверяются.
+ */
+bool preservesWhitespace(const QString& tagName, const QString& attributes, const QStringList& preSelectors)
+{
+    static const QRegularExpression attribute("([a-zA-Z_:][-a-zA-Z0-9_:.]*)\\s*=\\s*(?:\"([^\"]*)\"|'([^']*)'|([^\\s\"'>]+))");
+    static const QRegularExpression parts("([.#]?)([-_a-zA-Z0-9*]+)");
+
+    if (tagName == "pre")
+    {
+        return true;
+    }
+
+    QSet<QString> classes;
+    QString id;
+    QRegularExpressionMatchIterator attributeIt = attribute.globalMatch(attributes);
+    while (attributeIt.hasNext())
+    {
+        const QRegularExpressionMatch match = attributeIt.next();
+        const QString name = match.captured(1).toLower();
+        const QString value = match.captured(2) + match.captured(3) + match.captured(4);
+        if (name == "style" && setsPreWhitespace(value))
+        {
+            return true;
+        }
+        if (name == "class")
+        {
+            for (const QString& cls : value.split(' ', Qt::SkipEmptyParts))
+            {
+                classes.insert(cls);
+            }
+        }
+        else if (name == "id")
+        {
+            id = value;
+        }
+    }
+
+    for (const QString& selector : preSelectors)
+    {
+        const QString last = selector.section(QRegularExpression("[\\s>+~]+"), -1);
+        bool matches = !last.isEmpty();
+        QRegularExpressionMatchIterator it = parts.globalMatch(last);
+        while (matches && it.hasNext())
+        {
+            const QRegularExpressionMatch match = it.next();
+            const QString kind = match.captured(1);
+            const QString name = match.captured(2);
+            if (kind == ".")
+            {
+                matches = classes.contains(name);
+            }
+            else if (kind == "#")
+            {
+                matches = id == name;
+            }
+            else
+            {
+                matches = name == "*" || name.compare(tagName, Qt::CaseInsensitive) == 0;
+            }
+        }
+        if (matches)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Обрабатывает одну страницу.
+ * @param page Страница с прочитанным исходным текстом.
+ * @param sharedCss Общие стили, применимые правила которых добавляются к странице.
+ */
+void preprocess(Page& page, const QString& sharedCss)
+{
+    static const QRegularExpression token("<!--.*?-->|<(/?)([a-zA-Z][a-zA-Z0-9]*)([^>]*?)(/?)>|<!DOCTYPE[^>]*>",
+                                          QRegularExpression::DotMatchesEverythingOption
+                                              | QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression spaces("\\s+");
+
+    QSet<QString> usedTags;
+    QSet<QString> usedClasses;
+    QSet<QString> usedIds;
+
+    QString out;
+    out.reserve(page.source.size());
+
+    QString css;                // Содержимое всех <style> страницы.
+    QString pendingSpace;       // Пробел, судьба которого зависит от следующего тега.
+    bool previousIsBlock = true;
+    // Открытые элементы, сохраняющие пробелы, и для каждого — глубина вложенных в него одноименных элементов.
+    QVector<QPair<QString, int>> preserving;
+    QStringList preSelectors = preWhitespaceSelectors(sharedCss);
+    QString droppedElement;     // Элемент, содержимое которого сейчас пропускается.
+    qsizetype styleInsertAt = -1;
+
+    qsizetype position = 0;
+    QRegularExpressionMatchIterator it = token.globalMatch(page.source);
+
+    auto emitText = [&](const QString& text) {
+        if (text.isEmpty() || !droppedElement.isEmpty())
+        {
+            return;
+        }
+        if (!preserving.isEmpty())
+        {
+            out += text;
+            previousIsBlock = false;
+            return;
+        }
+
+        QString collapsed = text;
+        collapsed.replace(spaces, " ");
+        if (collapsed == " ")
+        {
+            if (!previousIsBlock)
+            {
+                pendingSpace = collapsed;
+            }
+            return;
+        }
+
+        if (previousIsBlock && collapsed.startsWith(' '))
+        {
+            collapsed.remove(0, 1);
+        }
+        out += pendingSpace;
+        pendingSpace.clear();
+        out += collapsed;
+        previousIsBlock = false;
+    };
+
+    while (true)
+    {
+        const bool hasTag = it.hasNext();
+        const QRegularExpressionMatch match = hasTag ? it.next() : QRegularExpressionMatch();
+        const qsizetype tagStart = hasTag ? match.capturedStart() : page.source.size();
+
+        const QString text = page.source.mid(position, tagStart - position);
+        if (droppedElement == "style")
+        {
+            css += text;
+        }
+        else
+        {
+            emitText(text);
+        }
+
+        if (!hasTag)
+        {
+            break;
+        }
+        position = match.capturedEnd();
+
+        const QString whole = match.captured(0);
+        if (whole.startsWith("<!"))
+        {
+            continue; // Комментарии и DOCTYPE не нужны.
+        }
+
+        const bool closing = !match.captured(1).isEmpty();
+        QString name = match.captured(2).toLower();
+
+        if (!droppedElement.isEmpty())
+        {
+            if (closing && name == droppedElement)
+            {
+                droppedElement.clear();
+                if (name == "style")
+                {
+                    preSelectors = preWhitespaceSelectors(sharedCss + '\n' + css);
+                }
+            }
+            continue;
+        }
+
+        if (droppedElements().contains(name) || name == "style")
+        {
+            if (!closing && match.captured(4).isEmpty())
+            {
+                droppedElement = name;
+            }
+            continue;
+        }
+        if (droppedTags().contains(name))
+        {
+            continue;
+        }
+        if (renamedToDiv().contains(name))
+        {
+            name = "div";
+        }
+
+        const bool block = blockElements().contains(name);
+        if (block)
+        {
+            pendingSpace.clear();
+        }
+        else
+        {
+            out += pendingSpace;
+            pendingSpace.clear();
+        }
+
+        if (closing)
+        {
+            if (!preserving.isEmpty() && preserving.last().first == name)
+            {
+                if (preserving.last().second > 0)
+                {
+                    --preserving.last().second;
+                }
+                else
+                {
+                    preserving.removeLast();
+                }
+            }
+        }
+        else if (match.captured(4).isEmpty() && !emptyElements().contains(name))
+        {
+            // Правила CSS написаны для исходного имени тега, а не для div, на который он заменен.
+            if (preservesWhitespace(match.captured(2).toLower(), match.captured(3), preSelectors))
+            {
+                preserving.append({name, 0});
+            }
+            else if (!preserving.isEmpty() && preserving.last().first == name)
+            {
+                ++preserving.last().second;
+            }
+        }
+
+        usedTags.insert(name);
+        out += '<';
+        if (closing)
+        {
+            out += '/';
+        }
+        out += name;
+        if (!closing)
+        {
+            out += filterAttributes(name, match.captured(3), page, usedClasses, usedIds);
+        }
+        out += match.captured(4);
+        out += '>';
+
+        if (name == "head" && !closing)
+        {
+            styleInsertAt = out.size();
+        }
+        previousIsBlock = block;
+    }
+
+    // Стили страницы и применимые к ней общие стили собираются в один блок <style> в начале документа.
+    const QString pageCss = filterCss(sharedCss + '\n' + css, usedTags, usedClasses, usedIds);
+    if (!pageCss.isEmpty())
+    {
+        const QString styleBlock = "<style>" + pageCss + "</style>";
+        if (styleInsertAt >= 0)
+        {
+            out.insert(styleInsertAt, styleBlock);
+        }
+        else
+        {
+            out.prepend("<head>" + styleBlock + "</head>");
+        }
+    }
+
+    page.result = out;
+}
+
+/**
+ * @brief Время разбора HTML в QTextDocument в миллисекундах (лучшее из нескольких повторов).
+ */
+double parseTimeMs(const QString& html)
+{
+    double best = 0;
+    for (int attempt = 0; attempt < 3; ++attempt)
+    {
+        QTextDocument document;
+        document.setUndoRedoEnabled(false);
+
+        QElapsedTimer timer;
+        timer.start();
+        document.setHtml(html);
+        const double elapsed = timer.nsecsElapsed() / 1e6;
+        best = attempt == 0 ? elapsed : qMin(best, elapsed);
+    }
+    return best;
+}
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QDir().mkpath(QFileInfo(path).path());
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Для замера разбора нужен QTextDocument, а значит QGuiApplication; окна не создаются.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Предварительная обработка страниц справочника");
+    parser.addHelpOption();
+    parser.addOption({"data", "Файл data.json.", "file"});
+    parser.addOption({"root", "Каталог, относительно которого ищутся страницы.", "dir"});
+    parser.addOption({"out", "Каталог для обработанных страниц.", "dir"});
+    parser.addOption({"css", "Общие стили страниц.", "file"});
+    parser.addOption({"strict", "Считать неверные ссылки ошибкой."});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    QTextStream out(stdout);
+
+    const QString dataPath = parser.value("data");
+    const QDir root(parser.value("root"));
+    const QDir outDir(parser.value("out"));
+    if (dataPath.isEmpty() || parser.value("out").isEmpty())
+    {
+        parser.showHelp(1);
+    }
+
+    QFile dataFile(dataPath);
+    if (!dataFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        err << "Не удалось открыть " << dataPath << ": " << dataFile.errorString() << Qt::endl;
+        return 1;
+    }
+    const QJsonDocument jsonDoc = QJsonDocument::fromJson(dataFile.readAll());
+    if (!jsonDoc.isArray())
+    {
+        err << dataPath << " не является JSON массивом" << Qt::endl;
+        return 1;
+    }
+
+    QString sharedCss;
+    if (parser.isSet("css"))
+    {
+        QFile cssFile(parser.value("css"));
+        if (!cssFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            err << "Не удалось открыть " << cssFile.fileName() << Qt::endl;
+            return 1;
+        }
+        sharedCss = QString::fromUtf8(cssFile.readAll());
+    }
+
+    QVector<Page> pages;
+    for (const TocJson::Entry& entry : TocJson::flatten(jsonDoc.array()))
+    {
+        Page page;
+        page.filePath = entry.object["filePath"].toString();
+        page.entryName = ContentPack::entryName(page.filePath);
+        pages.append(page);
+    }
+
+    // Чтение и обработка страниц независимы, поэтому выполняются параллельно.
+    QtConcurrent::blockingMap(pages, [&root, &sharedCss](Page& page) {
+        QFile file(root.filePath(page.entryName));
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            return;
+        }
+        page.source = QString::fromUtf8(file.readAll());
+        page.readOk = true;
+        preprocess(page, sharedCss);
+    });
+
+    bool failed = false;
+    bool brokenLinks = false;
+
+    QHash<QString, const Page*> pagesByName;
+    for (const Page& page : pages)
+    {
+        if (!page.readOk)
+        {
+            err << "Не найдена страница " << page.filePath << Qt::endl;
+            failed = true;
+            continue;
+        }
+        pagesByName.insert(page.entryName, &page);
+    }
+
+    // Проверка ссылок: якоря на той же странице, другие страницы справочника и изображения.
+    for (const Page& page : pages)
+    {
+        if (!page.readOk)
+        {
+            continue;
+        }
+
+        const QString pageDir = QFileInfo(page.entryName).path();
+        for (const QString& link : page.links)
+        {
+            const PageReferences::Link resolved = PageReferences::resolveLink(link, pageDir);
+            if (resolved.external)
+            {
+                continue;
+            }
+
+            const Page* targetPage = &page;
+            if (!resolved.entryName.isEmpty())
+            {
+                targetPage = pagesByName.value(resolved.entryName, nullptr);
+                if (!targetPage)
+                {
+                    err << page.filePath << ": ссылка на неизвестную страницу " << link << Qt::endl;
+                    brokenLinks = true;
+                    continue;
+                }
+            }
+            if (!resolved.anchor.isEmpty() && !targetPage->anchors.contains(resolved.anchor))
+            {
+                err << page.filePath << ": ссылка на несуществующий якорь " << link << Qt::endl;
+                brokenLinks = true;
+            }
+        }
+
+        for (const QString& image : page.images)
+        {
+            const QString local = PageReferences::localReference(image);
+            if (local.isEmpty())
+            {
+                continue;
+            }
+
+            const QStringList candidates = PageReferences::imageCandidates(root, pageDir, local);
+            if (std::none_of(candidates.cbegin(), candidates.cend(),
+                             [](const QString& candidate) { return QFileInfo::exists(candidate); }))
+            {
+                err << page.filePath << ": не найдено изображение " << image << Qt::endl;
+                brokenLinks = true;
+            }
+        }
+    }
+
+    if (failed || (brokenLinks && parser.isSet("strict")))
+    {
+        return 1;
+    }
+
+    // Запись страниц, texts.qrc и отчета. Время разбора замеряется в одном потоке, чтобы замеры были сравнимы.
+    QByteArray qrc = "<RCC>\n    <qresource prefix=\"/\">\n";
+    QByteArray report = "page,bytes_before,bytes_after,parse_ms_before,parse_ms_after\n";
+    qint64 totalBefore = 0;
+    qint64 totalAfter = 0;
+    double totalParseBefore = 0;
+    double totalParseAfter = 0;
+
+    for (const Page& page : pages)
+    {
+        const QByteArray before = page.source.toUtf8();
+        const QByteArray after = page.result.toUtf8();
+        if (!writeFile(outDir.filePath(page.entryName), after))
+        {
+            err << "Не удалось записать " << outDir.filePath(page.entryName) << Qt::endl;
+            return 1;
+        }
+        qrc += "        <file>" + page.entryName.toUtf8() + "</file>\n";
+
+        const double parseBefore = parseTimeMs(page.source);
+        const double parseAfter = parseTimeMs(page.result);
+        report += page.entryName.toUtf8() + ',' + QByteArray::number(before.size()) + ','
+                  + QByteArray::number(after.size()) + ',' + QByteArray::number(parseBefore, 'f', 3) + ','
+                  + QByteArray::number(parseAfter, 'f', 3) + '\n';
+
+        totalBefore += before.size();
+        totalAfter += after.size();
+        totalParseBefore += parseBefore;
+        totalParseAfter += parseAfter;
+    }
+    qrc += "    </qresource>\n</RCC>\n";
+    report += "total," + QByteArray::number(totalBefore) + ',' + QByteArray::number(totalAfter) + ','
+              + QByteArray::number(totalParseBefore, 'f', 3) + ',' + QByteArray::number(totalParseAfter, 'f', 3) + '\n';
+
+    if (!writeFile(outDir.filePath("htmlprep_report.csv"), report) || !writeFile(outDir.filePath("texts.qrc"), qrc))
+    {
+        err << "Не удалось записать отчет или texts.qrc в " << outDir.path() << Qt::endl;
+        return 1;
+    }
+
+    out << "Страниц: " << pages.size() << ", размер " << totalBefore << " -> " << totalAfter
+        << " байт, разбор " << QString::number(totalParseBefore, 'f', 1) << " -> "
+        << QString::number(totalParseAfter, 'f', 1) << " мс" << Qt::endl;
+    return 0;
+}
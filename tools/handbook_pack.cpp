@@ -0,0 +1,128 @@
+/**
+ * @file handbook_pack.cpp
+ * @brief Утилита сборки пакета содержимого handbook.pack из data.json и каталога texts/.
+ *
+ * Использование:
+ *     handbook_pack --data data.json --root <каталог исходников> --out handbook.pack
+ *
+ * Для каждой записи data.json путь ":/texts/..." ищется относительно каталога --root. В пакет
+ * попадают все страницы и копия data.json, в которую добавлено значение "hash" каждой страницы,
+ * чтобы поисковый индекс мог проверять изменения страниц без их чтения. Вложенные разделы ("children")
+ * обходятся так же и сохраняют свое место в оглавлении.
+ */
+
+#include "../contentpack.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+namespace {
+
+/**
+ * @brief Читает страницу так же, как MainWindow::loadTextFromFile в текстовом режиме:
+ * окончания строк приводятся к '\n'.
+ */
+QByteArray readPage(const QString& path, bool* ok)
+{
+    QFile file(path);
+    *ok = file.open(QIODevice::ReadOnly | QIODevice::Text);
+    return *ok ? file.readAll() : QByteArray();
+}
+
+/**
+ * @brief Добавляет в пакет страницы записей одного уровня и их вложенных разделов.
+ * @return Записи уровня со значениями "hash".
+ */
+QJsonArray packLevel(const QJsonArray& level, const QDir& root, QVector<ContentPack::Entry>& entries,
+                     QTextStream& err, bool* failed)
+{
+    QJsonArray catalog;
+    for (const QJsonValue& value : level)
+    {
+        QJsonObject obj = value.toObject();
+        const QString name = ContentPack::entryName(obj["filePath"].toString());
+
+        bool ok = false;
+        const QByteArray page = readPage(root.filePath(name), &ok);
+        if (!ok)
+        {
+            err << "Не найдена страница " << name << Qt::endl;
+            *failed = true;
+            continue;
+        }
+
+        obj["hash"] = QString::number(ContentPack::hashOf(page), 16);
+        entries.append({name, page});
+        if (obj["children"].isArray())
+        {
+            obj["children"] = packLevel(obj["children"].toArray(), root, entries, err, failed);
+        }
+        catalog.append(obj);
+    }
+    return catalog;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Сборка пакета содержимого справочника");
+    parser.addHelpOption();
+    parser.addOption({"data", "Файл data.json.", "file"});
+    parser.addOption({"root", "Каталог, относительно которого ищутся страницы.", "dir"});
+    parser.addOption({"out", "Файл пакета.", "file"});
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    const QString dataPath = parser.value("data");
+    const QDir root(parser.value("root"));
+    const QString outPath = parser.value("out");
+    if (dataPath.isEmpty() || outPath.isEmpty())
+    {
+        parser.showHelp(1);
+    }
+
+    QFile dataFile(dataPath);
+    if (!dataFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        err << "Не удалось открыть " << dataPath << ": " << dataFile.errorString() << Qt::endl;
+        return 1;
+    }
+
+    const QJsonDocument jsonDoc = QJsonDocument::fromJson(dataFile.readAll());
+    if (!jsonDoc.isArray())
+    {
+        err << dataPath << " не является JSON массивом" << Qt::endl;
+        return 1;
+    }
+
+    QVector<ContentPack::Entry> entries;
+    bool failed = false;
+    const QJsonArray catalog = packLevel(jsonDoc.array(), root, entries, err, &failed);
+
+    if (failed)
+    {
+        return 1;
+    }
+
+    entries.prepend({"data.json", QJsonDocument(catalog).toJson()});
+
+    if (!ContentPack::write(outPath, entries))
+    {
+        err << "Не удалось записать " << outPath << Qt::endl;
+        return 1;
+    }
+
+    QTextStream(stdout) << "Пакет " << outPath << ": записей " << entries.size() << Qt::endl;
+    return 0;
+}
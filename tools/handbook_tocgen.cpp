@@ -0,0 +1,209 @@
+/**
+ * @file handbook_tocgen.cpp
+ * @brief Генератор заголовка toc_generated.h с оглавлением справочника из data.json.
+ *
+ * Использование:
+ *     handbook_tocgen --data data.json --root <каталог исходников> --out toc_generated.h
+ *
+ * Заголовок содержит constexpr таблицу TocEntry с названиями и путями страниц в виде литералов UTF-16,
+ * хешами содержимого страниц, вложенностью разделов и порядком записей по пути для поиска. Вложенное
+ * оглавление (массивы "children") записывается в порядке обхода в глубину. Сборка завершается ошибкой,
+ * если в data.json повторяется путь, у записи нет названия или файл страницы не найден.
+ */
+
+#include "../contentpack.h"
+#include "../tocjson.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QTextStream>
+
+#include <algorithm>
+
+namespace {
+
+struct Page
+{
+    QString title;
+    QString filePath;
+    quint64 hash;
+    int parent;
+    int subtreeEnd;
+};
+
+/**
+ * @brief Записывает строку как литерал u"...". Все символы вне ASCII записываются escape-последовательностями,
+ * поэтому результат не зависит от кодировки исходников, принятой компилятором.
+ */
+QByteArray utf16Literal(const QString& text)
+{
+    QByteArray result = "u\"";
+    for (const uint code : text.toUcs4())
+    {
+        if (code == '"' || code == '\\')
+        {
+            result += '\\';
+            result += char(code);
+        }
+        else if (code >= 0x20 && code < 0x7f && code != '?')
+        {
+            result += char(code);
+        }
+        else if (code <= 0xffff)
+        {
+            result += "\\u" + QByteArray::number(code, 16).rightJustified(4, '0');
+        }
+        else
+        {
+            result += "\\U" + QByteArray::number(code, 16).rightJustified(8, '0');
+        }
+    }
+    result += '"';
+    return result;
+}
+
+QByteArray generateHeader(const QVector<Page>& pages)
+{
+    QVector<int> pathOrder(pages.size());
+    for (int i = 0; i < pathOrder.size(); ++i)
+    {
+        pathOrder[i] = i;
+    }
+    std::sort(pathOrder.begin(), pathOrder.end(), [&pages](int a, int b) {
+        return QString::compare(pages[a].filePath, pages[b].filePath, Qt::CaseSensitive) < 0;
+    });
+
+    QByteArray out;
+    out += "// Сгенерировано handbook_tocgen из data.json. Не редактировать вручную.\n\n";
+    out += "#ifndef TOC_GENERATED_H\n#define TOC_GENERATED_H\n\n";
+    out += "#include \"tocmodel.h\"\n\n";
+    out += "namespace GeneratedToc {\n\n";
+
+    out += "inline constexpr int count = " + QByteArray::number(pages.size()) + ";\n\n";
+
+    out += "inline constexpr TocEntry entries[] = {\n";
+    for (const Page& page : pages)
+    {
+        out += "    {" + utf16Literal(page.title) + ", " + QByteArray::number(page.title.size()) + ", "
+               + utf16Literal(page.filePath) + ", " + QByteArray::number(page.filePath.size()) + ", 0x"
+               + QByteArray::number(page.hash, 16) + "ull, " + QByteArray::number(page.parent) + ", "
+               + QByteArray::number(page.subtreeEnd) + "},\n";
+    }
+    out += "};\n\n";
+
+    out += "inline constexpr int pathOrder[] = {";
+    for (int i = 0; i < pathOrder.size(); ++i)
+    {
+        out += (i % 16 == 0) ? "\n    " : " ";
+        out += QByteArray::number(pathOrder[i]) + ",";
+    }
+    out += "\n};\n\n";
+
+    out += "} // namespace GeneratedToc\n\n#endif // TOC_GENERATED_H\n";
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Генерация оглавления справочника из data.json");
+    parser.addHelpOption();
+    parser.addOption({"data", "Файл data.json.", "file"});
+    parser.addOption({"root", "Каталог, относительно которого ищутся страницы.", "dir"});
+    parser.addOption({"out", "Генерируемый заголовок.", "file"});
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    const QString dataPath = parser.value("data");
+    const QDir root(parser.value("root"));
+    const QString outPath = parser.value("out");
+    if (dataPath.isEmpty() || outPath.isEmpty())
+    {
+        parser.showHelp(1);
+    }
+
+    QFile dataFile(dataPath);
+    if (!dataFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        err << "Не удалось открыть " << dataPath << ": " << dataFile.errorString() << Qt::endl;
+        return 1;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument jsonDoc = QJsonDocument::fromJson(dataFile.readAll(), &parseError);
+    if (!jsonDoc.isArray())
+    {
+        err << dataPath << ": не является JSON массивом (" << parseError.errorString() << ")" << Qt::endl;
+        return 1;
+    }
+
+    QVector<Page> pages;
+    QSet<QString> seenPaths;
+    bool failed = false;
+
+    const QVector<TocJson::Entry> entries = TocJson::flatten(jsonDoc.array());
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        const QJsonObject& obj = entries[i].object;
+        const QString title = obj["title"].toString();
+        const QString filePath = obj["filePath"].toString();
+
+        if (title.isEmpty() || filePath.isEmpty())
+        {
+            err << dataPath << ": у записи " << i << " нет значения \"title\" или \"filePath\"" << Qt::endl;
+            failed = true;
+            continue;
+        }
+
+        if (seenPaths.contains(filePath))
+        {
+            err << dataPath << ": путь " << filePath << " повторяется (запись " << i << ")" << Qt::endl;
+            failed = true;
+            continue;
+        }
+        seenPaths.insert(filePath);
+
+        QFile page(root.filePath(ContentPack::entryName(filePath)));
+        if (!page.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            err << dataPath << ": не найдена страница " << filePath << " (" << page.fileName() << ")" << Qt::endl;
+            failed = true;
+            continue;
+        }
+
+        pages.append({title, filePath, ContentPack::hashOf(page.readAll()), entries[i].parent, entries[i].subtreeEnd});
+    }
+
+    if (!failed && pages.isEmpty())
+    {
+        err << dataPath << ": оглавление пусто" << Qt::endl;
+        failed = true;
+    }
+
+    if (failed)
+    {
+        return 1;
+    }
+
+    const QByteArray header = generateHeader(pages);
+    QSaveFile out(outPath);
+    if (!out.open(QIODevice::WriteOnly) || out.write(header) != header.size() || !out.commit())
+    {
+        err << "Не удалось записать " << outPath << Qt::endl;
+        return 1;
+    }
+
+    return 0;
+}
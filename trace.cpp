@@ -0,0 +1,184 @@
+/**
+ * @file trace.cpp
+ * @brief Реализация трассировки и записи событий в формате Chrome trace_event.
+ */
+
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <QVector>
+
+std::atomic<bool> Trace::enabled{false};
+
+namespace {
+
+struct Event
+{
+    const char* name;
+    const char* category;
+    char phase;         ///< 'X' — участок, 'i' — момент времени.
+    int thread;
+    qint64 start;
+    qint64 duration;
+    QString detail;
+};
+
+struct TraceState
+{
+    QMutex mutex;
+    QElapsedTimer clock;
+    QString outputPath;
+    QVector<Event> events;
+};
+
+TraceState& state()
+{
+    static TraceState traceState;
+    return traceState;
+}
+
+/**
+ * @brief Возвращает номер дорожки текущего потока. Главный поток, включивший трассировку, получает 1.
+ */
+int currentThread()
+{
+    static std::atomic<int> nextThread{1};
+    thread_local const int thread = nextThread.fetch_add(1);
+    return thread;
+}
+
+} // namespace
+
+void Trace::configure(int argc, char *argv[])
+{
+    QString outputPath = qEnvironmentVariable("HANDBOOK_TRACE");
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const QString arg = QString::fromLocal8Bit(argv[i]);
+        if (arg == "--trace" && i + 1 < argc)
+        {
+            outputPath = QString::fromLocal8Bit(argv[i + 1]);
+        }
+        else if (arg.startsWith("--trace="))
+        {
+            outputPath = arg.mid(int(qstrlen("--trace=")));
+        }
+    }
+
+    if (!outputPath.isEmpty())
+    {
+        start(outputPath);
+    }
+}
+
+void Trace::start(const QString &outputPath)
+{
+    TraceState& traceState = state();
+    QMutexLocker locker(&traceState.mutex);
+
+    traceState.outputPath = outputPath;
+    traceState.events.clear();
+    traceState.events.reserve(4096);
+    traceState.clock.start();
+    currentThread();
+
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::finish()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+    enabled.store(false, std::memory_order_relaxed);
+
+    TraceState& traceState = state();
+    QMutexLocker locker(&traceState.mutex);
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+
+    QJsonObject processName;
+    processName["name"] = "process_name";
+    processName["ph"] = "M";
+    processName["pid"] = pid;
+    processName["args"] = QJsonObject{{"name", "PythonProgrammingHandbook"}};
+    traceEvents.append(processName);
+
+    for (const Event& event : traceState.events)
+    {
+        QJsonObject obj;
+        obj["name"] = QString::fromLatin1(event.name);
+        obj["cat"] = QString::fromLatin1(event.category);
+        obj["ph"] = QString(QLatin1Char(event.phase));
+        obj["ts"] = event.start;
+        obj["pid"] = pid;
+        obj["tid"] = event.thread;
+        if (event.phase == 'X')
+        {
+            obj["dur"] = event.duration;
+        }
+        else
+        {
+            obj["s"] = "t";
+        }
+        if (!event.detail.isEmpty())
+        {
+            obj["args"] = QJsonObject{{"detail", event.detail}};
+        }
+        traceEvents.append(obj);
+    }
+
+    QSaveFile file(traceState.outputPath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Не удалось открыть файл трассы:" << file.errorString();
+        return;
+    }
+
+    file.write(QJsonDocument(QJsonObject{{"traceEvents", traceEvents}}).toJson(QJsonDocument::Compact));
+    if (file.commit())
+    {
+        qDebug() << "Трасса записана в" << traceState.outputPath << "событий:" << traceState.events.size();
+    }
+    traceState.events.clear();
+}
+
+void Trace::instant(const char *name, const char *category)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    const qint64 time = now();
+    TraceState& traceState = state();
+    QMutexLocker locker(&traceState.mutex);
+    traceState.events.append({name, category, 'i', currentThread(), time, 0, QString()});
+}
+
+qint64 Trace::now()
+{
+    return state().clock.nsecsElapsed() / 1000;
+}
+
+void Trace::record(const char *name, const char *category, qint64 start, qint64 duration, const QString &detail)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    TraceState& traceState = state();
+    QMutexLocker locker(&traceState.mutex);
+    traceState.events.append({name, category, 'X', currentThread(), start, duration, detail});
+}
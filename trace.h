@@ -0,0 +1,129 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * @file trace.h
+ * @brief Определение классов Trace и TraceSpan — трассировки запуска и переключения страниц.
+ *
+ * Участок кода отмечается объектом TraceSpan, который живет до конца блока. Если трассировка
+ * включена, при разрушении объекта записывается событие с временем начала и длительностью.
+ * Если выключена, конструктор и деструктор сводятся к проверке одного флага.
+ *
+ * Трассировка включается переменной окружения HANDBOOK_TRACE или параметром командной строки
+ * --trace <файл>. При завершении программы события записываются в формате Chrome trace_event JSON,
+ * который открывается в Perfetto (ui.perfetto.dev) или chrome://tracing.
+ */
+
+#include <QString>
+
+#include <atomic>
+
+/**
+ * @class Trace
+ * @brief Глобальный журнал событий трассировки.
+ *
+ * Запись событий потокобезопасна: участки отмечаются и в рабочих потоках (подготовка соседних
+ * страниц, построение поискового индекса), и каждый поток получает свою дорожку на временной шкале.
+ */
+class Trace
+{
+public:
+    /**
+     * @brief Включает трассировку, если задана переменная HANDBOOK_TRACE или параметр --trace.
+     *
+     * Вызывается в начале main() до создания QApplication, чтобы в трассу попало и оно.
+     * @param argc Количество параметров командной строки.
+     * @param argv Параметры командной строки.
+     */
+    static void configure(int argc, char* argv[]);
+
+    /**
+     * @brief Включает трассировку с записью в указанный файл.
+     * @param outputPath Путь к JSON файлу трассы.
+     */
+    static void start(const QString& outputPath);
+
+    /**
+     * @brief Записывает накопленные события в файл и выключает трассировку.
+     */
+    static void finish();
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Отмечает момент времени (например, показ первой страницы).
+     * @param name Название события (строковый литерал).
+     * @param category Категория события (строковый литерал).
+     */
+    static void instant(const char* name, const char* category);
+
+    /// Время в микросекундах от включения трассировки.
+    static qint64 now();
+
+    /**
+     * @brief Записывает завершенный участок.
+     * @param name Название участка (строковый литерал).
+     * @param category Категория участка (строковый литерал).
+     * @param start Время начала в микросекундах.
+     * @param duration Длительность в микросекундах.
+     * @param detail Дополнительное значение, например путь к странице.
+     */
+    static void record(const char* name, const char* category, qint64 start, qint64 duration,
+                       const QString& detail);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+/**
+ * @class TraceSpan
+ * @brief Участок кода, время выполнения которого попадает в трассу.
+ *
+ * Названия и категории передаются строковыми литералами: они не копируются при записи события.
+ */
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name, const char* category = "handbook")
+        : name(Trace::isEnabled() ? name : nullptr)
+        , category(category)
+        , start(this->name ? Trace::now() : 0)
+    {
+    }
+
+    ~TraceSpan() { end(); }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    /**
+     * @brief Добавляет к событию дополнительное значение. При выключенной трассировке ничего не делает.
+     */
+    void setDetail(const QString& detail)
+    {
+        if (name)
+        {
+            this->detail = detail;
+        }
+    }
+
+    /**
+     * @brief Завершает участок раньше конца блока.
+     */
+    void end()
+    {
+        if (name)
+        {
+            Trace::record(name, category, start, Trace::now() - start, detail);
+            name = nullptr;
+        }
+    }
+
+private:
+    const char* name;
+    const char* category;
+    qint64 start;
+    QString detail;
+};
+
+#endif // TRACE_H